@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "redis/client.hpp"
+#include "redis/commands.hpp"
+
+// Measures the request rate and latency of a single core driving a client
+// with small values. Build once with REDIS_USE_IO_URING=ON and once without
+// to compare the io_uring and epoll backends. Parameters are read from the
+// environment:
+//   REDIS_HOST        the server, default host.docker.internal
+//   REDIS_PORT        default 6379
+//   BENCH_CONNECTIONS the size of the connection pool, default 8
+//   BENCH_TASKS       the number of concurrent callers, default 64
+//   BENCH_REQUESTS    the number of sends per caller, default 10000
+//   BENCH_PIPELINE    the number of commands per send, default 1
+//   BENCH_VALUE_SIZE  the size of the values in bytes, default 16
+
+namespace {
+
+using namespace redis;
+using std::chrono::steady_clock;
+using string = std::string;
+
+const std::string DEFAULT_REDIS_HOST = "host.docker.internal";
+
+string get_env_var(const string& key, const string& default_value) {
+    char* val = getenv(key.c_str());
+    return (val == NULL) ? default_value : string(val);
+}
+
+unsigned int get_env_var(const string& key, unsigned int default_value) {
+    char* val = getenv(key.c_str());
+    return (val == NULL) ? default_value
+                         : static_cast<unsigned int>(std::stoul(val));
+}
+
+const char* io_backend() {
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+    return "io_uring";
+#else
+    return "epoll";
+#endif
+}
+
+struct benchmark_config {
+    unsigned int tasks;
+    unsigned int requests;
+    unsigned int pipeline;
+    string value;
+};
+
+/// Alternates SET and GET on a key of its own, recording each send's latency
+awaitable<void> run_task(client& client, const benchmark_config& config,
+                         int task, std::vector<steady_clock::duration>& latency,
+                         unsigned int& errors, cpool::awaitable_latch& done) {
+    auto key = fmt::format("bench:{}", task);
+
+    for (unsigned int i = 0; i < config.requests; ++i) {
+        auto start = steady_clock::now();
+        if (config.pipeline == 1) {
+            auto reply = co_await client.send(
+                (i % 2 == 0) ? redis::set(key, config.value) : redis::get(key));
+            errors += reply.error() ? 1 : 0;
+        } else {
+            commands pipeline;
+            for (unsigned int j = 0; j < config.pipeline; ++j) {
+                pipeline.push_back((j % 2 == 0) ? redis::set(key, config.value)
+                                                : redis::get(key));
+            }
+            auto replies = co_await client.send(pipeline);
+            errors += std::count_if(
+                replies.cbegin(), replies.cend(),
+                [](const auto& reply) { return (bool)reply.error(); });
+        }
+        latency.push_back(steady_clock::now() - start);
+    }
+
+    done.count_down();
+}
+
+double percentile_us(std::vector<steady_clock::duration>& latency,
+                     double percentile) {
+    if (latency.empty()) {
+        return 0;
+    }
+
+    auto n = static_cast<size_t>(percentile * (latency.size() - 1));
+    std::nth_element(latency.begin(), latency.begin() + n, latency.end());
+    return std::chrono::duration<double, std::micro>(latency[n]).count();
+}
+
+awaitable<void> run_benchmark(net::io_context& ctx) {
+    auto exec = co_await net::this_coro::executor;
+
+    auto client_config =
+        redis::client_config()
+            .set_host(get_env_var("REDIS_HOST", DEFAULT_REDIS_HOST))
+            .set_port(get_env_var("REDIS_PORT", 6379u))
+            .set_max_connections(get_env_var("BENCH_CONNECTIONS", 8u))
+            .set_min_idle_connections(get_env_var("BENCH_CONNECTIONS", 8u));
+
+    benchmark_config config;
+    config.tasks = get_env_var("BENCH_TASKS", 64u);
+    config.requests = get_env_var("BENCH_REQUESTS", 10000u);
+    config.pipeline = std::max(get_env_var("BENCH_PIPELINE", 1u), 1u);
+    config.value = string(get_env_var("BENCH_VALUE_SIZE", 16u), 'x');
+
+    client client(exec, client_config);
+    auto error = co_await client.warm_up();
+    if (error) {
+        std::cerr << "could not connect: " << error.message() << std::endl;
+        ctx.stop();
+        co_return;
+    }
+
+    std::vector<std::vector<steady_clock::duration>> latency(config.tasks);
+    std::vector<unsigned int> errors(config.tasks, 0);
+    cpool::awaitable_latch done(exec, config.tasks);
+
+    auto start = steady_clock::now();
+    for (unsigned int i = 0; i < config.tasks; ++i) {
+        latency[i].reserve(config.requests);
+        net::co_spawn(exec,
+                      run_task(client, config, i, latency[i], errors[i], done),
+                      net::detached);
+    }
+    co_await done.wait();
+    auto elapsed = std::chrono::duration<double>(steady_clock::now() - start);
+
+    std::vector<steady_clock::duration> all;
+    for (auto& task_latency : latency) {
+        all.insert(all.end(), task_latency.cbegin(), task_latency.cend());
+    }
+    unsigned int num_errors = 0;
+    for (auto task_errors : errors) {
+        num_errors += task_errors;
+    }
+
+    auto num_commands = static_cast<double>(config.tasks) * config.requests *
+                        config.pipeline;
+    std::cout << fmt::format(
+                     "backend={} tasks={} pipeline={} value_size={}\n"
+                     "commands={} errors={} elapsed={:.3f}s\n"
+                     "throughput={:.0f} commands/s\n"
+                     "latency p50={:.1f}us p99={:.1f}us p999={:.1f}us",
+                     io_backend(), config.tasks, config.pipeline,
+                     config.value.size(), num_commands, num_errors,
+                     elapsed.count(), num_commands / elapsed.count(),
+                     percentile_us(all, 0.5), percentile_us(all, 0.99),
+                     percentile_us(all, 0.999))
+              << std::endl;
+
+    co_await client.stop();
+    ctx.stop();
+}
+
+} // namespace
+
+int main() {
+    // a single thread so the results are per core
+    net::io_context ctx(1);
+
+    net::co_spawn(ctx, run_benchmark(ctx), net::detached);
+    ctx.run();
+
+    return 0;
+}
@@ -18,20 +18,25 @@ class RedisClientConan(ConanFile):
     topics = ("redis", "asio")
     exports = ["LICENSE"]
     exports_sources = ["CMakeLists.txt", "conan.cmake",
-                       "conanfile.py", "redis/*", "test/*"]
+                       "conanfile.py", "redis/*", "test/*", "benchmark/*"]
     generators = "cmake"
     settings = "os", "arch", "compiler", "build_type"
     requires = "cpool/main_23c5e65a0f9b", "boost/1.78.0", "openssl/1.1.1m", "fmt/8.1.1"
     build_requires = "gtest/cci.20210126"
     options = {"cxx_standard": [20], "build_testing": [
-        True, False], "trace_logging": [True, False]}
+        True, False], "trace_logging": [True, False], "io_uring": [True, False]}
     default_options = {"cxx_standard": 20,
-                       "build_testing": True, "trace_logging": False}
+                       "build_testing": True, "trace_logging": False,
+                       "io_uring": False}
 
     def config_options(self):
         if self.settings.os == "Windows":
             del self.options.fPIC
 
+    def requirements(self):
+        if self.options.io_uring:
+            self.requires("liburing/2.1")
+
     def configure(self):
         if self.settings.os == "Windows" and \
            self.settings.compiler == "Visual Studio" and \
@@ -55,6 +60,7 @@ class RedisClientConan(ConanFile):
         cmake.definitions["CMAKE_CXX_STANDARD"] = self.options.cxx_standard
         cmake.definitions["BUILD_TESTING"] = self.options.build_testing
         cmake.definitions["CPOOL_TRACE_LOGGING"] = self.options.trace_logging
+        cmake.definitions["REDIS_USE_IO_URING"] = self.options.io_uring
         cmake.configure()
         cmake.build()
         cmake.test()
@@ -66,3 +72,7 @@ class RedisClientConan(ConanFile):
 
     def package_info(self):
         self.cpp_info.libs = ["redis_client"]
+        if self.options.io_uring:
+            # consumers must build asio with the same backend
+            self.cpp_info.defines = [
+                "BOOST_ASIO_HAS_IO_URING", "BOOST_ASIO_DISABLE_EPOLL"]
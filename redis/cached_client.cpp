@@ -0,0 +1,92 @@
+#include "redis/cached_client.hpp"
+
+#include <algorithm>
+
+#include "redis/commands-ttl.hpp"
+#include "redis/near_cache.hpp"
+
+namespace redis {
+
+cached_client::cached_client(client& client, local_cache_config config)
+    : client_(client)
+    , cache_(std::move(config)) {}
+
+awaitable<reply> cached_client::send(command command) {
+    if (near_cache::cacheable(command)) {
+        auto key = command.keys().front();
+        auto id = command.serialized_command();
+        auto cached = cache_.get(key, id);
+        if (cached) {
+            co_return *cached;
+        }
+
+        co_return co_await read_through(std::move(command), std::move(key),
+                                        std::move(id));
+    }
+
+    auto reply = co_await client_.send(command);
+    if (!command.read_only()) {
+        for (const auto& key : command.keys()) {
+            cache_.erase(key);
+        }
+    }
+
+    co_return reply;
+}
+
+local_cache& cached_client::cache() { return cache_; }
+
+local_cache_metrics cached_client::metrics() const { return cache_.metrics(); }
+
+awaitable<reply> cached_client::read_through(command command, string key,
+                                             string id) {
+    // a write that erases the key while the read is in flight keeps the
+    // reply out of the cache
+    auto token = cache_.begin_fill(key);
+    if (!cache_.config().use_pttl) {
+        auto reply = co_await client_.send(std::move(command));
+        cache_.end_fill(key, id, token, reply,
+                        ttl_for(key, reply, redis::reply()));
+        co_return reply;
+    }
+
+    // the PTTL is read in the same round trip so it matches the reply
+    auto pipeline = commands{std::move(command), redis::pttl(key)};
+    auto replies = co_await client_.send(std::move(pipeline));
+    if (replies.size() != 2) {
+        cache_.end_fill(key, id, token, reply(client_error_code::error), 0ms);
+        co_return reply(client_error_code::error);
+    }
+
+    cache_.end_fill(key, id, token, replies[0],
+                    ttl_for(key, replies[0], replies[1]));
+    co_return replies[0];
+}
+
+std::chrono::milliseconds
+cached_client::ttl_for(const string& key, const reply& reply,
+                       const redis::reply& pttl) const {
+    const auto& config = cache_.config();
+    if (reply.value().type() == redis_type::nil) {
+        return config.negative_ttl;
+    }
+
+    auto ttl = cache_.ttl_for(key);
+    auto remaining = pttl.value().as<int64_t>();
+    if (pttl.error() || !remaining) {
+        return ttl;
+    }
+
+    if (*remaining == -2) {
+        // the key does not exist, e.g. EXISTS or LLEN returned 0
+        return config.negative_ttl;
+    }
+
+    if (*remaining >= 0) {
+        ttl = std::min(ttl, std::chrono::milliseconds(*remaining));
+    }
+
+    return ttl;
+}
+
+} // namespace redis
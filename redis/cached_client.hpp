@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+
+#include <boost/asio.hpp>
+
+#include "redis/client.hpp"
+#include "redis/command.hpp"
+#include "redis/local_cache.hpp"
+#include "redis/reply.hpp"
+
+namespace redis {
+
+namespace asio = boost::asio;
+using boost::asio::awaitable;
+
+/**
+ * @brief Serves reads from a local_cache in front of a client, for data that
+ * may be a little stale. Unlike the near cache, the server is not told what
+ * is cached: a reply is served until its TTL runs out, even if another client
+ * changed the key. Writes sent through the cached client drop the entries of
+ * their keys, and the replies of reads of those keys that were in flight.
+ *
+ * The TTL of a reply is the TTL of its key prefix, capped by the PTTL of the
+ * key if use_pttl is set. Nil replies and reads of missing keys are cached
+ * for negative_ttl.
+ */
+class cached_client {
+
+  public:
+    /**
+     * @brief Creates a cached client.
+     * @param client The client that reads are sent to on a miss. Must
+     * outlive the cached client.
+     * @param config The configuration of the cache.
+     */
+    explicit cached_client(client& client,
+                           local_cache_config config = local_cache_config());
+
+    cached_client(const cached_client&) = delete;
+    cached_client& operator=(const cached_client&) = delete;
+
+    /**
+     * @brief Answers cacheable reads from the cache and sends everything else
+     * to the client.
+     * @param command The command to send to the server.
+     * @returns The reply from the cache or the server.
+     */
+    [[nodiscard]] awaitable<reply> send(command command);
+
+    /**
+     * @brief Returns the cache.
+     */
+    local_cache& cache();
+
+    /**
+     * @brief Returns the counters of the cache.
+     */
+    local_cache_metrics metrics() const;
+
+  private:
+    /**
+     * @brief Reads the command from the server and caches the reply.
+     */
+    [[nodiscard]] awaitable<reply> read_through(command command, string key,
+                                                string id);
+
+    /**
+     * @brief Returns how long a reply may be served.
+     * @param key The key the command read.
+     * @param reply The reply of the command.
+     * @param pttl The reply of PTTL for the key, nil if it was not read.
+     */
+    std::chrono::milliseconds ttl_for(const string& key, const reply& reply,
+                                      const redis::reply& pttl) const;
+
+  private:
+    /// The client that reads and writes are sent to.
+    client& client_;
+
+    /// The cached replies.
+    local_cache cache_;
+};
+
+} // namespace redis
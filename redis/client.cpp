@@ -1,76 +1,573 @@
 #include "redis/client.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <exception>
+#include <random>
 
 #include <absl/cleanup/cleanup.h>
 
+#include "redis/commands-ttl.hpp"
+#include "redis/commands.hpp"
+
 namespace redis {
 
+namespace {
+
+/// Deletes the lock of get_or_compute() only if it still holds the token, so
+/// a holder that outlived the lock does not release the lock of another.
+constexpr std::string_view release_lock_script =
+    "if redis.call('GET', KEYS[1]) == ARGV[1] then "
+    "return redis.call('DEL', KEYS[1]) end return 0";
+
+/// How often get_or_compute() checks for a value computed by another caller.
+constexpr auto compute_poll_interval = 10ms;
+
+/// The number of bytes requested from a connection by each read.
+constexpr size_t read_chunk_size = 4096;
+
+/// Returns a generator seeded once per thread.
+std::mt19937_64& random_engine() {
+    thread_local std::mt19937_64 engine(std::random_device{}());
+    return engine;
+}
+
+} // namespace
+
 client::client(cpool::net::any_io_executor exec, client_config config)
     : exec_(std::move(exec))
     , config_(config)
+    , tls_context_(make_tls_context(config_))
     , con_pool_(nullptr)
+    , replicas_()
+    , read_balancer_(config_.replica_read_policy)
+    , hedges_in_flight_(0)
+    , flights_()
+    , flights_mutex_()
+    , coalesced_reads_(0)
+    , near_cache_(nullptr)
+    , invalidations_(nullptr)
+    , tracking_redirect_(0)
+    , tracking_(false)
+    , tracking_lost_(false)
+    , tracking_timer_(exec_)
+    , tracking_latch_(exec_, 1)
+    , keep_alive_timer_(exec_)
+    , keep_alive_(false)
+    , keep_alive_latch_(exec_, 1)
     , on_log_(nullptr) {
 
-    con_pool_ = std::make_unique<cpool::connection_pool<cpool::tcp_connection>>(
-        exec_, std::bind(&client::connection_ctor, this),
-        config_.max_connections);
+    con_pool_ = make_pool();
+    make_replicas();
+    make_near_cache();
 }
 
 client::client(cpool::net::any_io_executor exec, string host, uint16_t port)
     : exec_(std::move(exec))
     , config_()
+    , tls_context_(nullptr)
     , con_pool_(nullptr)
+    , replicas_()
+    , read_balancer_()
+    , hedges_in_flight_(0)
+    , flights_()
+    , flights_mutex_()
+    , coalesced_reads_(0)
+    , near_cache_(nullptr)
+    , invalidations_(nullptr)
+    , tracking_redirect_(0)
+    , tracking_(false)
+    , tracking_lost_(false)
+    , tracking_timer_(exec_)
+    , tracking_latch_(exec_, 1)
+    , keep_alive_timer_(exec_)
+    , keep_alive_(false)
+    , keep_alive_latch_(exec_, 1)
     , on_log_(nullptr) {
 
     config_.host = host;
     config_.port = port;
 
-    con_pool_ = std::make_unique<cpool::connection_pool<cpool::tcp_connection>>(
-        exec_, std::bind(&client::connection_ctor, this),
-        config_.max_connections);
+    con_pool_ = make_pool();
 }
 
 void client::set_config(client_config config) {
-    config_ = config;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        config_ = config;
+        tls_context_ = make_tls_context(config_);
+    }
 
-    con_pool_ = std::make_unique<cpool::connection_pool<cpool::tcp_connection>>(
-        exec_, std::bind(&client::connection_ctor, this),
-        config_.max_connections);
+    auto pool = make_pool();
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        con_pool_ = std::move(pool);
+    }
+
+    read_balancer_ = read_balancer(config.replica_read_policy);
+    make_replicas();
+    make_near_cache();
+}
+
+void client::make_near_cache() {
+    near_cache_.reset();
+    if (!config_.near_cache_regions.empty()) {
+        near_cache_ = std::make_unique<near_cache>(config_.near_cache_regions);
+    } else if (config_.near_cache_max_bytes > 0) {
+        near_cache_ =
+            std::make_unique<near_cache>(config_.near_cache_max_bytes);
+    }
+}
+
+void client::make_replicas() {
+    replicas_.clear();
+    if (config_.replica_read_policy == read_policy::master) {
+        return;
+    }
+
+    for (const auto& address : config_.replicas) {
+        auto replica_config = config_;
+        replica_config.host = address.host;
+        replica_config.port = address.port;
+        replica_config.unix_socket.clear();
+        replica_config.replicas.clear();
+        replica_config.replica_read_policy = read_policy::master;
+
+        auto replica = std::make_unique<client::replica>();
+        replica->server = std::make_unique<client>(exec_, replica_config);
+        replica->server->set_logging_handler(on_log_);
+        replicas_.push_back(std::move(replica));
+    }
 }
 
-client_config client::config() const { return config_; }
+client_config client::config() const {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    return config_;
+}
+
+void client::repoint(string host, uint16_t port) {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        if (config_.host == host && config_.port == port &&
+            config_.unix_socket.empty()) {
+            return;
+        }
+
+        log_message(log_level::info,
+                    fmt::format("repointing from {}:{} to {}:{}", config_.host,
+                                config_.port, host, port));
+        config_.host = host;
+        config_.port = port;
+        config_.unix_socket.clear();
+        if (config_.use_tls && config_.tls_server_name.empty()) {
+            // sessions of the old server can not be resumed on the new one
+            tls_context_ = make_tls_context(config_);
+        }
+    }
+
+    if (near_cache_ && tracking_) {
+        // the invalidation subscriber stays on the old server, so it is
+        // stopped and watch_invalidations() starts one on the new server
+        suspend_tracking("the client was repointed");
+        std::shared_ptr<redis_subscriber> old;
+        {
+            std::lock_guard<std::mutex> lock(tracking_mutex_);
+            if (tracking_ && !tracking_lost_.exchange(true)) {
+                old = invalidations_;
+            }
+        }
+        if (old) {
+            co_spawn(exec_, stop_invalidations(std::move(old)), detached);
+        }
+    }
+
+    reset_pool();
+}
+
+void client::reset_pool() {
+    // requests holding a connection of the old pool keep it alive until they
+    // return it, everyone else moves to the new pool
+    auto pool = make_pool();
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        std::swap(con_pool_, pool);
+    }
+}
 
 awaitable<reply> client::ping() { return send(command("PING")); }
 
+awaitable<cpool::error> client::warm_up() {
+    cpool::error tracking_error;
+    if (near_cache_) {
+        // connections opened from here on are tracked
+        tracking_error = co_await start_tracking();
+    }
+
+    auto num_connections =
+        std::min(config_.min_idle_connections, config_.max_connections);
+    log_message(log_level::debug,
+                fmt::format("warming up {} connections", num_connections));
+
+    auto error = co_await ping_connections(num_connections);
+    if (error) {
+        log_message(log_level::error,
+                    fmt::format("warm up failed: {}", error.message()));
+    } else {
+        error = tracking_error;
+    }
+
+    // a replica that fails to warm up is skipped by reads for a while, so
+    // only the master decides the result
+    for (auto& replica : replicas_) {
+        auto replica_error = co_await replica->server->warm_up();
+        if (replica_error) {
+            replica->stats.mark_down();
+        }
+    }
+
+    bool expected = false;
+    if (config_.idle_ping_interval.count() > 0 &&
+        keep_alive_.compare_exchange_strong(expected, true)) {
+        co_spawn(exec_, std::bind(&client::keep_alive, this), detached);
+    }
+
+    co_return error;
+}
+
+awaitable<void> client::stop() {
+    bool tracking = false;
+    std::shared_ptr<redis_subscriber> invalidations;
+    {
+        // no subscriber is started after this
+        std::lock_guard<std::mutex> lock(tracking_mutex_);
+        tracking = tracking_.exchange(false);
+        invalidations = invalidations_;
+    }
+    if (tracking) {
+        tracking_timer_.cancel();
+        co_await invalidations->stop();
+        co_await tracking_latch_.wait();
+    }
+
+    asio::steady_timer timer(exec_);
+    while (hedges_in_flight_ > 0) {
+        cpool::error_code ec;
+        timer.expires_after(1ms);
+        co_await timer.async_wait(
+            asio::redirect_error(asio::use_awaitable, ec));
+    }
+
+    for (auto& replica : replicas_) {
+        co_await replica->server->stop();
+    }
+
+    bool expected = true;
+    if (!keep_alive_.compare_exchange_strong(expected, false)) {
+        co_return;
+    }
+
+    keep_alive_timer_.cancel();
+    co_await keep_alive_latch_.wait();
+}
+
+bool client::connection_failed(const std::error_code& error) {
+    return (error == client_error_code::write_error ||
+            error == client_error_code::read_error);
+}
+
 // Send Commands
+struct client::pending_reply {
+    explicit pending_reply(cpool::net::any_io_executor exec)
+        : strand(asio::make_strand(exec))
+        , done(strand)
+        , result()
+        , mutex() {}
+
+    /// Serializes the operations on done.
+    asio::strand<cpool::net::any_io_executor> strand;
+
+    /// Expires when the reply arrives or the read should be hedged.
+    asio::steady_timer done;
+
+    /// The reply.
+    std::optional<redis::reply> result;
+
+    /// Guards result.
+    std::mutex mutex;
+};
+
+client::replica* client::select_replica(const replica* exclude) {
+    std::vector<replica*> candidates;
+    std::vector<const server_stats*> stats;
+    candidates.reserve(replicas_.size());
+    stats.reserve(replicas_.size());
+    for (const auto& replica : replicas_) {
+        if (replica.get() != exclude && replica->stats.available()) {
+            candidates.push_back(replica.get());
+            stats.push_back(&replica->stats);
+        }
+    }
+
+    if (candidates.empty()) {
+        return nullptr;
+    }
+    return candidates[read_balancer_.select(stats)];
+}
+
+awaitable<reply> client::read_from_replica(command command) {
+    auto* replica = select_replica();
+    if (replica == nullptr) {
+        // every replica is down, the caller reads from the master
+        co_return reply(client_error_code::disconnected);
+    }
+
+    if (config_.hedge_reads && replicas_.size() > 1) {
+        co_return co_await hedge_read(*replica, std::move(command));
+    }
+
+    co_return co_await read_from(*replica, std::move(command));
+}
+
+awaitable<reply> client::read_from(replica& replica, command command) {
+    replica.stats.begin();
+    auto start = std::chrono::steady_clock::now();
+    auto reply = co_await replica.server->send(std::move(command));
+    if (replica_unavailable(reply)) {
+        replica.stats.fail();
+    } else {
+        replica.stats.end(std::chrono::steady_clock::now() - start);
+    }
+
+    co_return reply;
+}
+
+awaitable<reply> client::hedge_read(replica& first, command command) {
+    auto percentile = first.stats.percentile(config_.hedge_percentile);
+    if (!percentile) {
+        // too few samples to know what slow means for this replica
+        co_return co_await read_from(first, std::move(command));
+    }
+
+    auto read = std::make_shared<pending_reply>(exec_);
+    cpool::error_code ec;
+    co_await asio::post(read->strand, asio::use_awaitable);
+    read->done.expires_after(std::max<std::chrono::steady_clock::duration>(
+        *percentile, config_.hedge_min_delay));
+
+    hedges_in_flight_++;
+    co_spawn(exec_, race_read(read, first, command), detached);
+    co_await read->done.async_wait(
+        asio::redirect_error(asio::use_awaitable, ec));
+
+    co_await asio::post(read->strand, asio::use_awaitable);
+    {
+        std::lock_guard<std::mutex> lock(read->mutex);
+        if (read->result) {
+            co_return *read->result;
+        }
+        read->done.expires_at(asio::steady_timer::time_point::max());
+    }
+
+    auto* second = select_replica(&first);
+    if (second != nullptr) {
+        log_message(log_level::trace,
+                    fmt::format("hedging {} after {}us", command.name(),
+                                percentile->count()));
+        hedges_in_flight_++;
+        co_spawn(exec_, race_read(read, *second, command), detached);
+    }
+    co_await read->done.async_wait(
+        asio::redirect_error(asio::use_awaitable, ec));
+
+    std::lock_guard<std::mutex> lock(read->mutex);
+    co_return *read->result;
+}
+
+awaitable<void> client::race_read(std::shared_ptr<pending_reply> read,
+                                  replica& replica, command command) {
+    auto reply = co_await read_from(replica, std::move(command));
+
+    bool first = false;
+    {
+        std::lock_guard<std::mutex> lock(read->mutex);
+        if (!read->result) {
+            read->result = std::move(reply);
+            first = true;
+        }
+    }
+
+    if (first) {
+        // wakes the request even if it is not waiting yet
+        asio::post(read->strand, [read]() {
+            read->done.expires_at(asio::steady_timer::time_point::min());
+        });
+    }
+
+    hedges_in_flight_--;
+}
+
+awaitable<replies> client::read_from_replica(commands commands) {
+    auto* replica = select_replica();
+    if (replica == nullptr) {
+        co_return redis::replies(commands.size(),
+                                 reply(client_error_code::disconnected));
+    }
+
+    replica->stats.begin();
+    auto start = std::chrono::steady_clock::now();
+    auto replies = co_await replica->server->send(std::move(commands));
+    if (std::any_of(replies.cbegin(), replies.cend(), replica_unavailable)) {
+        replica->stats.fail();
+    } else {
+        replica->stats.end(std::chrono::steady_clock::now() - start);
+    }
+
+    co_return replies;
+}
+
 awaitable<reply> client::send(command command) {
-    log_message(redis::log_level::trace,
-                fmt::format("getting connection - connections {} - idle {}",
-                            con_pool_->size(), con_pool_->size_idle()));
-    auto connection = co_await con_pool_->get_connection();
+    if (config_.coalesce_reads && command.read_only()) {
+        co_return co_await coalesce(std::move(command));
+    }
+
+    co_return co_await route(std::move(command));
+}
+
+awaitable<reply> client::coalesce(command command) {
+    auto key = command.serialized_command();
+    std::shared_ptr<pending_reply> flight;
+    bool leader = false;
+    {
+        std::lock_guard<std::mutex> lock(flights_mutex_);
+        auto it = flights_.find(key);
+        if (it != flights_.end()) {
+            flight = it->second;
+        } else {
+            flight = std::make_shared<pending_reply>(exec_);
+            flight->done.expires_at(asio::steady_timer::time_point::max());
+            flights_.emplace(key, flight);
+            leader = true;
+        }
+    }
+
+    if (leader) {
+        auto reply = co_await route(std::move(command));
+        {
+            // reads sent from now on may follow a write, so they start anew
+            std::lock_guard<std::mutex> lock(flights_mutex_);
+            flights_.erase(key);
+        }
+        {
+            std::lock_guard<std::mutex> lock(flight->mutex);
+            flight->result = reply;
+        }
+
+        asio::post(flight->strand, [flight]() {
+            flight->done.expires_at(asio::steady_timer::time_point::min());
+        });
+        co_return reply;
+    }
+
+    coalesced_reads_++;
+    cpool::error_code ec;
+    co_await asio::post(flight->strand, asio::use_awaitable);
+    {
+        std::lock_guard<std::mutex> lock(flight->mutex);
+        if (flight->result) {
+            co_return *flight->result;
+        }
+    }
+
+    co_await flight->done.async_wait(
+        asio::redirect_error(asio::use_awaitable, ec));
+
+    std::lock_guard<std::mutex> lock(flight->mutex);
+    co_return *flight->result;
+}
+
+awaitable<reply> client::route(command command) {
+    if (near_cache_ && tracking_redirect_ != 0 &&
+        near_cache::cacheable(command) &&
+        near_cache_->covers(command.keys().front())) {
+        co_return co_await read_through_cache(std::move(command));
+    }
+
+    if (!replicas_.empty() && command.read_only()) {
+        auto reply = co_await read_from_replica(command);
+        if (!replica_unavailable(reply)) {
+            co_return reply;
+        }
+
+        log_message(log_level::debug,
+                    fmt::format("reading {} from the master", command.name()));
+    }
+
+    co_return co_await send_to_master(std::move(command));
+}
+
+awaitable<reply> client::read_through_cache(command command) {
+    auto cached = near_cache_->lookup(command);
+    if (cached) {
+        co_return *cached;
+    }
+
+    // replicas do not track our connections, so fills read from the master
+    auto token = near_cache_->begin_fill(command);
+    auto reply = co_await send_to_master(command);
+    near_cache_->end_fill(command, token, reply);
+
+    co_return reply;
+}
+
+awaitable<reply> client::send_to_master(command command) {
+    pool_ptr pool;
+    auto connection = co_await get_connection(pool);
     if (connection == nullptr) {
         co_return reply(redis::client_error_code::client_stopped);
     }
 
     auto defer_release = absl::Cleanup([&]() {
         if (connection != nullptr) {
-            connection->expires_never();
-
-            con_pool_->release_connection(connection);
+            release_connection(*pool, connection);
         }
     });
 
     auto reply = co_await send(connection, command);
+    if (!connection_failed(reply.error())) {
+        co_return reply;
+    }
+
+    co_await evict(connection, reply.error().message());
+    if (!command.read_only()) {
+        co_return reply;
+    }
+
+    // the connection went stale while it was idle, retry on a fresh one
+    log_message(log_level::debug,
+                fmt::format("retrying {} on a new connection", command.name()));
+    if (!co_await replace_connection(pool, connection)) {
+        co_return reply;
+    }
+    reply = co_await send(connection, command);
 
     co_return reply;
 }
 
 awaitable<replies> client::send(commands commands) {
-    log_message(redis::log_level::trace,
-                fmt::format("getting connection - connections {} - idle {}",
-                            con_pool_->size(), con_pool_->size_idle()));
-    auto connection = co_await con_pool_->get_connection();
+    auto read_only = std::all_of(commands.cbegin(), commands.cend(),
+                                 [](const auto& c) { return c.read_only(); });
+    if (!replicas_.empty() && !commands.empty() && read_only) {
+        auto replies = co_await read_from_replica(commands);
+        if (std::none_of(replies.cbegin(), replies.cend(),
+                         replica_unavailable)) {
+            co_return replies;
+        }
+
+        log_message(log_level::debug, "reading pipeline from the master");
+    }
+
+    pool_ptr pool;
+    auto connection = co_await get_connection(pool);
     if (connection == nullptr) {
         co_return redis::replies(
             commands.size(),
@@ -79,18 +576,31 @@ awaitable<replies> client::send(commands commands) {
 
     auto defer_release = absl::Cleanup([&]() {
         if (connection != nullptr) {
-            connection->expires_never();
-
-            con_pool_->release_connection(connection);
+            release_connection(*pool, connection);
         }
     });
 
     auto replies = co_await send(connection, commands);
+    if (replies.empty() || !connection_failed(replies.front().error())) {
+        co_return replies;
+    }
+
+    co_await evict(connection, replies.front().error().message());
+    if (!read_only) {
+        co_return replies;
+    }
+
+    // the connection went stale while it was idle, retry on a fresh one
+    log_message(log_level::debug, "retrying pipeline on a new connection");
+    if (!co_await replace_connection(pool, connection)) {
+        co_return replies;
+    }
+    replies = co_await send(connection, commands);
 
     co_return replies;
 }
 
-awaitable<reply> client::send(cpool::tcp_connection* connection,
+awaitable<reply> client::send(connection* connection,
                               command command) {
     auto buffer = command.serialized_command();
     auto [write_error, bytes_written] =
@@ -99,19 +609,11 @@ awaitable<reply> client::send(cpool::tcp_connection* connection,
         co_return client_error_code::write_error;
     }
 
-    std::vector<uint8_t> read_buffer(4096);
-    auto [read_error, bytes_read] =
-        co_await connection->async_read_some(asio::buffer(read_buffer));
-    if (read_error || bytes_read == 0) {
-        co_return client_error_code::read_error;
-    }
-    reply reply;
-    reply.load_data(read_buffer.cbegin(), read_buffer.cbegin() + bytes_read);
-
-    co_return reply;
+    auto replies = co_await read_replies(connection, 1);
+    co_return replies.front();
 }
 
-awaitable<replies> client::send(cpool::tcp_connection* connection,
+awaitable<replies> client::send(connection* connection,
                                 commands commands) {
     std::string buffer;
     for (auto& command : commands) {
@@ -126,39 +628,246 @@ awaitable<replies> client::send(cpool::tcp_connection* connection,
             redis::reply{redis::client_error_code::write_error});
     }
 
-    std::vector<uint8_t> read_buffer(4096);
-    auto [read_error, bytes_read] =
-        co_await connection->async_read_some(asio::buffer(read_buffer));
-    if (read_error || bytes_read == 0) {
-        co_return redis::replies(
-            commands.size(),
-            redis::reply{redis::client_error_code::read_error});
-    }
+    co_return co_await read_replies(connection, commands.size());
+}
 
+awaitable<replies> client::read_replies(connection* connection,
+                                        size_t count) {
     redis::replies replies;
-    auto it = read_buffer.cbegin();
-    auto end = read_buffer.cbegin() + bytes_read;
-    while (it != end) {
-        redis::reply reply;
-        it = reply.load_data(it, end);
-        replies.push_back(reply);
+    std::vector<uint8_t> read_buffer;
+    size_t parsed = 0;
+    bool malformed = false;
+    while (replies.size() < count && !malformed) {
+        // read after the bytes of a reply that has not fully arrived
+        auto used = read_buffer.size();
+        read_buffer.resize(used + read_chunk_size);
+        auto [read_error, bytes_read] = co_await connection->async_read_some(
+            asio::buffer(read_buffer.data() + used, read_chunk_size));
+        read_buffer.resize(used + bytes_read);
+        if (read_error || bytes_read == 0) {
+            break;
+        }
+
+        auto it = read_buffer.cbegin() + parsed;
+        auto end = read_buffer.cend();
+        while (it != end && replies.size() < count) {
+            redis::reply reply;
+            auto next = reply.load_data(it, end);
+            if (reply.error() == parse_error_code::eof) {
+                break;
+            }
+            if (reply.error() == parse_error_code::malformed_message) {
+                malformed = true;
+                break;
+            }
+
+            it = next;
+            replies.push_back(reply);
+        }
+        parsed = it - read_buffer.cbegin();
+    }
+
+    if (replies.size() < count) {
+        // the unread replies would be taken for those of the next command.
+        // The callers evict the connection if the first reply failed.
+        if (!replies.empty()) {
+            co_await evict(connection, "incomplete pipeline reply");
+        }
+        replies.resize(count, redis::reply(client_error_code::read_error));
     }
 
     co_return replies;
 }
 
-std::unique_ptr<cpool::tcp_connection> client::connection_ctor() {
+awaitable<connection*> client::get_connection(pool_ptr& pool) {
+    pool = this->pool();
+    log_message(redis::log_level::trace,
+                fmt::format("getting connection - connections {} - idle {}",
+                            pool->size(), pool->size_idle()));
+    auto connection = co_await pool->get_connection();
+
+    // the client was repointed while we waited, move to the new pool
+    while (connection != nullptr && pool != this->pool()) {
+        pool->release_connection(connection);
+        pool = this->pool();
+        connection = co_await pool->get_connection();
+    }
+
+    if (connection == nullptr || connection->connected()) {
+        co_return connection;
+    }
+
+    // the connection was evicted while it was idle
+    auto error = co_await connection->async_connect();
+    if (error) {
+        log_message(log_level::error,
+                    fmt::format("could not reconnect to {0}: {1}",
+                                connection->endpoint(), error.message()));
+    }
+
+    co_return connection;
+}
+
+void client::release_connection(cpool::connection_pool<connection>& pool,
+                                connection* connection, bool used) {
+    if (used) {
+        connection->mark_idle();
+    }
+    connection->expires_never();
+    pool.release_connection(connection);
+}
+
+awaitable<bool> client::replace_connection(pool_ptr& pool,
+                                           connection*& connection) {
+    if (pool == this->pool()) {
+        auto error = co_await connection->async_connect();
+        co_return !error;
+    }
+
+    // the server moved, a connection of the new pool points at it
+    release_connection(*pool, connection);
+    connection = co_await get_connection(pool);
+    co_return (connection != nullptr && connection->connected());
+}
+
+client::pool_ptr client::pool() const {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    return con_pool_;
+}
+
+client::pool_ptr client::make_pool() {
+    return std::make_shared<cpool::connection_pool<connection>>(
+        exec_, std::bind(&client::connection_ctor, this),
+        config_.max_connections);
+}
+
+awaitable<void> client::evict(connection* connection, string_view reason) {
+    log_message(log_level::info,
+                fmt::format("evicting connection to {0}: {1}",
+                            connection->endpoint(), reason));
+    co_await connection->async_disconnect();
+}
+
+awaitable<cpool::error>
+client::ping_connections(unsigned int num_connections) {
+    cpool::error error;
+    if (num_connections == 0) {
+        co_return error;
+    }
+
+    std::atomic<unsigned int> keep = config_.min_idle_connections;
+    cpool::awaitable_latch established(exec_, num_connections);
+    cpool::awaitable_latch released(exec_, num_connections);
+    for (unsigned int i = 0; i < num_connections; i++) {
+        co_spawn(exec_,
+                 ping_connection(std::ref(established), std::ref(released),
+                                 std::ref(keep), std::ref(error)),
+                 detached);
+    }
+
+    co_await released.wait();
+    co_return error;
+}
+
+awaitable<void> client::ping_connection(cpool::awaitable_latch& established,
+                                        cpool::awaitable_latch& released,
+                                        std::atomic<unsigned int>& keep,
+                                        cpool::error& error) {
+    auto pool = this->pool();
+    auto connection = co_await pool->get_connection();
+    if (connection == nullptr) {
+        error = client_error_code::client_stopped;
+        established.count_down();
+        released.count_down();
+        co_return;
+    }
+
+    // claim one of the min_idle_connections slots if any are left
+    auto keep_count = keep.load();
+    while (keep_count > 0 &&
+           !keep.compare_exchange_weak(keep_count, keep_count - 1)) {
+    }
+    bool keep_connection = (keep_count > 0);
+
+    if (!connection->connected() && keep_connection) {
+        auto connect_error = co_await connection->async_connect();
+        if (connect_error) {
+            error = connect_error;
+        }
+    }
+
+    auto max_idle_time = config_.max_idle_time;
+    if (!connection->connected()) {
+        // already evicted
+    } else if (!keep_connection && max_idle_time.count() > 0 &&
+               connection->idle_time() > max_idle_time) {
+        co_await evict(connection, "idle timeout");
+    } else {
+        auto reply = co_await send(connection, command("PING"));
+        if (reply.error()) {
+            log_message(log_level::warn,
+                        fmt::format("ping of pooled connection failed: {}",
+                                    reply.error().message()));
+            error = reply.error();
+        }
+        if (connection_failed(reply.error())) {
+            co_await evict(connection, reply.error().message());
+        }
+    }
+
+    // keep the connection until every connection has been checked
+    established.count_down();
+    co_await established.wait();
+
+    // the PING does not count as a use, or no connection would ever idle out
+    release_connection(*pool, connection, false);
+    released.count_down();
+}
+
+awaitable<void> client::keep_alive() {
+    log_message(log_level::debug, "starting keep-alive");
 
-    auto conn = std::make_unique<cpool::tcp_connection>(exec_, config_.host,
-                                                        config_.port);
-    if (!config_.password.empty()) {
-        if (config_.username.empty()) {
-            config_.username = "default";
+    while (keep_alive_) {
+        cpool::error_code ec;
+        keep_alive_timer_.expires_after(config_.idle_ping_interval);
+        co_await keep_alive_timer_.async_wait(
+            asio::redirect_error(asio::use_awaitable, ec));
+        if (!keep_alive_ || ec == asio::error::operation_aborted) {
+            break;
         }
 
-        // login when a connection is created
-        conn->set_state_change_handler(std::bind(&client::auth_client, this,
-                                                 std::placeholders::_1,
+        // only touch the connections nobody is using, but top the pool back
+        // up to min_idle_connections and evict the rest if they are stale
+        auto pool = this->pool();
+        auto num_connections = std::max<size_t>(pool->size_idle(),
+                                                config_.min_idle_connections);
+        auto num_busy = pool->size() - pool->size_idle();
+        num_connections = std::min<size_t>(num_connections,
+                                           config_.max_connections - num_busy);
+        log_message(
+            log_level::trace,
+            fmt::format("pinging {} idle connections", num_connections));
+        co_await ping_connections(num_connections);
+    }
+
+    log_message(log_level::debug, "keep-alive stopped");
+    keep_alive_latch_.count_down();
+}
+
+std::unique_ptr<connection> client::connection_ctor() {
+    client_config config;
+    std::shared_ptr<tls_context> tls;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        config = config_;
+        tls = tls_context_;
+    }
+
+    auto conn = make_connection(exec_, config, tls);
+    if (!handshake_commands(config).empty() || near_cache_) {
+        // authenticate and configure when a connection is created
+        conn->set_state_change_handler(std::bind(&client::init_connection,
+                                                 this, std::placeholders::_1,
                                                  std::placeholders::_2));
     }
 
@@ -166,32 +875,32 @@ std::unique_ptr<cpool::tcp_connection> client::connection_ctor() {
 }
 
 [[nodiscard]] awaitable<cpool::error>
-client::on_connection_state_change(cpool::tcp_connection* conn,
+client::on_connection_state_change(connection* conn,
                                    const cpool::client_connection_state state) {
     switch (state) {
     case cpool::client_connection_state::disconnected:
-        log_message(log_level::info, fmt::format("disconnected from {0}:{1}",
-                                                 conn->host(), conn->port()));
+        log_message(log_level::info, fmt::format("disconnected from {0}",
+                                                 conn->endpoint()));
         break;
 
     case cpool::client_connection_state::resolving:
         log_message(log_level::info,
-                    fmt::format("resolving {0}", conn->host()));
+                    fmt::format("resolving {0}", conn->endpoint()));
         break;
 
     case cpool::client_connection_state::connecting:
-        log_message(log_level::info, fmt::format("connecting to {0}:{1}",
-                                                 conn->host(), conn->port()));
+        log_message(log_level::info, fmt::format("connecting to {0}",
+                                                 conn->endpoint()));
         break;
 
     case cpool::client_connection_state::connected:
-        log_message(log_level::info, fmt::format("connected to {0}:{1}",
-                                                 conn->host(), conn->port()));
+        log_message(log_level::info, fmt::format("connected to {0}",
+                                                 conn->endpoint()));
         break;
 
     case cpool::client_connection_state::disconnecting:
-        log_message(log_level::info, fmt::format("disconnecting from {0}:{1}",
-                                                 conn->host(), conn->port()));
+        log_message(log_level::info, fmt::format("disconnecting from {0}",
+                                                 conn->endpoint()));
         break;
 
     default:
@@ -204,21 +913,40 @@ client::on_connection_state_change(cpool::tcp_connection* conn,
 }
 
 awaitable<cpool::error>
-client::auth_client(cpool::tcp_connection* conn,
-                    const cpool::client_connection_state state) {
+client::init_connection(connection* conn,
+                        const cpool::client_connection_state state) {
+
+    if (state == cpool::client_connection_state::disconnected &&
+        tracking_redirect_ != 0 && !near_cache_->broadcast()) {
+        // the server forgets the keys the connection read, so they would no
+        // longer be invalidated
+        log_message(log_level::debug,
+                    "flushing the near cache, a tracked connection closed");
+        near_cache_->flush();
+    }
 
     if (state == cpool::client_connection_state::connected) {
-        auto username = this->config().username;
-        auto password = this->config().password;
-        auto loginCmd =
-            command(std::vector<std::string>{"AUTH", username, password});
+        auto handshake = connection_commands();
 
-        this->log_message(redis::log_level::trace, "AUTH password");
-        auto reply = co_await this->send(conn, loginCmd);
-        if (reply.error()) {
-            this->log_message(redis::log_level::error, reply.error().message());
+        this->log_message(redis::log_level::trace,
+                          fmt::format("sending {} init commands in one batch",
+                                      handshake.size()));
+        auto replies = co_await this->send(conn, handshake);
+        if (replies.size() != handshake.size()) {
+            this->log_message(redis::log_level::error,
+                              "init commands and replies do not match");
+            co_return client_error_code::response_command_mismatch;
+        }
+        for (size_t i = 0; i < replies.size(); i++) {
+            if (replies[i].error()) {
+                this->log_message(
+                    redis::log_level::error,
+                    fmt::format("{} failed: {}", handshake[i].name(),
+                                replies[i].value().as<std::string>().value_or(
+                                    replies[i].error().message())));
+                co_return replies[i].error();
+            }
         }
-        co_return reply.error();
     }
 
     auto error = co_await on_connection_state_change(conn, state);
@@ -233,12 +961,294 @@ client::auth_client(cpool::tcp_connection* conn,
 }
 
 void client::set_logging_handler(logging_handler handler) {
+    for (auto& replica : replicas_) {
+        replica->server->set_logging_handler(handler);
+    }
     on_log_ = std::move(handler);
 }
 
-bool client::running() const { return (con_pool_->size() != 0); }
+bool client::running() const { return (pool()->size() != 0); }
+
+tls_metrics client::handshake_metrics() const {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    return tls_context_ ? tls_context_->metrics() : tls_metrics();
+}
+
+awaitable<reply> client::get_or_compute(string key,
+                                        std::chrono::milliseconds ttl,
+                                        compute_function compute, double beta,
+                                        std::chrono::milliseconds lock_ttl) {
+    auto token = std::to_string(random_engine()());
+    auto lock = redis::set(key + ":lock", token,
+                           {"NX", "PX", std::to_string(lock_ttl.count())});
+    asio::steady_timer timer(exec_);
+    while (true) {
+        auto state = commands{redis::get(key), redis::pttl(key),
+                              redis::get(key + ":delta")};
+        auto replies = co_await send(std::move(state));
+        if (replies.size() != 3) {
+            co_return reply(client_error_code::error);
+        }
+
+        if (replies[0].error()) {
+            co_return replies[0];
+        }
+
+        bool cached = (replies[0].value().type() != redis_type::nil);
+        auto remaining = std::chrono::milliseconds(
+            replies[1].value().as<int64_t>().value_or(-2));
+        auto delta = std::chrono::milliseconds(
+            replies[2].value().as<int64_t>().value_or(0));
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        if (cached && !recompute_early(remaining, delta, beta,
+                                       1.0 - uniform(random_engine()))) {
+            co_return replies[0];
+        }
+
+        auto locked = co_await send(lock);
+        if (locked.error()) {
+            co_return locked;
+        }
+
+        if (locked.value().type() != redis_type::nil) {
+            co_return co_await recompute(key, ttl, compute, token);
+        }
+
+        if (cached) {
+            // another caller is already refreshing it
+            co_return replies[0];
+        }
+
+        timer.expires_after(compute_poll_interval);
+        cpool::error_code ec;
+        co_await timer.async_wait(
+            asio::redirect_error(asio::use_awaitable, ec));
+    }
+}
+
+awaitable<reply> client::recompute(const string& key,
+                                   std::chrono::milliseconds ttl,
+                                   const compute_function& compute,
+                                   const string& token) {
+    auto release = command(std::vector<std::string>{
+        "EVAL", string(release_lock_script), "1", key + ":lock", token});
+    auto start = std::chrono::steady_clock::now();
+    string value;
+    std::exception_ptr failure;
+    try {
+        value = co_await compute();
+    } catch (...) {
+        // co_await is not allowed in a handler
+        failure = std::current_exception();
+    }
+    if (failure) {
+        // the waiting callers must not sit out lock_ttl
+        co_await send(std::move(release));
+        std::rethrow_exception(failure);
+    }
+
+    auto delta = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    auto px = std::to_string(ttl.count());
+    auto store = commands{
+        redis::set(key, value, {"PX", px}),
+        redis::set(key + ":delta", std::to_string(delta.count()), {"PX", px}),
+        std::move(release)};
+    auto replies = co_await send(std::move(store));
+    if (replies.empty()) {
+        co_return reply(client_error_code::error);
+    }
+
+    if (replies[0].error()) {
+        co_return replies[0];
+    }
+
+    co_return reply(redis::value(value));
+}
+
+near_cache_metrics client::cache_metrics() const {
+    return near_cache_ ? near_cache_->metrics() : near_cache_metrics();
+}
+
+uint64_t client::coalesced_reads() const { return coalesced_reads_; }
 
 // Private functions
+commands client::connection_commands() const {
+    auto commands = handshake_commands(config());
+    auto redirect = tracking_redirect_.load();
+    if (redirect != 0 && !near_cache_->broadcast()) {
+        commands.push_back(command(std::vector<std::string>{
+            "CLIENT", "TRACKING", "ON", "REDIRECT", std::to_string(redirect)}));
+    }
+
+    return commands;
+}
+
+awaitable<cpool::error> client::start_tracking() {
+    bool expected = false;
+    if (!tracking_.compare_exchange_strong(expected, true)) {
+        co_return cpool::error();
+    }
+
+    invalidations_ = make_invalidations();
+    auto error = co_await enable_tracking();
+    if (error) {
+        // watch_invalidations() keeps trying, the near cache is bypassed
+        // until it succeeds
+        log_message(log_level::error,
+                    fmt::format("could not enable tracking: {}",
+                                error.message()));
+    }
+    co_spawn(exec_, std::bind(&client::watch_invalidations, this), detached);
+
+    co_return error;
+}
+
+awaitable<cpool::error> client::enable_tracking() {
+    // CLIENT ID must be sent before SUBSCRIBE puts the connection in pub/sub
+    // mode
+    auto error = co_await invalidations_->send(command("CLIENT ID"));
+    if (error) {
+        co_return error;
+    }
+
+    auto reply = co_await invalidations_->read();
+    auto id = reply.value().as<int64_t>();
+    if (reply.error() || !id) {
+        co_return reply.error() ? reply.error()
+                                : client_error_code::response_command_mismatch;
+    }
+
+    if (near_cache_->broadcast()) {
+        // the prefixes are tracked for the subscriber itself, so writes are
+        // announced once instead of once per pooled connection. Nested
+        // regions share the invalidations of their outermost prefix.
+        std::vector<std::string> tracking{"CLIENT",   "TRACKING",
+                                          "ON",       "REDIRECT",
+                                          std::to_string(*id), "BCAST"};
+        for (const auto& prefix : near_cache_->tracking_prefixes()) {
+            tracking.push_back("PREFIX");
+            tracking.push_back(prefix);
+        }
+
+        error = co_await invalidations_->send(command(tracking));
+        if (error) {
+            co_return error;
+        }
+
+        reply = co_await invalidations_->read();
+        if (reply.error()) {
+            co_return reply.error();
+        }
+    }
+
+    error = co_await invalidations_->subscribe(string(invalidation_channel));
+    if (error) {
+        co_return error;
+    }
+
+    reply = co_await invalidations_->read();
+    if (reply.error()) {
+        co_return reply.error();
+    }
+
+    tracking_redirect_ = *id;
+    if (!near_cache_->broadcast()) {
+        // connections opened before now are not tracked, or redirect to a
+        // connection that is gone
+        reset_pool();
+    }
+    near_cache_->flush();
+    log_message(log_level::info,
+                fmt::format("near cache tracking with redirect to {}", *id));
+
+    co_return cpool::error();
+}
+
+std::shared_ptr<redis_subscriber> client::make_invalidations() {
+    // a dropped invalidation would leave a stale entry in the cache
+    auto config = this->config();
+    config.subscriber_overflow = overflow_policy::block;
+    // tracking is enabled again with the new connection id instead
+    config.subscriber_resubscribe = false;
+    auto subscriber = std::make_shared<redis_subscriber>(exec_, config);
+    subscriber->set_logging_handler(on_log_);
+    subscriber->start();
+
+    return subscriber;
+}
+
+awaitable<void>
+client::stop_invalidations(std::shared_ptr<redis_subscriber> subscriber) {
+    co_await subscriber->stop();
+}
+
+awaitable<void> client::watch_invalidations() {
+    while (tracking_) {
+        if (tracking_lost_) {
+            // the client was repointed, follow it to the new server
+            std::lock_guard<std::mutex> lock(tracking_mutex_);
+            if (!tracking_) {
+                break;
+            }
+            invalidations_ = make_invalidations();
+            tracking_redirect_ = 0;
+            tracking_lost_ = false;
+        }
+
+        if (tracking_redirect_ == 0) {
+            auto error = co_await enable_tracking();
+            if (error) {
+                log_message(log_level::warn,
+                            fmt::format("could not enable tracking: {}",
+                                        error.message()));
+
+                cpool::error_code ec;
+                tracking_timer_.expires_after(1s);
+                co_await tracking_timer_.async_wait(
+                    asio::redirect_error(asio::use_awaitable, ec));
+                continue;
+            }
+        }
+
+        auto reply = co_await invalidations_->read();
+        if (reply.error() == client_error_code::disconnected) {
+            suspend_tracking("the invalidation subscriber disconnected");
+            continue;
+        }
+        if (reply.error() && tracking_lost_) {
+            // repoint() stopped the subscriber of the old server
+            continue;
+        }
+        if (reply.error()) {
+            // the subscriber was stopped
+            break;
+        }
+
+        auto invalidation = parse_invalidation(reply);
+        if (!invalidation) {
+            continue;
+        }
+
+        if (invalidation->flush) {
+            near_cache_->flush();
+        }
+        for (const auto& key : invalidation->keys) {
+            near_cache_->invalidate(key);
+        }
+    }
+
+    tracking_latch_.count_down();
+}
+
+void client::suspend_tracking(string_view reason) {
+    log_message(log_level::warn,
+                fmt::format("flushing the near cache: {}", reason));
+    tracking_redirect_ = 0;
+    near_cache_->flush();
+}
+
 
 void client::log_message(log_level level, string_view message) {
     if (on_log_) {
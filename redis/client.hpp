@@ -9,16 +9,22 @@
 #include <mutex>
 #include <queue>
 #include <string>
+#include <unordered_map>
 
 #include <boost/asio.hpp>
+#include <cpool/awaitable_latch.hpp>
 #include <cpool/connection_pool.hpp>
-#include <cpool/tcp_connection.hpp>
 
 #include "redis/client_config.hpp"
 #include "redis/command.hpp"
+#include "redis/connection.hpp"
+#include "redis/handshake.hpp"
 #include "redis/helper_functions.hpp"
+#include "redis/near_cache.hpp"
+#include "redis/read_balancer.hpp"
 #include "redis/reply.hpp"
 #include "redis/subscriber.hpp"
+#include "redis/tls_connection.hpp"
 #include "redis/types.hpp"
 #include "redis/value.hpp"
 
@@ -27,6 +33,9 @@ namespace redis {
 namespace asio = boost::asio;
 using boost::asio::awaitable;
 
+/// The function object that computes a value for get_or_compute().
+using compute_function = std::function<awaitable<std::string>()>;
+
 /**
  * @brief This class is used to coordinate communication with a Redis Server.
  */
@@ -72,8 +81,29 @@ class client : public enable_shared_from_this<client> {
      */
     [[nodiscard]] awaitable<reply> ping();
 
+    /**
+     * @brief Establishes and authenticates min_idle_connections connections
+     * so that the first requests do not pay for connection setup. Starts
+     * monitoring idle connections if idle_ping_interval is non-zero. Idle
+     * connections that fail a PING or exceed max_idle_time are evicted.
+     * If the near cache is configured, it starts tracking keys first; reads
+     * bypass the cache until then.
+     * @returns An error if any of the connections could not be established,
+     * or if tracking could not be enabled. Tracking is retried in the
+     * background in that case.
+     */
+    [[nodiscard]] awaitable<cpool::error> warm_up();
+
+    /**
+     * @brief Stops the background tasks started by warm_up(). This must be
+     * awaited before the client is destroyed if warm_up() was called.
+     */
+    awaitable<void> stop();
+
     /**
      * @brief Fetches a new connection and sends the command to the server.
+     * Read-only commands go to a replica if replicas and a read policy are
+     * configured, and to the master if the replica can not serve them.
      * @param command The command to send to the server.
      * @returns The reply from the server. This reply can include the requested
      * value or an error. Check for errors with `reply.error()`
@@ -82,12 +112,35 @@ class client : public enable_shared_from_this<client> {
 
     /**
      * @brief Fetches a new connection and sends the commands to the server.
+     * The pipeline goes to a replica if all the commands are read-only.
      * @param commands The commands to send to the server.
      * @returns The replies from the server. This reply can include the
      * requested value or an error.
      */
     [[nodiscard]] awaitable<replies> send(commands commands);
 
+    /**
+     * @brief Returns the value of a key, computing and storing it if it is
+     * missing. Values are recomputed shortly before they expire with XFetch,
+     * so readers do not all miss at once, and a lock taken with SET NX PX
+     * lets a single caller across all processes run compute at a time.
+     * Callers that find the value missing while it is locked wait for it.
+     * The compute time is stored in "<key>:delta" and the lock in
+     * "<key>:lock".
+     * @param key The key of the value.
+     * @param ttl How long a computed value is kept.
+     * @param compute Computes the value. If it throws, the lock is released
+     * and the exception is rethrown.
+     * @param beta Values above 1 favor earlier recomputation.
+     * @param lock_ttl How long the lock is held at most, in case its holder
+     * never releases it.
+     * @returns The value, or an error.
+     */
+    [[nodiscard]] awaitable<reply>
+    get_or_compute(string key, std::chrono::milliseconds ttl,
+                   compute_function compute, double beta = 1.0,
+                   std::chrono::milliseconds lock_ttl = 10s);
+
     /**
      * @brief Sets the callback to be executed when an error message is
      * generated.
@@ -99,14 +152,186 @@ class client : public enable_shared_from_this<client> {
      */
     bool running() const;
 
+    /**
+     * @brief Points the client at another server, e.g. the new master after a
+     * failover. Requests that are waiting for a connection move to the new
+     * server; requests already running on the old server finish there.
+     * @param host The IP Address or hostname of the server.
+     * @param port The remote port on which the server is listening.
+     */
+    void repoint(string host, uint16_t port);
+
+    /**
+     * @brief Returns the cost of the TLS handshakes made by the pooled
+     * connections. Empty if TLS is not used.
+     */
+    tls_metrics handshake_metrics() const;
+
+    /**
+     * @brief Returns the hit, miss and invalidation counts of the near cache.
+     * Empty if the near cache is disabled.
+     */
+    near_cache_metrics cache_metrics() const;
+
+    /**
+     * @brief Returns the number of reads that were answered with the reply of
+     * an identical read already in flight.
+     */
+    uint64_t coalesced_reads() const;
+
     // Event handlers
   private:
+    /// A replica that read-only commands are sent to.
+    struct replica {
+        /// The client connected to the replica.
+        std::unique_ptr<client> server;
+
+        /// The load and latency of the replica.
+        server_stats stats;
+    };
+
+    /**
+     * @brief Creates a client for each configured replica. Does nothing if
+     * the read policy is read_policy::master.
+     */
+    void make_replicas();
+
+    /// A reply that several coroutines wait for: the first reply of a hedged
+    /// read, or the reply of a coalesced read.
+    struct pending_reply;
+
+    /**
+     * @brief Picks the replica for the next read among those that are not
+     * marked down.
+     * @param exclude A replica that must not be picked, if any.
+     * @returns The replica, or nullptr if none is available.
+     */
+    replica* select_replica(const replica* exclude = nullptr);
+
+    /**
+     * @brief Sends a read-only command to a replica, hedged if hedge_reads is
+     * set.
+     */
+    [[nodiscard]] awaitable<reply> read_from_replica(command command);
+
+    /**
+     * @brief Sends a read-only command to the replica and records its
+     * latency, or marks it down if it could not serve the read.
+     */
+    [[nodiscard]] awaitable<reply> read_from(replica& replica,
+                                             command command);
+
+    /**
+     * @brief Sends a read-only command to a replica and, if it has not
+     * replied after hedge_percentile of its recent latencies, to a second
+     * one.
+     * @param first The replica that is asked first.
+     * @returns The first reply.
+     */
+    [[nodiscard]] awaitable<reply> hedge_read(replica& first,
+                                              command command);
+
+    /**
+     * @brief Sends one copy of a hedged read and stores the reply if it is
+     * the first.
+     */
+    [[nodiscard]] awaitable<void>
+    race_read(std::shared_ptr<pending_reply> read, replica& replica,
+              command command);
+
+    /**
+     * @brief Sends a read-only pipeline to a replica.
+     */
+    [[nodiscard]] awaitable<replies> read_from_replica(commands commands);
+
+    /**
+     * @brief Sends the command through the near cache, a replica or the
+     * master.
+     */
+    [[nodiscard]] awaitable<reply> route(command command);
+
+    /**
+     * @brief Sends a read-only command unless an identical one is in flight,
+     * in which case its reply is awaited instead.
+     */
+    [[nodiscard]] awaitable<reply> coalesce(command command);
+
+    /**
+     * @brief Runs compute, stores the value with its compute time and
+     * releases the lock if it is still held with the token. If compute
+     * throws, the lock is released and the exception is rethrown.
+     */
+    [[nodiscard]] awaitable<reply> recompute(const string& key,
+                                             std::chrono::milliseconds ttl,
+                                             const compute_function& compute,
+                                             const string& token);
+
+    /**
+     * @brief Sends the command to the master, retrying read-only commands on
+     * a fresh connection if the pooled one went stale.
+     */
+    [[nodiscard]] awaitable<reply> send_to_master(command command);
+
+    /**
+     * @brief Answers a cacheable read from the near cache, or reads it from
+     * the master and caches the reply.
+     */
+    [[nodiscard]] awaitable<reply> read_through_cache(command command);
+
+    /**
+     * @brief Subscribes to invalidations and starts the task that applies
+     * them to the near cache.
+     * @returns An error if tracking could not be enabled yet. The task keeps
+     * trying.
+     */
+    [[nodiscard]] awaitable<cpool::error> start_tracking();
+
+    /**
+     * @brief Creates the near cache if it is configured.
+     */
+    void make_near_cache();
+
+    /**
+     * @brief Gets the client ID of the invalidation subscriber and subscribes
+     * it to invalidation_channel. With regions the subscriber tracks their
+     * prefixes in broadcast mode; otherwise the pool is reopened so every
+     * connection redirects its invalidations there.
+     */
+    [[nodiscard]] awaitable<cpool::error> enable_tracking();
+
+    /**
+     * @brief Applies invalidations to the near cache until stop() is called.
+     * Tracking is re-enabled whenever the subscriber reconnects, and with a
+     * new subscriber after the client was repointed.
+     */
+    [[nodiscard]] awaitable<void> watch_invalidations();
+
+    /**
+     * @brief Creates and starts a subscriber for invalidations on the
+     * current server.
+     */
+    std::shared_ptr<redis_subscriber> make_invalidations();
+
+    /**
+     * @brief Stops the invalidation subscriber of the server the client was
+     * repointed from, which wakes watch_invalidations().
+     */
+    [[nodiscard]] static awaitable<void>
+    stop_invalidations(std::shared_ptr<redis_subscriber> subscriber);
+
+    /**
+     * @brief Drops the near cache and bypasses it until tracking is enabled
+     * again.
+     * @param reason Logged along with the flush.
+     */
+    void suspend_tracking(string_view reason);
+
     /**
      * @brief Used to send the command to the server.
      * @param connection The connection to use to connect to the server.
      * @param command The command to send to the server.
      */
-    [[nodiscard]] awaitable<reply> send(cpool::tcp_connection* connection,
+    [[nodiscard]] awaitable<reply> send(connection* connection,
                                         command command);
 
     /**
@@ -114,23 +339,134 @@ class client : public enable_shared_from_this<client> {
      * @param connection The connection to use to connect to the server.
      * @param command The command to send to the server.
      */
-    [[nodiscard]] awaitable<replies> send(cpool::tcp_connection* connection,
+    [[nodiscard]] awaitable<replies> send(connection* connection,
                                           commands commands);
 
+    /**
+     * @brief Reads the replies of commands written to a connection, reading
+     * again until every reply has fully arrived. If the connection fails or
+     * sends something that can not be parsed, the missing replies are
+     * client_error_code::read_error.
+     * @param connection The connection the commands were written to.
+     * @param count The number of replies to read.
+     */
+    [[nodiscard]] awaitable<replies> read_replies(connection* connection,
+                                                  size_t count);
+
+    /// A connection pool shared with the requests that use it.
+    using pool_ptr = std::shared_ptr<cpool::connection_pool<connection>>;
+
+    /**
+     * @brief Gets a connection from the current pool and reconnects it if it
+     * was evicted.
+     * @param pool Set to the pool the connection must be returned to.
+     * @returns The connection or nullptr if the pool has been stopped.
+     */
+    [[nodiscard]] awaitable<connection*> get_connection(pool_ptr& pool);
+
+    /**
+     * @brief Returns the connection to the pool and records when it was last
+     * used.
+     * @param used False for health checks, which must not make an idle
+     * connection look busy.
+     */
+    void release_connection(cpool::connection_pool<connection>& pool,
+                            connection* connection, bool used = true);
+
+    /**
+     * @brief Replaces a connection that failed so a request can be retried.
+     * The connection is reconnected, or swapped for one of the current pool
+     * if the client was repointed.
+     * @returns True if the connection is ready to use.
+     */
+    [[nodiscard]] awaitable<bool> replace_connection(pool_ptr& pool,
+                                                     connection*& connection);
+
+    /**
+     * @brief Returns the current pool.
+     */
+    pool_ptr pool() const;
+
+    /**
+     * @brief Creates a pool for the configured server.
+     */
+    pool_ptr make_pool();
+
+    /**
+     * @brief Replaces the pool so that every request after this uses a new
+     * connection.
+     */
+    void reset_pool();
+
+    /**
+     * @brief Returns the commands sent when a connection is established: the
+     * handshake and, while the near cache is tracking, CLIENT TRACKING.
+     */
+    commands connection_commands() const;
+
+    /**
+     * @brief Disconnects a connection that is dead or no longer wanted. The
+     * connection stays in the pool and is reconnected when it is next used.
+     * @param connection The connection to evict.
+     * @param reason Logged along with the eviction.
+     */
+    [[nodiscard]] awaitable<void> evict(connection* connection,
+                                        string_view reason);
+
+    /**
+     * @brief Acquires num_connections connections at the same time, checks
+     * each of them and returns them to the pool. Holding all of them at once
+     * forces the pool to create connections until num_connections exist.
+     * @param num_connections The number of connections to check.
+     * @returns The last error encountered, if any.
+     */
+    [[nodiscard]] awaitable<cpool::error>
+    ping_connections(unsigned int num_connections);
+
+    /**
+     * @brief Checks a single pooled connection on behalf of ping_connections.
+     * The first min_idle_connections connections are (re)connected and
+     * pinged. Any other connection is evicted if it has been idle for longer
+     * than max_idle_time. A connection that fails the PING is evicted.
+     * @param established Counted down once the connection has been checked.
+     * @param released Counted down once the connection is back in the pool.
+     * @param keep The number of connections that still need to be kept alive.
+     * @param error Set if the connection could not be acquired or pinged.
+     */
+    [[nodiscard]] awaitable<void>
+    ping_connection(cpool::awaitable_latch& established,
+                    cpool::awaitable_latch& released,
+                    std::atomic<unsigned int>& keep, cpool::error& error);
+
+    /**
+     * @brief Periodically checks the idle connections in the pool.
+     */
+    [[nodiscard]] awaitable<void> keep_alive();
+
+    /**
+     * @brief Returns true if the error indicates that the connection is dead.
+     */
+    static bool connection_failed(const std::error_code& error);
+
     /**
      * @brief Creates the connection object
      *
-     * @return std::unique_ptr<cpool::tcp_connection>
+     * @return std::unique_ptr<redis::connection>
      */
-    std::unique_ptr<cpool::tcp_connection> connection_ctor();
+    std::unique_ptr<connection> connection_ctor();
 
     [[nodiscard]] awaitable<cpool::error>
-    on_connection_state_change(cpool::tcp_connection* conn,
+    on_connection_state_change(connection* conn,
                                const cpool::client_connection_state state);
 
+    /**
+     * @brief Sends the handshake commands (AUTH/HELLO, CLIENT SETNAME, SELECT
+     * and init_commands) as one pipeline when a connection is established.
+     * @see handshake_commands
+     */
     [[nodiscard]] awaitable<cpool::error>
-    auth_client(cpool::tcp_connection* conn,
-                const cpool::client_connection_state state);
+    init_connection(connection* conn,
+                    const cpool::client_connection_state state);
 
     /**
      * @brief Logs the message using the on_log_ event hander.
@@ -146,8 +482,72 @@ class client : public enable_shared_from_this<client> {
     /// The configuration options of the client.
     client_config config_;
 
-    /// The connection to the server. @see cpool::tcp_connection.
-    std::unique_ptr<cpool::connection_pool<cpool::tcp_connection>> con_pool_;
+    /// The TLS state shared by the pooled connections so they resume each
+    /// other's sessions. nullptr if TLS is not used.
+    std::shared_ptr<tls_context> tls_context_;
+
+    /// The connections to the server. Replaced by repoint(), requests keep
+    /// the pool they took a connection from alive. @see redis::connection.
+    pool_ptr con_pool_;
+
+    /// Guards con_pool_, tls_context_ and the server in config_.
+    mutable std::mutex pool_mutex_;
+
+    /// The replicas that read-only commands are sent to. Empty if reads go to
+    /// the master.
+    std::vector<std::unique_ptr<replica>> replicas_;
+
+    /// Picks the replica for each read.
+    read_balancer read_balancer_;
+
+    /// The number of copies of hedged reads still running. stop() waits for
+    /// them since they outlive the request that sent them.
+    std::atomic<size_t> hedges_in_flight_;
+
+    /// The coalesced reads in flight, by serialized command.
+    std::unordered_map<std::string, std::shared_ptr<pending_reply>> flights_;
+
+    /// Guards flights_.
+    std::mutex flights_mutex_;
+
+    /// The number of reads answered by a read in flight.
+    std::atomic<uint64_t> coalesced_reads_;
+
+    /// The cached replies of reads. nullptr if the near cache is disabled.
+    std::unique_ptr<near_cache> near_cache_;
+
+    /// Receives the invalidations of the keys read by the pool. Shared with
+    /// the task that stops it after a repoint.
+    std::shared_ptr<redis_subscriber> invalidations_;
+
+    /// Guards replacing invalidations_ and clearing tracking_.
+    std::mutex tracking_mutex_;
+
+    /// The client ID of invalidations_ that tracking redirects to. Zero while
+    /// invalidations may be missed, which bypasses the near cache.
+    std::atomic<int64_t> tracking_redirect_;
+
+    /// Whether the invalidation task should continue running.
+    std::atomic_bool tracking_;
+
+    /// Set by repoint() until watch_invalidations() has replaced
+    /// invalidations_, which belongs to the old server.
+    std::atomic_bool tracking_lost_;
+
+    /// Used to wait between attempts to enable tracking.
+    asio::steady_timer tracking_timer_;
+
+    /// Counted down when the invalidation task exits.
+    cpool::awaitable_latch tracking_latch_;
+
+    /// Used to wake the keep-alive task between pings.
+    asio::steady_timer keep_alive_timer_;
+
+    /// Whether the keep-alive task should continue running.
+    std::atomic_bool keep_alive_;
+
+    /// Counted down when the keep-alive task exits.
+    cpool::awaitable_latch keep_alive_latch_;
 
     // event handlers
     /// Called when there is a call to log_message. Does nothing if set to
@@ -3,11 +3,84 @@
 #include <chrono>
 #include <string>
 #include <string_view>
+#include <vector>
+
+#include "redis/command.hpp"
 
 using namespace std::chrono_literals;
 
 namespace redis {
 
+/**
+ * @brief Where read-only commands are sent when replicas are configured.
+ */
+enum class read_policy : uint8_t {
+    /// All commands go to the master
+    master,
+
+    /// Reads rotate over the replicas
+    round_robin,
+
+    /// Reads go to the replica with the fewest requests in flight
+    least_outstanding,
+
+    /// Reads go to the replica with the lowest average latency
+    nearest,
+
+    /// Reads go to the replica with the lowest average latency weighted by
+    /// its requests in flight, so a replica that slows down sheds load
+    fastest
+};
+
+/**
+ * @brief What a subscriber does with a published message when its queue is
+ * full. Other replies, e.g. the confirmation of a subscription, always wait
+ * for room.
+ */
+enum class overflow_policy : uint8_t {
+    /// Stop reading from the socket until the consumer catches up. Nothing is
+    /// lost, but the server buffers the messages and may close the
+    /// connection when its output buffer limit is reached.
+    block,
+
+    /// Discard the oldest queued message to make room. Replies to commands,
+    /// e.g. subscription confirmations, are never discarded
+    drop_oldest,
+
+    /// Discard the message that did not fit
+    drop_newest,
+
+    /// Close the connection and queue a client_error_code::disconnected
+    /// reply, so the consumer can subscribe again once it caught up
+    disconnect
+};
+
+/**
+ * @brief The address of a server reached over TCP.
+ */
+struct server_address {
+    /// host The host name or IP address of the server
+    std::string host;
+
+    /// port The TCP port of the server
+    uint16_t port;
+};
+
+/**
+ * @brief A set of keys that the near cache tracks in broadcast mode.
+ */
+struct near_cache_region {
+    /// prefix The prefix of the keys, e.g. "user:".
+    std::string prefix;
+
+    /// max_bytes The estimated memory the entries of the region may use.
+    size_t max_bytes;
+
+    /// max_ttl How long an entry may be served without being read again from
+    /// the server. Zero keeps entries until they are invalidated or evicted.
+    std::chrono::milliseconds max_ttl;
+};
+
 /**
  * @brief Contains all the parameters to configure a RedisClient or a
  * RedisSubscriber
@@ -19,6 +92,30 @@ struct client_config {
     /// port The TCP port on which the server is listening
     uint16_t port;
 
+    /// unix_socket The path of a Unix domain socket. If set, it is used
+    /// instead of host and port.
+    std::string unix_socket;
+
+    /// use_tls Connect to host and port over TLS
+    bool use_tls;
+
+    /// tls_ca_file A PEM file with the certificate authorities used to verify
+    /// the server. Blank uses the system default paths.
+    std::string tls_ca_file;
+
+    /// tls_cert_file A PEM client certificate for mutual TLS. Optional.
+    std::string tls_cert_file;
+
+    /// tls_key_file The private key of tls_cert_file.
+    std::string tls_key_file;
+
+    /// tls_server_name The name sent with SNI and checked against the server
+    /// certificate. Blank uses host.
+    std::string tls_server_name;
+
+    /// tls_verify_peer Whether the server certificate is verified.
+    bool tls_verify_peer;
+
     /// max_connections The maximum number of connections in the connection pool
     unsigned int max_connections;
 
@@ -29,13 +126,125 @@ struct client_config {
     /// password Used for authentication with the redis server
     std::string password;
 
+    /// database The database that is selected when a connection is
+    /// established.
+    unsigned int database;
+
+    /// client_name The name given to each connection with CLIENT SETNAME.
+    /// Blank leaves the connections unnamed.
+    std::string client_name;
+
+    /// use_hello Authenticate and name connections with a single HELLO
+    /// command. Requires Redis 6 or later.
+    bool use_hello;
+
+    /// init_commands Additional commands sent after authentication each time
+    /// a connection is established.
+    commands init_commands;
+
+    /// min_idle_connections The number of connections that are established by
+    /// warm_up() and kept alive while the client is idle.
+    unsigned int min_idle_connections;
+
+    /// idle_ping_interval The interval at which idle connections are pinged to
+    /// keep them alive. A value of zero disables the keep-alive.
+    std::chrono::milliseconds idle_ping_interval;
+
+    /// max_idle_time Connections beyond min_idle_connections that have been
+    /// idle for longer than this are disconnected. A value of zero disables
+    /// idle eviction.
+    std::chrono::milliseconds max_idle_time;
+
+    /// cluster_max_redirects The number of MOVED or ASK redirects a cluster
+    /// client follows, and of TRYAGAIN or CLUSTERDOWN errors it retries
+    /// after a short delay, before it returns the error to the caller.
+    unsigned int cluster_max_redirects;
+
+    /// cluster_refresh_interval The interval at which a cluster client reloads
+    /// the slot map. A value of zero only reloads it after a MOVED redirect.
+    std::chrono::milliseconds cluster_refresh_interval;
+
+    /// replicas Replicas of the server that read-only commands may be sent
+    /// to. They share every other parameter with the master.
+    std::vector<server_address> replicas;
+
+    /// replica_read_policy How read-only commands are spread over the
+    /// replicas. A cluster client uses the replicas of each shard.
+    read_policy replica_read_policy;
+
+    /// hedge_reads Resend a read that is still pending after hedge_percentile
+    /// of the replica's recent latencies to a second replica, and use
+    /// whichever reply arrives first. Needs at least two replicas.
+    bool hedge_reads;
+
+    /// hedge_percentile The percentile of the replica's latency after which a
+    /// read is hedged, e.g. 0.95.
+    double hedge_percentile;
+
+    /// hedge_min_delay The shortest time a read waits before it is hedged.
+    std::chrono::milliseconds hedge_min_delay;
+
+    /// coalesce_reads Share the reply of a read-only command with every
+    /// identical command sent while it is in flight.
+    bool coalesce_reads;
+
+    /// near_cache_max_bytes The memory a client may use to cache the replies
+    /// of reads, kept coherent with CLIENT TRACKING. Zero disables the cache
+    /// unless near_cache_regions are set.
+    size_t near_cache_max_bytes;
+
+    /// near_cache_regions The key prefixes the near cache tracks with CLIENT
+    /// TRACKING BCAST, so the server does not remember every key that was
+    /// read. If set, only keys with one of the prefixes are cached and
+    /// near_cache_max_bytes is ignored.
+    std::vector<near_cache_region> near_cache_regions;
+
+    /// subscriber_queue_capacity The number of replies a subscriber holds
+    /// until they are read.
+    size_t subscriber_queue_capacity;
+
+    /// subscriber_overflow What a subscriber does with a message when its
+    /// queue is full.
+    overflow_policy subscriber_overflow;
+
+    /// subscriber_resubscribe Whether a subscriber restores its
+    /// subscriptions when it reconnects.
+    bool subscriber_resubscribe;
+
     /// Creates a configuration with default parameters
     client_config()
         : host("127.0.0.1")
         , port(6379)
+        , unix_socket()
+        , use_tls(false)
+        , tls_ca_file()
+        , tls_cert_file()
+        , tls_key_file()
+        , tls_server_name()
+        , tls_verify_peer(true)
         , max_connections(8)
         , username()
-        , password() {}
+        , password()
+        , database(0)
+        , client_name()
+        , use_hello(false)
+        , init_commands()
+        , min_idle_connections(0)
+        , idle_ping_interval(30s)
+        , max_idle_time(0ms)
+        , cluster_max_redirects(5)
+        , cluster_refresh_interval(30s)
+        , replicas()
+        , replica_read_policy(read_policy::master)
+        , hedge_reads(false)
+        , hedge_percentile(0.95)
+        , hedge_min_delay(1ms)
+        , coalesce_reads(false)
+        , near_cache_max_bytes(0)
+        , near_cache_regions()
+        , subscriber_queue_capacity(8)
+        , subscriber_overflow(overflow_policy::block)
+        , subscriber_resubscribe(true) {}
 
     /**
      * @brief Sets the host name of the server.
@@ -60,6 +269,75 @@ struct client_config {
         return *this;
     }
 
+    /**
+     * @brief Connects over a Unix domain socket instead of TCP.
+     * @param path The path of the socket, e.g. /var/run/redis/redis.sock
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_unix_socket(std::string path) {
+        this->unix_socket = path;
+        return *this;
+    }
+
+    /**
+     * @brief Sets whether connections use TLS.
+     * @param use_tls True to connect over TLS.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_tls(bool use_tls) {
+        this->use_tls = use_tls;
+        return *this;
+    }
+
+    /**
+     * @brief Sets the certificate authorities used to verify the server.
+     * @param ca_file A PEM file with one or more CA certificates.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_tls_ca_file(std::string ca_file) {
+        this->tls_ca_file = ca_file;
+        return *this;
+    }
+
+    /**
+     * @brief Sets the client certificate used for mutual TLS.
+     * @param cert_file A PEM file with the client certificate.
+     * @param key_file A PEM file with the private key of the certificate.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_tls_certificate(std::string cert_file,
+                                      std::string key_file) {
+        this->tls_cert_file = cert_file;
+        this->tls_key_file = key_file;
+        return *this;
+    }
+
+    /**
+     * @brief Sets the name used for SNI and certificate verification.
+     * @param server_name The expected name of the server.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_tls_server_name(std::string server_name) {
+        this->tls_server_name = server_name;
+        return *this;
+    }
+
+    /**
+     * @brief Sets whether the server certificate is verified.
+     * @param verify_peer False to accept any certificate.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_tls_verify_peer(bool verify_peer) {
+        this->tls_verify_peer = verify_peer;
+        return *this;
+    }
+
     /**
      * @brief Sets the maximum connections in the connection pool.
      * @param num_connections The max number of connections.
@@ -92,6 +370,225 @@ struct client_config {
         this->password = password;
         return *this;
     }
+
+    /**
+     * @brief Sets the database that is selected on each connection.
+     * @param database The index of the database.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_database(unsigned int database) {
+        this->database = database;
+        return *this;
+    }
+
+    /**
+     * @brief Sets the name given to each connection.
+     * @param client_name The name passed to CLIENT SETNAME.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_client_name(std::string client_name) {
+        this->client_name = client_name;
+        return *this;
+    }
+
+    /**
+     * @brief Sets whether connections are initialized with HELLO.
+     * @param use_hello True to authenticate and name connections with HELLO.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_use_hello(bool use_hello) {
+        this->use_hello = use_hello;
+        return *this;
+    }
+
+    /**
+     * @brief Adds a command to send each time a connection is established.
+     * @param command The command to send after authentication.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config add_init_command(command command) {
+        this->init_commands.push_back(std::move(command));
+        return *this;
+    }
+
+    /**
+     * @brief Sets the minimum number of idle connections in the connection
+     * pool.
+     * @param num_connections The number of connections to establish on
+     * warm_up(). This is capped at max_connections.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_min_idle_connections(unsigned int num_connections) {
+        this->min_idle_connections = num_connections;
+        return *this;
+    }
+
+    /**
+     * @brief Sets the interval at which idle connections are pinged.
+     * @param interval The time between pings. Zero disables the keep-alive.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_idle_ping_interval(std::chrono::milliseconds interval) {
+        this->idle_ping_interval = interval;
+        return *this;
+    }
+
+    /**
+     * @brief Sets how long a connection may stay idle before it is evicted.
+     * @param idle_time The maximum idle time. Zero disables idle eviction.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_max_idle_time(std::chrono::milliseconds idle_time) {
+        this->max_idle_time = idle_time;
+        return *this;
+    }
+
+    /**
+     * @brief Sets how many redirects a cluster client follows per command.
+     * @param max_redirects The maximum number of MOVED or ASK redirects.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_cluster_max_redirects(unsigned int max_redirects) {
+        this->cluster_max_redirects = max_redirects;
+        return *this;
+    }
+
+    /**
+     * @brief Sets how often a cluster client reloads the slot map.
+     * @param interval The refresh interval. Zero only refreshes after a MOVED
+     * redirect.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config
+    set_cluster_refresh_interval(std::chrono::milliseconds interval) {
+        this->cluster_refresh_interval = interval;
+        return *this;
+    }
+
+    /**
+     * @brief Adds a replica that read-only commands may be sent to.
+     * @param host The host name or IP address of the replica.
+     * @param port The TCP port of the replica.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config add_replica(std::string host, uint16_t port) {
+        this->replicas.push_back({std::move(host), port});
+        return *this;
+    }
+
+    /**
+     * @brief Sets how read-only commands are routed to replicas.
+     * @param policy The read policy. read_policy::master disables replica
+     * reads.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_read_policy(read_policy policy) {
+        this->replica_read_policy = policy;
+        return *this;
+    }
+
+    /**
+     * @brief Sets whether slow reads are hedged to a second replica.
+     * @param hedge_reads True to hedge reads.
+     * @param percentile The percentile of the replica's latency after which a
+     * read is hedged.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_hedge_reads(bool hedge_reads, double percentile = 0.95) {
+        this->hedge_reads = hedge_reads;
+        this->hedge_percentile = percentile;
+        return *this;
+    }
+
+    /**
+     * @brief Sets the shortest time a read waits before it is hedged.
+     * @param delay The minimum hedging delay.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_hedge_min_delay(std::chrono::milliseconds delay) {
+        this->hedge_min_delay = delay;
+        return *this;
+    }
+
+    /**
+     * @brief Sets whether identical concurrent reads share one request.
+     * @param coalesce_reads True to coalesce reads.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_coalesce_reads(bool coalesce_reads) {
+        this->coalesce_reads = coalesce_reads;
+        return *this;
+    }
+
+    /**
+     * @brief Enables the near cache of a client.
+     * @param max_bytes The estimated memory the cache may use. Zero disables
+     * the cache.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_near_cache(size_t max_bytes) {
+        this->near_cache_max_bytes = max_bytes;
+        return *this;
+    }
+
+    /**
+     * @brief Adds a key prefix to the near cache, which switches it to
+     * broadcast tracking.
+     * @param prefix The prefix of the keys to cache.
+     * @param max_bytes The estimated memory the keys of the prefix may use.
+     * @param max_ttl How long an entry may be served before it is read again.
+     * Zero keeps entries until they are invalidated or evicted.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config
+    add_near_cache_region(std::string prefix, size_t max_bytes,
+                          std::chrono::milliseconds max_ttl = 0ms) {
+        this->near_cache_regions.push_back(
+            {std::move(prefix), max_bytes, max_ttl});
+        return *this;
+    }
+
+    /**
+     * @brief Sets the queue of a subscriber.
+     * @param capacity The number of replies the queue holds.
+     * @param policy What is done with a message when the queue is full.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config
+    set_subscriber_queue(size_t capacity,
+                         overflow_policy policy = overflow_policy::block) {
+        this->subscriber_queue_capacity = capacity;
+        this->subscriber_overflow = policy;
+        return *this;
+    }
+
+    /**
+     * @brief Sets whether a subscriber restores its subscriptions when it
+     * reconnects.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    client_config set_subscriber_resubscribe(bool resubscribe) {
+        this->subscriber_resubscribe = resubscribe;
+        return *this;
+    }
 };
 
 } // namespace redis
\ No newline at end of file
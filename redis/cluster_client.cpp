@@ -0,0 +1,448 @@
+#include "redis/cluster_client.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "redis/node_pipeline.hpp"
+
+namespace redis {
+
+namespace {
+
+/// How long a command waits before it is resent after TRYAGAIN or
+/// CLUSTERDOWN.
+constexpr auto cluster_retry_delay = 50ms;
+
+} // namespace
+
+cluster_client::cluster_client(cpool::net::any_io_executor exec,
+                               client_config config)
+    : exec_(std::move(exec))
+    , config_(config)
+    , nodes_()
+    , slots_(num_hash_slots, nullptr)
+    , seed_(nullptr)
+    , read_balancer_(config_.replica_read_policy)
+    , topology_mutex_()
+    , refresh_timer_(exec_)
+    , refreshing_(false)
+    , refresh_latch_(exec_, 1)
+    , on_log_(nullptr) {
+
+    seed_ = get_node(cluster_node{config_.host, config_.port});
+}
+
+awaitable<cpool::error> cluster_client::start() {
+    bool expected = false;
+    if (!refreshing_.compare_exchange_strong(expected, true)) {
+        co_return cpool::error();
+    }
+
+    auto error = co_await refresh();
+
+    // keep refreshing even if the cluster is not reachable yet
+    co_spawn(exec_, std::bind(&cluster_client::refresh_loop, this), detached);
+
+    co_return error;
+}
+
+awaitable<void> cluster_client::stop() {
+    bool expected = true;
+    if (refreshing_.compare_exchange_strong(expected, false)) {
+        refresh_timer_.cancel();
+        co_await refresh_latch_.wait();
+    }
+
+    std::vector<node_state*> nodes;
+    {
+        std::lock_guard<std::mutex> lock(topology_mutex_);
+        for (auto& [endpoint, node] : nodes_) {
+            nodes.push_back(node.get());
+        }
+    }
+
+    for (auto* node : nodes) {
+        co_await node->client->stop();
+    }
+}
+
+awaitable<cpool::error> cluster_client::refresh() {
+    // ask the seed first, then every other node we know of
+    std::vector<node_state*> candidates{seed_};
+    {
+        std::lock_guard<std::mutex> lock(topology_mutex_);
+        for (auto& [endpoint, node] : nodes_) {
+            if (node.get() != seed_) {
+                candidates.push_back(node.get());
+            }
+        }
+    }
+
+    for (auto* node : candidates) {
+        auto result = co_await node->client->send(command("CLUSTER SLOTS"));
+        auto ranges = parse_cluster_slots(result);
+        if (!ranges || ranges->empty()) {
+            log_message(log_level::warn,
+                        fmt::format("could not load slots from {}: {}",
+                                    node->node.endpoint(),
+                                    result.error().message()));
+            continue;
+        }
+
+        std::vector<node_state*> slots(num_hash_slots, nullptr);
+        std::vector<node_state*> owners;
+        std::unordered_map<node_state*, std::vector<node_state*>> replicas;
+        auto read_replicas =
+            (config_.replica_read_policy != read_policy::master);
+        for (auto& range : *ranges) {
+            if (range.master.host.empty()) {
+                range.master.host = node->node.host;
+            }
+
+            auto* owner = get_node(range.master);
+            std::fill(slots.begin() + range.first,
+                      slots.begin() + range.last + 1, owner);
+            owners.push_back(owner);
+
+            auto& owner_replicas = replicas[owner];
+            for (auto& replica : range.replicas) {
+                if (!read_replicas) {
+                    break;
+                }
+
+                if (replica.host.empty()) {
+                    replica.host = node->node.host;
+                }
+
+                auto* state = get_node(replica, true);
+                if (std::find(owner_replicas.begin(), owner_replicas.end(),
+                              state) == owner_replicas.end()) {
+                    owner_replicas.push_back(state);
+                    owners.push_back(state);
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(topology_mutex_);
+            slots_.swap(slots);
+            for (auto& [endpoint, state] : nodes_) {
+                auto it = replicas.find(state.get());
+                if (it != replicas.end()) {
+                    state->replicas = std::move(it->second);
+                } else {
+                    state->replicas.clear();
+                }
+            }
+        }
+        log_message(log_level::debug,
+                    fmt::format("loaded {} slot ranges from {}", ranges->size(),
+                                node->node.endpoint()));
+
+        // open the pools of nodes that joined while running
+        for (auto* owner : owners) {
+            if (refreshing_ && !owner->warmed_up.exchange(true)) {
+                co_await owner->client->warm_up();
+            }
+        }
+
+        co_return cpool::error();
+    }
+
+    co_return std::error_code(client_error_code::disconnected);
+}
+
+awaitable<reply> cluster_client::send(command command) {
+    auto* owner = route(command);
+    if (command.read_only()) {
+        auto* replica = select_replica(owner);
+        if (replica != nullptr) {
+            auto reply = co_await read_from(replica, command);
+            if (!replica_unavailable(reply)) {
+                co_return reply;
+            }
+
+            log_message(log_level::debug,
+                        fmt::format("reading {} from the master {}",
+                                    command.name(), owner->node.endpoint()));
+        }
+    }
+
+    co_return co_await send(owner, std::move(command));
+}
+
+awaitable<replies> cluster_client::send(commands commands) {
+    co_return co_await send_by_node(
+        exec_, commands,
+        [this](const command& command) { return route(command); },
+        [this](node_state* node, const redis::commands& group) {
+            return send_pipeline(node, group);
+        });
+}
+
+std::optional<cluster_node>
+cluster_client::node_for_slot(uint16_t slot) const {
+    std::lock_guard<std::mutex> lock(topology_mutex_);
+    if (slot >= slots_.size() || slots_[slot] == nullptr) {
+        return std::nullopt;
+    }
+
+    return slots_[slot]->node;
+}
+
+size_t cluster_client::size() const {
+    std::lock_guard<std::mutex> lock(topology_mutex_);
+    return nodes_.size();
+}
+
+void cluster_client::set_logging_handler(logging_handler handler) {
+    std::lock_guard<std::mutex> lock(topology_mutex_);
+    on_log_ = std::move(handler);
+    for (auto& [endpoint, node] : nodes_) {
+        node->client->set_logging_handler(on_log_);
+    }
+}
+
+cluster_client::node_state*
+cluster_client::get_node(const cluster_node& node, bool replica) {
+    std::lock_guard<std::mutex> lock(topology_mutex_);
+    auto endpoint = node.endpoint();
+    auto it = nodes_.find(endpoint);
+    if (it != nodes_.end()) {
+        return it->second.get();
+    }
+
+    auto config = config_;
+    config.host = node.host;
+    config.port = node.port;
+    config.unix_socket.clear();
+    config.replicas.clear();
+    config.replica_read_policy = read_policy::master;
+    if (replica) {
+        // a node that is later promoted keeps READONLY, which is harmless on
+        // a master, and a master that is demoted redirects reads with MOVED
+        config.add_init_command(command("READONLY"));
+    }
+
+    auto state = std::make_unique<node_state>();
+    state->node = node;
+    state->client = std::make_unique<redis::client>(exec_, config);
+    if (on_log_) {
+        state->client->set_logging_handler(on_log_);
+    }
+
+    auto* ptr = state.get();
+    nodes_.emplace(endpoint, std::move(state));
+    return ptr;
+}
+
+cluster_client::node_state*
+cluster_client::select_replica(node_state* master) {
+    if (read_balancer_.policy() == read_policy::master) {
+        return nullptr;
+    }
+
+    std::vector<node_state*> replicas;
+    {
+        std::lock_guard<std::mutex> lock(topology_mutex_);
+        for (auto* replica : master->replicas) {
+            // replicas that failed recently are skipped until they back off
+            if (replica->stats.available()) {
+                replicas.push_back(replica);
+            }
+        }
+    }
+    if (replicas.empty()) {
+        return nullptr;
+    }
+
+    std::vector<const server_stats*> stats;
+    stats.reserve(replicas.size());
+    for (auto* replica : replicas) {
+        stats.push_back(&replica->stats);
+    }
+
+    return replicas[read_balancer_.select(stats)];
+}
+
+awaitable<reply> cluster_client::read_from(node_state* replica,
+                                           command command) {
+    replica->stats.begin();
+    auto start = std::chrono::steady_clock::now();
+    auto reply = co_await send(replica, std::move(command));
+    if (replica_unavailable(reply)) {
+        replica->stats.fail();
+    } else {
+        replica->stats.end(std::chrono::steady_clock::now() - start);
+    }
+
+    co_return reply;
+}
+
+cluster_client::node_state* cluster_client::route(const command& command) {
+    auto keys = command.keys();
+
+    std::lock_guard<std::mutex> lock(topology_mutex_);
+    if (!keys.empty()) {
+        auto* owner = slots_[hash_slot(keys.front())];
+        if (owner != nullptr) {
+            return owner;
+        }
+    }
+
+    // the node that is asked will redirect us if it does not own the key
+    return seed_;
+}
+
+awaitable<reply> cluster_client::send(node_state* node, command command) {
+    bool asking = false;
+    reply result;
+
+    for (unsigned int i = 0; i <= config_.cluster_max_redirects; i++) {
+        if (asking) {
+            // ASKING only applies to the command that follows it
+            commands pipeline;
+            pipeline.push_back(redis::command("ASKING"));
+            pipeline.push_back(command);
+            auto replies = co_await node->client->send(pipeline);
+            result = (replies.size() == 2)
+                         ? replies[1]
+                         : reply(client_error_code::response_command_mismatch);
+        } else {
+            result = co_await node->client->send(command);
+        }
+
+        auto retry = parse_retry(result);
+        if (retry && i < config_.cluster_max_redirects) {
+            // a reshard or failover is in progress, it usually settles soon
+            if (*retry == cluster_retry::cluster_down) {
+                request_refresh();
+            }
+            log_message(log_level::trace,
+                        fmt::format("{} failed, retrying: {}", command.name(),
+                                    result.error().message()));
+
+            cpool::error_code ec;
+            asio::steady_timer timer(exec_, cluster_retry_delay);
+            co_await timer.async_wait(
+                asio::redirect_error(asio::use_awaitable, ec));
+            continue;
+        }
+
+        auto redirect = parse_redirect(result);
+        if (!redirect) {
+            // the node may have left the cluster
+            if (result.error() == client_error_code::write_error ||
+                result.error() == client_error_code::read_error) {
+                request_refresh();
+            }
+            co_return result;
+        }
+
+        if (redirect->node.host.empty()) {
+            redirect->node.host = node->node.host;
+        }
+        log_message(log_level::trace,
+                    fmt::format("{} {} redirected to {}", command.name(),
+                                redirect->ask ? "ASK" : "MOVED",
+                                redirect->node.endpoint()));
+
+        node = get_node(redirect->node);
+        asking = redirect->ask;
+        if (!asking) {
+            // the slot has a new owner, fix it now and reload the rest
+            {
+                std::lock_guard<std::mutex> lock(topology_mutex_);
+                slots_[redirect->slot] = node;
+            }
+            request_refresh();
+        }
+    }
+
+    co_return result;
+}
+
+awaitable<replies> cluster_client::send_pipeline(node_state* node,
+                                                const commands& commands) {
+    auto read_only = std::all_of(commands.cbegin(), commands.cend(),
+                                 [](const auto& c) { return c.read_only(); });
+    auto* replica = read_only ? select_replica(node) : nullptr;
+    if (replica != nullptr) {
+        replica->stats.begin();
+        auto start = std::chrono::steady_clock::now();
+        auto replies = co_await send_redirected(replica, commands);
+        if (std::none_of(replies.cbegin(), replies.cend(),
+                         replica_unavailable)) {
+            replica->stats.end(std::chrono::steady_clock::now() - start);
+            co_return replies;
+        }
+        replica->stats.fail();
+
+        log_message(log_level::debug,
+                    fmt::format("reading pipeline from the master {}",
+                                node->node.endpoint()));
+    }
+
+    co_return co_await send_redirected(node, commands);
+}
+
+awaitable<replies>
+cluster_client::send_redirected(node_state* node, const commands& commands) {
+    auto replies = co_await node->client->send(commands);
+    if (replies.size() != commands.size()) {
+        co_return replies;
+    }
+
+    // commands in the pipeline that hashed to another node or hit a reshard
+    // or failover were not executed
+    for (size_t i = 0; i < commands.size(); i++) {
+        if (parse_redirect(replies[i]) || parse_retry(replies[i])) {
+            replies[i] = co_await send(node, commands[i]);
+        }
+    }
+
+    co_return replies;
+}
+
+void cluster_client::request_refresh() {
+    if (!refreshing_) {
+        return;
+    }
+
+    // the refresh loop runs on exec_, so the timer is cancelled in place;
+    // a posted handler could outlive the client after stop()
+    refresh_timer_.cancel();
+}
+
+awaitable<void> cluster_client::refresh_loop() {
+    log_message(log_level::debug, "starting slot map refresh");
+
+    while (refreshing_) {
+        cpool::error_code ec;
+        if (config_.cluster_refresh_interval.count() > 0) {
+            refresh_timer_.expires_after(config_.cluster_refresh_interval);
+        } else {
+            refresh_timer_.expires_at(asio::steady_timer::time_point::max());
+        }
+
+        // cancelled by request_refresh() after a MOVED or by stop()
+        co_await refresh_timer_.async_wait(
+            asio::redirect_error(asio::use_awaitable, ec));
+        if (!refreshing_) {
+            break;
+        }
+
+        co_await refresh();
+    }
+
+    log_message(log_level::debug, "slot map refresh stopped");
+    refresh_latch_.count_down();
+}
+
+void cluster_client::log_message(log_level level, string_view message) {
+    if (on_log_) {
+        on_log_(level, message);
+    }
+}
+
+} // namespace redis
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <cpool/awaitable_latch.hpp>
+
+#include "redis/client.hpp"
+#include "redis/client_config.hpp"
+#include "redis/cluster_topology.hpp"
+#include "redis/command.hpp"
+#include "redis/hash_slot.hpp"
+#include "redis/read_balancer.hpp"
+#include "redis/reply.hpp"
+#include "redis/types.hpp"
+
+namespace redis {
+
+namespace asio = boost::asio;
+using boost::asio::awaitable;
+
+/**
+ * @brief A client for Redis Cluster. Commands are routed to the node that
+ * owns the hash slot of their first key, using one connection pool per node.
+ * MOVED and ASK redirects are followed and the slot map is refreshed in the
+ * background. If replica_read_policy is set, read-only commands go to the
+ * replicas of the owner, which are put in READONLY mode.
+ */
+class cluster_client {
+
+  public:
+    /**
+     * @brief Creates a cluster client.
+     * @param exec The Asio executor to use for event handling.
+     * @param config The configuration used for every node. host and port
+     * are the seed node used to discover the cluster.
+     */
+    cluster_client(cpool::net::any_io_executor exec, client_config config);
+
+    cluster_client(const cluster_client&) = delete;
+    cluster_client& operator=(const cluster_client&) = delete;
+
+    /**
+     * @brief Loads the slot map and starts refreshing it in the background.
+     * @returns An error if the slot map could not be loaded from any node.
+     */
+    [[nodiscard]] awaitable<cpool::error> start();
+
+    /**
+     * @brief Stops the background refresh and the clients of every node. This
+     * must be awaited before the cluster client is destroyed if start() was
+     * called.
+     */
+    awaitable<void> stop();
+
+    /**
+     * @brief Reloads the slot map with CLUSTER SLOTS from the first node that
+     * answers.
+     * @returns An error if no node returned a valid slot map.
+     */
+    [[nodiscard]] awaitable<cpool::error> refresh();
+
+    /**
+     * @brief Sends the command to the node that owns its key. Commands
+     * without a key go to any node.
+     * @param command The command to send to the server.
+     * @returns The reply from the server.
+     */
+    [[nodiscard]] awaitable<reply> send(command command);
+
+    /**
+     * @brief Splits the commands by hash slot and sends one pipeline to each
+     * node that owns one of the slots, all at the same time. MGET, DEL,
+     * EXISTS, TOUCH and UNLINK with keys in several slots are split into one
+     * command per slot and their replies are merged. Commands that are
+     * redirected are resent to their new owner individually.
+     * @param commands The commands to send to the server.
+     * @returns The replies from the server in the order of the commands.
+     */
+    [[nodiscard]] awaitable<replies> send(commands commands);
+
+    /**
+     * @brief Returns the node that owns the slot, if known.
+     */
+    std::optional<cluster_node> node_for_slot(uint16_t slot) const;
+
+    /**
+     * @brief Returns the number of nodes the client has connected to.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Sets the callback to be executed when an error message is
+     * generated. The callback is also used by the client of every node.
+     */
+    void set_logging_handler(logging_handler handler);
+
+  private:
+    /// A node and its connection pool
+    struct node_state {
+        cluster_node node;
+        std::unique_ptr<redis::client> client;
+        std::atomic_bool warmed_up{false};
+
+        /// The load and latency of the node, used to pick replicas.
+        server_stats stats;
+
+        /// The replicas of the node if it is a master. Guarded by
+        /// topology_mutex_.
+        std::vector<node_state*> replicas;
+    };
+
+    /**
+     * @brief Returns the state of the node, creating it if it is new.
+     * @param replica Whether connections to a new node are put in READONLY
+     * mode.
+     */
+    node_state* get_node(const cluster_node& node, bool replica = false);
+
+    /**
+     * @brief Picks the replica of master that serves the next read, skipping
+     * replicas that are marked down.
+     * @returns The replica, or nullptr if reads go to the master.
+     */
+    node_state* select_replica(node_state* master);
+
+    /**
+     * @brief Sends a read-only command to a replica and records its latency.
+     */
+    [[nodiscard]] awaitable<reply> read_from(node_state* replica,
+                                             command command);
+
+    /**
+     * @brief Returns the node that owns the key of the command, or any node
+     * if the command has no key or the owner is not known.
+     */
+    node_state* route(const command& command);
+
+    /**
+     * @brief Sends the command to the node, following up to
+     * cluster_max_redirects redirects.
+     */
+    [[nodiscard]] awaitable<reply> send(node_state* node, command command);
+
+    /**
+     * @brief Sends the commands in one pipeline to the node, or to one of its
+     * replicas if they are all read-only, and resends the ones that were
+     * redirected.
+     */
+    [[nodiscard]] awaitable<replies> send_pipeline(node_state* node,
+                                                   const commands& commands);
+
+    /**
+     * @brief Sends the commands in one pipeline to the node and resends the
+     * ones that were redirected.
+     */
+    [[nodiscard]] awaitable<replies>
+    send_redirected(node_state* node, const commands& commands);
+
+    /**
+     * @brief Wakes the background refresh so the slot map is reloaded.
+     */
+    void request_refresh();
+
+    /**
+     * @brief Reloads the slot map until stop() is called.
+     */
+    awaitable<void> refresh_loop();
+
+    /**
+     * @brief Sends a message to the logging handler, if set.
+     */
+    void log_message(log_level level, string_view message);
+
+  private:
+    /// The io_service that is used to schedule asynchronous events.
+    cpool::net::any_io_executor exec_;
+
+    /// The configuration options of the node clients.
+    client_config config_;
+
+    /// The nodes by endpoint. Nodes are kept until the client is destroyed so
+    /// the pointers in slots_ stay valid. Guarded by topology_mutex_.
+    std::unordered_map<std::string, std::unique_ptr<node_state>> nodes_;
+
+    /// The owner of each hash slot, nullptr if unknown. Guarded by
+    /// topology_mutex_.
+    std::vector<node_state*> slots_;
+
+    /// The node the cluster was discovered from.
+    node_state* seed_;
+
+    /// Picks the replica for each read.
+    read_balancer read_balancer_;
+
+    /// Guards nodes_, slots_ and the replicas of each node.
+    mutable std::mutex topology_mutex_;
+
+    /// Used to wake the refresh task.
+    asio::steady_timer refresh_timer_;
+
+    /// Whether the refresh task should continue running.
+    std::atomic_bool refreshing_;
+
+    /// Counted down when the refresh task exits.
+    cpool::awaitable_latch refresh_latch_;
+
+    // event handlers
+    /// Called when there is a call to log_message. Does nothing if set to
+    /// nullptr.
+    logging_handler on_log_;
+};
+
+} // namespace redis
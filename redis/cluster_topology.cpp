@@ -0,0 +1,145 @@
+#include "redis/cluster_topology.hpp"
+
+#include <charconv>
+
+#include "redis/hash_slot.hpp"
+
+namespace redis {
+
+namespace {
+
+/// Parses the [host, port, id, ...] entry of a node in CLUSTER SLOTS
+std::optional<cluster_node> parse_node(const value& value) {
+    auto fields = value.as<redis_array>();
+    if (!fields || fields->size() < 2) {
+        return std::nullopt;
+    }
+
+    auto host = (*fields)[0].as<string>();
+    auto port = (*fields)[1].as<int64_t>();
+    if (!host || !port || *port <= 0 || *port > UINT16_MAX) {
+        return std::nullopt;
+    }
+
+    return cluster_node{*host, static_cast<uint16_t>(*port)};
+}
+
+} // namespace
+
+std::string cluster_node::endpoint() const {
+    return host + ":" + std::to_string(port);
+}
+
+std::optional<cluster_redirect> parse_redirect(const reply& reply) {
+    if (reply.error() != client_error_code::error) {
+        return std::nullopt;
+    }
+
+    auto message = reply.value().as<error>();
+    if (!message) {
+        return std::nullopt;
+    }
+
+    // MOVED 3999 127.0.0.1:6381
+    std::string_view what = message->what();
+    cluster_redirect redirect;
+    if (what.starts_with("MOVED ")) {
+        redirect.ask = false;
+        what.remove_prefix(6);
+    } else if (what.starts_with("ASK ")) {
+        redirect.ask = true;
+        what.remove_prefix(4);
+    } else {
+        return std::nullopt;
+    }
+
+    auto space = what.find(' ');
+    auto colon = what.rfind(':');
+    if (space == std::string_view::npos || colon == std::string_view::npos ||
+        colon < space) {
+        return std::nullopt;
+    }
+
+    auto slot = what.substr(0, space);
+    auto [slot_end, slot_ec] =
+        std::from_chars(slot.data(), slot.data() + slot.size(), redirect.slot);
+    if (slot_ec != std::errc() || redirect.slot >= num_hash_slots) {
+        return std::nullopt;
+    }
+
+    auto port = what.substr(colon + 1);
+    auto [port_end, port_ec] = std::from_chars(
+        port.data(), port.data() + port.size(), redirect.node.port);
+    if (port_ec != std::errc() || redirect.node.port == 0) {
+        return std::nullopt;
+    }
+
+    redirect.node.host = std::string(what.substr(space + 1, colon - space - 1));
+
+    return redirect;
+}
+
+std::optional<cluster_retry> parse_retry(const reply& reply) {
+    if (reply.error() != client_error_code::error) {
+        return std::nullopt;
+    }
+
+    auto message = reply.value().as<error>();
+    if (!message) {
+        return std::nullopt;
+    }
+
+    std::string_view what = message->what();
+    if (what.starts_with("TRYAGAIN")) {
+        return cluster_retry::try_again;
+    }
+    if (what.starts_with("CLUSTERDOWN")) {
+        return cluster_retry::cluster_down;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<std::vector<slot_range>>
+parse_cluster_slots(const reply& reply) {
+    if (reply.error()) {
+        return std::nullopt;
+    }
+
+    auto entries = reply.value().as<redis_array>();
+    if (!entries) {
+        return std::nullopt;
+    }
+
+    // [[first, last, [host, port, id], [replica host, port, id], ...], ...]
+    std::vector<slot_range> ranges;
+    for (const auto& entry : *entries) {
+        auto fields = entry.as<redis_array>();
+        if (!fields || fields->size() < 3) {
+            return std::nullopt;
+        }
+
+        auto first = (*fields)[0].as<int64_t>();
+        auto last = (*fields)[1].as<int64_t>();
+        auto master = parse_node((*fields)[2]);
+        if (!first || !last || !master || *first < 0 || *first > *last ||
+            *last >= num_hash_slots) {
+            return std::nullopt;
+        }
+
+        slot_range range;
+        range.first = static_cast<uint16_t>(*first);
+        range.last = static_cast<uint16_t>(*last);
+        range.master = *master;
+        for (size_t i = 3; i < fields->size(); i++) {
+            if (auto replica = parse_node((*fields)[i])) {
+                range.replicas.push_back(*replica);
+            }
+        }
+        ranges.push_back(std::move(range));
+    }
+
+    return ranges;
+}
+
+} // namespace redis
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "redis/reply.hpp"
+
+namespace redis {
+
+/**
+ * @brief The address of a node in a Redis Cluster.
+ */
+struct cluster_node {
+    /// host The host name or IP of the node. Blank if the node did not
+    /// announce one; use the host of the node that was asked.
+    std::string host;
+
+    /// port The port of the node.
+    uint16_t port = 0;
+
+    /**
+     * @returns string The node as "host:port".
+     */
+    std::string endpoint() const;
+
+    bool operator==(const cluster_node& rhs) const = default;
+};
+
+/**
+ * @brief A range of hash slots and the nodes that serve it.
+ */
+struct slot_range {
+    /// first The first slot of the range.
+    uint16_t first = 0;
+
+    /// last The last slot of the range, inclusive.
+    uint16_t last = 0;
+
+    /// master The node that owns the slots.
+    cluster_node master;
+
+    /// replicas The replicas of master.
+    std::vector<cluster_node> replicas;
+};
+
+/**
+ * @brief A MOVED or ASK error returned by a cluster node.
+ */
+struct cluster_redirect {
+    /// ask True for ASK, which only redirects the next command. False for
+    /// MOVED, which means the slot has a new owner.
+    bool ask = false;
+
+    /// slot The slot of the key that was redirected.
+    uint16_t slot = 0;
+
+    /// node The node to send the command to.
+    cluster_node node;
+};
+
+/**
+ * @brief Parses a "MOVED <slot> <host>:<port>" or "ASK <slot> <host>:<port>"
+ * error.
+ * @returns The redirect, or nullopt if the reply is not a redirect.
+ */
+std::optional<cluster_redirect> parse_redirect(const reply& reply);
+
+/**
+ * @brief A transient error of a cluster node, after which the command may
+ * succeed if it is sent again.
+ */
+enum class cluster_retry : uint8_t {
+    /// TRYAGAIN: the keys of a multi-key command are being migrated.
+    try_again,
+
+    /// CLUSTERDOWN: the cluster is failing over or does not cover the slot.
+    cluster_down
+};
+
+/**
+ * @brief Parses a TRYAGAIN or CLUSTERDOWN error.
+ * @returns The kind of error, or nullopt for other replies.
+ */
+std::optional<cluster_retry> parse_retry(const reply& reply);
+
+/**
+ * @brief Parses the reply to CLUSTER SLOTS.
+ * @returns The slot ranges, or nullopt if the reply is malformed.
+ */
+std::optional<std::vector<slot_range>> parse_cluster_slots(const reply& reply);
+
+} // namespace redis
@@ -1,9 +1,58 @@
 #include "redis/command.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <string_view>
+#include <unordered_set>
+
 namespace redis {
 
 using string = std::string;
 
+namespace {
+
+/// Commands that do not modify the dataset
+const std::unordered_set<std::string_view> read_only_commands{
+    "BITCOUNT", "DBSIZE", "ECHO", "EXISTS", "GET", "GETBIT", "GETRANGE",
+    "HEXISTS", "HGET", "HGETALL", "HKEYS", "HLEN", "HMGET", "HSTRLEN", "HVALS",
+    "JSON.ARRLEN", "JSON.GET", "JSON.OBJKEYS", "JSON.OBJLEN", "JSON.STRLEN",
+    "JSON.TYPE", "KEYS", "LINDEX", "LLEN", "LRANGE", "MGET", "PING", "PTTL",
+    "SCAN", "SCARD", "SDIFF", "SINTER", "SISMEMBER", "SMEMBERS", "SMISMEMBER",
+    "SRANDMEMBER", "STRLEN", "SUNION", "TTL", "TYPE", "ZCARD", "ZCOUNT",
+    "ZRANGE", "ZRANGEBYSCORE", "ZRANK", "ZREVRANGE", "ZSCORE"};
+
+/// Commands that do not take a key
+const std::unordered_set<std::string_view> keyless_commands{
+    "ASKING", "AUTH", "CLIENT", "CLUSTER", "COMMAND", "CONFIG", "DBSIZE",
+    "DISCARD", "ECHO", "EXEC", "FLUSHALL", "FLUSHDB", "HELLO", "INFO", "KEYS",
+    "MULTI", "PING", "PSUBSCRIBE", "PUBLISH", "PUNSUBSCRIBE", "QUIT",
+    "RANDOMKEY", "READONLY", "READWRITE", "SCAN", "SCRIPT", "SELECT",
+    "SUBSCRIBE", "TIME", "UNSUBSCRIBE", "UNWATCH", "WAIT"};
+
+/// Commands whose arguments are all keys
+const std::unordered_set<std::string_view> all_keys_commands{
+    "DEL", "EXISTS", "MGET", "PFCOUNT", "SDIFF", "SINTER", "SUNION", "TOUCH",
+    "UNLINK", "WATCH"};
+
+/// Commands whose first two arguments are keys
+const std::unordered_set<std::string_view> two_keys_commands{
+    "BLMOVE", "BRPOPLPUSH", "COPY", "LMOVE", "RENAME", "RENAMENX", "RPOPLPUSH",
+    "SMOVE"};
+
+/// Returns the upper-cased first element of commands, or an empty string.
+string upper_name(const std::vector<string>& commands) {
+    if (commands.empty()) {
+        return string();
+    }
+
+    string name = commands[0];
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+    return name;
+}
+
+} // namespace
+
 command::command(string command) {
     auto it = command.begin();
     auto end = command.end();
@@ -39,15 +88,67 @@ command::command(string command) {
     if (!member.empty()) {
         commands_.push_back(member);
     }
+
+    name_ = upper_name(commands_);
 }
 
 command::command(std::vector<string> commands)
-    : commands_(std::move(commands)) {}
+    : commands_(std::move(commands))
+    , name_(upper_name(commands_)) {}
 
 bool command::empty() const { return commands_.empty(); }
 
 std::vector<string> command::commands() const { return commands_; }
 
+const string& command::name() const { return name_; }
+
+bool command::read_only() const { return read_only_commands.contains(name_); }
+
+std::vector<string> command::keys() const {
+    if (commands_.size() < 2) {
+        return {};
+    }
+
+    const auto& name = name_;
+    if (keyless_commands.contains(name)) {
+        return {};
+    }
+
+    if (all_keys_commands.contains(name)) {
+        return std::vector<string>(commands_.cbegin() + 1, commands_.cend());
+    }
+
+    if (name == "MSET" || name == "MSETNX") {
+        std::vector<string> keys;
+        for (size_t i = 1; i < commands_.size(); i += 2) {
+            keys.push_back(commands_[i]);
+        }
+        return keys;
+    }
+
+    if (name == "EVAL" || name == "EVALSHA") {
+        // EVAL script numkeys key [key ...] arg [arg ...]
+        size_t num_keys = 0;
+        try {
+            num_keys = std::stoul(commands_.at(2));
+        } catch (...) {
+            return {};
+        }
+        auto end = std::min(commands_.size(), 3 + num_keys);
+        if (end <= 3) {
+            return {};
+        }
+        return std::vector<string>(commands_.cbegin() + 3,
+                                   commands_.cbegin() + end);
+    }
+
+    if (two_keys_commands.contains(name) && commands_.size() > 2) {
+        return std::vector<string>{commands_[1], commands_[2]};
+    }
+
+    return std::vector<string>{commands_[1]};
+}
+
 string command::serialized_command() const {
     string retVal;
     if (empty()) {
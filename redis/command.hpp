@@ -37,6 +37,24 @@ class command {
      */
     std::vector<std::string> commands() const;
 
+    /**
+     * @returns string The upper-cased name of the command, e.g. "GET".
+     */
+    const std::string& name() const;
+
+    /**
+     * @returns bool True if the command only reads data from the server and
+     * can safely be sent more than once.
+     */
+    bool read_only() const;
+
+    /**
+     * @returns vector<string> The keys the command operates on, used to route
+     * the command to a cluster node. Empty for commands without keys such as
+     * PING or PUBLISH.
+     */
+    std::vector<std::string> keys() const;
+
     /**
      * @returns string A string that contains the command serialized into
      * RedisProtocol.
@@ -55,6 +73,10 @@ class command {
 
   private:
     std::vector<std::string> commands_;
+
+    /// The upper-cased first element of commands_, computed once because
+    /// routing and caching look it up on every send.
+    std::string name_;
 };
 
 /// Used for pipelining
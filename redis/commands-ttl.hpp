@@ -3,6 +3,7 @@
 #include "redis/command.hpp"
 #include "redis/types.hpp"
 
+#include <chrono>
 #include <string>
 
 namespace redis {
@@ -27,8 +28,8 @@ inline std::string to_string(ttl_param param) {
     }
 }
 
-command expire(string key, std::chrono::seconds time,
-               ttl_param param = ttl_param::None) {
+inline command expire(string key, std::chrono::seconds time,
+                      ttl_param param = ttl_param::None) {
     if (param == ttl_param::None) {
         return command(std::vector<std::string>{"EXPIRE", key,
                                                 std::to_string(time.count())});
@@ -38,8 +39,8 @@ command expire(string key, std::chrono::seconds time,
         "EXPIRE", key, std::to_string(time.count()), to_string(param)});
 }
 
-command expireat(string key, int64_t unix_time,
-                 ttl_param param = ttl_param::None) {
+inline command expireat(string key, int64_t unix_time,
+                        ttl_param param = ttl_param::None) {
     if (param == ttl_param::None) {
         return command(std::vector<std::string>{"EXPIREAT", key,
                                                 std::to_string(unix_time)});
@@ -48,12 +49,12 @@ command expireat(string key, int64_t unix_time,
     return command(std::vector<std::string>{"EXPIREAT", key, to_string(param)});
 }
 
-command persist(string key) {
+inline command persist(string key) {
     return command(std::vector<std::string>{"PERSIST", key});
 }
 
-command pexpire(string key, std::chrono::milliseconds time,
-                ttl_param param = ttl_param::None) {
+inline command pexpire(string key, std::chrono::milliseconds time,
+                       ttl_param param = ttl_param::None) {
     if (param == ttl_param::None) {
         return command(std::vector<std::string>{"PEXPIRE", key,
                                                 std::to_string(time.count())});
@@ -63,8 +64,8 @@ command pexpire(string key, std::chrono::milliseconds time,
         "PEXPIRE", key, std::to_string(time.count()), to_string(param)});
 }
 
-command pexpireat(string key, int64_t unix_time,
-                  ttl_param param = ttl_param::None) {
+inline command pexpireat(string key, int64_t unix_time,
+                         ttl_param param = ttl_param::None) {
     if (param == ttl_param::None) {
         return command(std::vector<std::string>{"PEXPIREAT", key,
                                                 std::to_string(unix_time)});
@@ -74,11 +75,11 @@ command pexpireat(string key, int64_t unix_time,
         std::vector<std::string>{"PEXPIREAT", key, to_string(param)});
 }
 
-command pttl(string key) {
+inline command pttl(string key) {
     return command(std::vector<std::string>{"PTTL", key});
 }
 
-command ttl(string key) {
+inline command ttl(string key) {
     return command(std::vector<std::string>{"TTL", key});
 }
 
@@ -0,0 +1,89 @@
+#include "redis/connection.hpp"
+
+#include "redis/tcp_connection.hpp"
+#include "redis/tls_connection.hpp"
+#include "redis/unix_connection.hpp"
+
+namespace redis {
+
+connection::connection(net::any_io_executor exec)
+    : exec_(std::move(exec))
+    , state_(cpool::client_connection_state::disconnected)
+    , idle_since_(std::chrono::steady_clock::now().time_since_epoch().count())
+    , on_state_change_(nullptr)
+    , state_timer_(exec_) {}
+
+net::any_io_executor connection::get_executor() const { return exec_; }
+
+bool connection::connected() const {
+    return (state_ == cpool::client_connection_state::connected);
+}
+
+cpool::client_connection_state connection::state() const { return state_; }
+
+void connection::expires_never() {}
+
+void connection::mark_idle() {
+    idle_since_ = std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+std::chrono::steady_clock::duration connection::idle_time() const {
+    return std::chrono::steady_clock::now().time_since_epoch() -
+           std::chrono::steady_clock::duration(idle_since_.load());
+}
+
+void connection::set_state_change_handler(
+    connection_state_change_handler handler) {
+    on_state_change_ = std::move(handler);
+}
+
+awaitable<void> connection::wait_for(cpool::client_connection_state state) {
+    while (state_ != state) {
+        cpool::error_code ec;
+        state_timer_.expires_at(net::steady_timer::time_point::max());
+        co_await state_timer_.async_wait(
+            net::redirect_error(net::use_awaitable, ec));
+    }
+}
+
+awaitable<cpool::error>
+connection::set_state(cpool::client_connection_state state) {
+    state_ = state;
+    state_timer_.cancel();
+
+    if (!on_state_change_) {
+        co_return cpool::error();
+    }
+
+    co_return co_await on_state_change_(this, state);
+}
+
+std::unique_ptr<connection>
+make_connection(net::any_io_executor exec, const client_config& config,
+                std::shared_ptr<tls_context> tls) {
+    if (!config.unix_socket.empty()) {
+        return std::make_unique<unix_connection>(std::move(exec),
+                                                 config.unix_socket);
+    }
+
+    if (config.use_tls) {
+        if (!tls) {
+            tls = make_tls_context(config);
+        }
+        return std::make_unique<tls_connection>(std::move(exec), config.host,
+                                                config.port, std::move(tls));
+    }
+
+    return std::make_unique<tcp_connection>(std::move(exec), config.host,
+                                            config.port);
+}
+
+std::shared_ptr<tls_context> make_tls_context(const client_config& config) {
+    if (!config.use_tls) {
+        return nullptr;
+    }
+
+    return std::make_shared<tls_context>(config);
+}
+
+} // namespace redis
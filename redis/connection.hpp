@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include <boost/asio.hpp>
+#include <cpool/tcp_connection.hpp>
+
+#include "redis/client_config.hpp"
+
+namespace redis {
+
+namespace net = boost::asio;
+using boost::asio::awaitable;
+
+class connection;
+class tls_context;
+
+/// The function object called when the state of a connection changes. An
+/// error returned when the state changes to connected fails the connection.
+using connection_state_change_handler = std::function<awaitable<cpool::error>(
+    connection*, const cpool::client_connection_state)>;
+
+/**
+ * @brief The transport used to talk to a Redis server. This allows the client
+ * and subscriber to use TCP, TLS or Unix domain sockets interchangeably.
+ */
+class connection {
+
+  public:
+    /**
+     * @brief Creates a disconnected connection.
+     * @param exec The Asio executor to use for event handling.
+     */
+    connection(net::any_io_executor exec);
+
+    connection(const connection&) = delete;
+    connection& operator=(const connection&) = delete;
+
+    virtual ~connection() = default;
+
+    /**
+     * @brief The executor used by this connection.
+     */
+    net::any_io_executor get_executor() const;
+
+    /**
+     * @brief A description of the remote endpoint, e.g. host:port or the path
+     * of the socket. Used for logging.
+     */
+    virtual std::string endpoint() const = 0;
+
+    /**
+     * @brief Returns whether or not the connection is established.
+     */
+    virtual bool connected() const;
+
+    /**
+     * @brief Returns the current state of the connection.
+     */
+    cpool::client_connection_state state() const;
+
+    /**
+     * @brief Connects to the server. Does nothing if already connected.
+     * @returns An error if the connection could not be established or the
+     * state change handler rejected it.
+     */
+    [[nodiscard]] virtual awaitable<cpool::error> async_connect() = 0;
+
+    /**
+     * @brief Disconnects from the server.
+     */
+    [[nodiscard]] virtual awaitable<cpool::error> async_disconnect() = 0;
+
+    /**
+     * @brief Writes the entire buffer to the server.
+     * @returns An error, if any, and the number of bytes written.
+     */
+    [[nodiscard]] virtual awaitable<std::tuple<cpool::error, std::size_t>>
+    async_write(net::const_buffer buffer) = 0;
+
+    /**
+     * @brief Reads whatever data is available into the buffer.
+     * @returns An error, if any, and the number of bytes read.
+     */
+    [[nodiscard]] virtual awaitable<std::tuple<cpool::error, std::size_t>>
+    async_read_some(net::mutable_buffer buffer) = 0;
+
+    /**
+     * @brief Cancels all pending reads and writes.
+     */
+    virtual cpool::error cancel() = 0;
+
+    /**
+     * @brief Removes any expiration set by the connection pool.
+     */
+    virtual void expires_never();
+
+    /**
+     * @brief Records that the connection was returned to its pool.
+     */
+    void mark_idle();
+
+    /**
+     * @brief Returns how long ago the connection was returned to its pool,
+     * or created if it never was.
+     */
+    std::chrono::steady_clock::duration idle_time() const;
+
+    /**
+     * @brief Sets the handler that is called each time the state changes.
+     */
+    void set_state_change_handler(connection_state_change_handler handler);
+
+    /**
+     * @brief Waits until the connection reaches the given state.
+     */
+    [[nodiscard]] awaitable<void>
+    wait_for(cpool::client_connection_state state);
+
+  protected:
+    /**
+     * @brief Updates the state, wakes anyone in wait_for and calls the state
+     * change handler.
+     * @returns The error returned by the state change handler.
+     */
+    [[nodiscard]] awaitable<cpool::error>
+    set_state(cpool::client_connection_state state);
+
+  private:
+    /// The io_service that is used to schedule asynchronous events.
+    net::any_io_executor exec_;
+
+    /// The current state of the connection.
+    std::atomic<cpool::client_connection_state> state_;
+
+    /// When the connection was last returned to its pool or created.
+    std::atomic<std::chrono::steady_clock::rep> idle_since_;
+
+    /// Called when the state changes. Does nothing if set to nullptr.
+    connection_state_change_handler on_state_change_;
+
+    /// Cancelled to wake coroutines in wait_for.
+    net::steady_timer state_timer_;
+};
+
+/**
+ * @brief Creates the connection described by the configuration: a Unix domain
+ * socket if unix_socket is set, TLS if use_tls is set, otherwise TCP.
+ * @param exec The Asio executor to use for event handling.
+ * @param config The configuration object.
+ * @param tls The TLS state shared by the connections. Required for TLS.
+ */
+std::unique_ptr<connection>
+make_connection(net::any_io_executor exec, const client_config& config,
+                std::shared_ptr<tls_context> tls = nullptr);
+
+/**
+ * @brief Creates the TLS state for the configuration.
+ * @returns nullptr if use_tls is not set.
+ */
+std::shared_ptr<tls_context> make_tls_context(const client_config& config);
+
+} // namespace redis
@@ -0,0 +1,107 @@
+#include "redis/consistent_hash.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include <openssl/evp.h>
+
+#include "redis/hash_slot.hpp"
+
+namespace redis {
+
+namespace {
+
+/**
+ * @brief The 64-bit finalizer of MurmurHash3. Spreads the slot numbers, which
+ * are small and consecutive, over the whole hash space.
+ */
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+} // namespace
+
+int32_t jump_consistent_hash(uint64_t key, int32_t num_buckets) {
+    int64_t bucket = -1;
+    int64_t next = 0;
+    while (next < num_buckets) {
+        bucket = next;
+        key = key * 2862933555777941757ULL + 1;
+        next = static_cast<int64_t>((bucket + 1) *
+                                    (static_cast<double>(1LL << 31) /
+                                     static_cast<double>((key >> 33) + 1)));
+    }
+
+    return static_cast<int32_t>(bucket);
+}
+
+ketama_ring::ketama_ring(const std::vector<std::string>& nodes,
+                         unsigned int points_per_node)
+    : points_() {
+
+    // every digest gives four points
+    points_.reserve(nodes.size() * points_per_node);
+    for (size_t node = 0; node < nodes.size(); node++) {
+        for (unsigned int i = 0; i < points_per_node / 4; i++) {
+            auto name = nodes[node] + "-" + std::to_string(i);
+
+            std::array<unsigned char, EVP_MAX_MD_SIZE> digest;
+            unsigned int size = 0;
+            EVP_Digest(name.data(), name.size(), digest.data(), &size,
+                       EVP_md5(), nullptr);
+
+            for (size_t p = 0; p < 4; p++) {
+                uint32_t point = (uint32_t(digest[p * 4 + 3]) << 24) |
+                                 (uint32_t(digest[p * 4 + 2]) << 16) |
+                                 (uint32_t(digest[p * 4 + 1]) << 8) |
+                                 uint32_t(digest[p * 4]);
+                points_.emplace_back(point, node);
+            }
+        }
+    }
+
+    std::sort(points_.begin(), points_.end());
+}
+
+size_t ketama_ring::node_for(uint32_t hash) const {
+    auto it = std::lower_bound(
+        points_.begin(), points_.end(), hash,
+        [](const auto& point, uint32_t value) { return point.first < value; });
+    if (it == points_.end()) {
+        // wrap around to the first point of the ring
+        it = points_.begin();
+    }
+
+    return it->second;
+}
+
+bool ketama_ring::empty() const { return points_.empty(); }
+
+std::vector<uint16_t> assign_slots(hash_algorithm algorithm,
+                                   const std::vector<std::string>& nodes) {
+    std::vector<uint16_t> slots(num_hash_slots, 0);
+    if (nodes.empty()) {
+        return slots;
+    }
+
+    if (algorithm == hash_algorithm::jump) {
+        auto num_nodes = static_cast<int32_t>(nodes.size());
+        for (uint16_t slot = 0; slot < num_hash_slots; slot++) {
+            slots[slot] = jump_consistent_hash(mix64(slot), num_nodes);
+        }
+    } else {
+        ketama_ring ring(nodes);
+        for (uint16_t slot = 0; slot < num_hash_slots; slot++) {
+            slots[slot] = ring.node_for(static_cast<uint32_t>(mix64(slot)));
+        }
+    }
+
+    return slots;
+}
+
+} // namespace redis
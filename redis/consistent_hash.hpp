@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace redis {
+
+/**
+ * @brief How hash slots are spread over the nodes of a sharded_pool_client.
+ */
+enum class hash_algorithm : uint8_t {
+    /// Jump consistent hash. Balances evenly and needs no ring, but nodes can
+    /// only be added or removed at the end of the list.
+    jump,
+
+    /// A ketama ring with points derived from the node endpoints. Any node
+    /// can be added or removed.
+    ketama
+};
+
+/**
+ * @brief Maps a key to one of num_buckets buckets with the jump consistent
+ * hash of Lamping and Veach. Growing the bucket count from N to N + 1 moves
+ * about 1/(N + 1) of the keys, all of them into the new bucket.
+ * @param key The hash of the key.
+ * @param num_buckets The number of buckets. Must be positive.
+ * @returns A bucket in [0, num_buckets).
+ */
+int32_t jump_consistent_hash(uint64_t key, int32_t num_buckets);
+
+/**
+ * @brief A ketama consistent hash ring. Each node gets points_per_node points
+ * on a 32-bit ring, taken from the MD5 digests of "<node>-<n>", and a hash is
+ * owned by the first point at or after it.
+ */
+class ketama_ring {
+
+  public:
+    /**
+     * @brief Builds the ring.
+     * @param nodes The names of the nodes, e.g. "10.0.0.1:6379".
+     * @param points_per_node The number of points of each node.
+     */
+    explicit ketama_ring(const std::vector<std::string>& nodes,
+                         unsigned int points_per_node = 160);
+
+    /**
+     * @brief Returns the index in nodes of the owner of the hash. Must not be
+     * called on an empty ring.
+     */
+    size_t node_for(uint32_t hash) const;
+
+    /**
+     * @brief Returns true if the ring has no nodes.
+     */
+    bool empty() const;
+
+  private:
+    /// The points of the ring and the index of their node, sorted by point.
+    std::vector<std::pair<uint32_t, size_t>> points_;
+};
+
+/**
+ * @brief Assigns every hash slot to a node. Keys are sharded by their hash
+ * slot, so hash tags keep related keys on one node as they do in Redis
+ * Cluster, and routing a key is a single table lookup.
+ * @param algorithm The consistent hash to use.
+ * @param nodes The names of the nodes. Must not be empty.
+ * @returns The index in nodes of the owner of each slot.
+ */
+std::vector<uint16_t> assign_slots(hash_algorithm algorithm,
+                                   const std::vector<std::string>& nodes);
+
+} // namespace redis
@@ -0,0 +1,41 @@
+#include "redis/handshake.hpp"
+
+namespace redis {
+
+commands handshake_commands(const client_config& config) {
+    commands handshake;
+    auto username = config.username.empty() ? "default" : config.username;
+
+    if (config.use_hello) {
+        // HELLO can authenticate and name the connection in one command
+        std::vector<std::string> hello{"HELLO", "2"};
+        if (!config.password.empty()) {
+            hello.insert(hello.end(), {"AUTH", username, config.password});
+        }
+        if (!config.client_name.empty()) {
+            hello.insert(hello.end(), {"SETNAME", config.client_name});
+        }
+        handshake.emplace_back(std::move(hello));
+    } else {
+        if (!config.password.empty()) {
+            handshake.emplace_back(
+                std::vector<std::string>{"AUTH", username, config.password});
+        }
+        if (!config.client_name.empty()) {
+            handshake.emplace_back(std::vector<std::string>{
+                "CLIENT", "SETNAME", config.client_name});
+        }
+    }
+
+    if (config.database != 0) {
+        handshake.emplace_back(std::vector<std::string>{
+            "SELECT", std::to_string(config.database)});
+    }
+
+    handshake.insert(handshake.end(), config.init_commands.begin(),
+                     config.init_commands.end());
+
+    return handshake;
+}
+
+} // namespace redis
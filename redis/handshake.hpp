@@ -0,0 +1,18 @@
+#pragma once
+
+#include "redis/client_config.hpp"
+#include "redis/command.hpp"
+
+namespace redis {
+
+/**
+ * @brief Builds the commands that are sent when a connection is established.
+ * The commands are pipelined into a single write so the connection is ready
+ * after one round trip.
+ * @param config The configuration that holds the credentials, database,
+ * client name and any additional init commands.
+ * @returns The commands to send. Empty if the connection needs no setup.
+ */
+commands handshake_commands(const client_config& config);
+
+} // namespace redis
@@ -0,0 +1,47 @@
+#include "redis/hash_slot.hpp"
+
+#include <array>
+
+namespace redis {
+
+namespace {
+
+/// The lookup table of the CRC16 XMODEM polynomial 0x1021
+constexpr std::array<uint16_t, 256> make_crc16_table() {
+    std::array<uint16_t, 256> table{};
+    for (uint16_t i = 0; i < 256; i++) {
+        uint16_t crc = i << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr auto crc16_table = make_crc16_table();
+
+} // namespace
+
+uint16_t crc16(std::string_view data) {
+    uint16_t crc = 0;
+    for (unsigned char c : data) {
+        crc = (crc << 8) ^ crc16_table[((crc >> 8) ^ c) & 0xff];
+    }
+    return crc;
+}
+
+uint16_t hash_slot(std::string_view key) {
+    // only hash the part between the first '{' and the next '}', if any
+    auto start = key.find('{');
+    if (start != std::string_view::npos) {
+        auto end = key.find('}', start + 1);
+        if (end != std::string_view::npos && end != start + 1) {
+            key = key.substr(start + 1, end - start - 1);
+        }
+    }
+
+    return crc16(key) & (num_hash_slots - 1);
+}
+
+} // namespace redis
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace redis {
+
+/// The number of hash slots in a Redis Cluster.
+constexpr uint16_t num_hash_slots = 16384;
+
+/**
+ * @brief Computes the CRC16 (XMODEM) checksum that Redis Cluster uses to
+ * assign keys to slots.
+ * @param data The bytes to checksum.
+ */
+uint16_t crc16(std::string_view data);
+
+/**
+ * @brief Returns the hash slot of a key. If the key contains a non-empty
+ * hash tag, e.g. "{user1000}.following", only the tag is hashed so related
+ * keys land on the same node.
+ * @param key The key to hash.
+ */
+uint16_t hash_slot(std::string_view key);
+
+} // namespace redis
@@ -1,6 +1,8 @@
 
 #include "redis/helper_functions.hpp"
 
+#include <cmath>
+
 namespace redis {
 
 std::vector<uint8_t> string_to_vector(std::string_view value) {
@@ -25,4 +27,15 @@ std::string vector_to_string(const std::vector<uint8_t>& value) {
     return retVal;
 }
 
+bool recompute_early(std::chrono::milliseconds remaining,
+                     std::chrono::milliseconds delta, double beta,
+                     double random) {
+    if (remaining.count() < 0) {
+        return false;
+    }
+
+    auto gap = -static_cast<double>(delta.count()) * beta * std::log(random);
+    return gap >= static_cast<double>(remaining.count());
+}
+
 } // namespace redis
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <string_view>
@@ -21,4 +22,21 @@ std::vector<uint8_t> string_to_vector(std::string_view value);
  */
 std::string vector_to_string(const std::vector<uint8_t>& value);
 
+/**
+ * @brief Decides whether a cached value should be recomputed before it
+ * expires, with the XFetch rule of Vattani et al.: recompute if
+ * -delta * beta * ln(random) >= remaining. Readers close to the expiry, or of
+ * values that take long to compute, are more likely to recompute, so one of
+ * them usually refreshes the value before everyone misses at once.
+ * @param remaining The time until the value expires. Negative if it never
+ * expires.
+ * @param delta How long the value took to compute.
+ * @param beta Values above 1 favor earlier recomputation.
+ * @param random A number drawn uniformly from (0, 1].
+ * @returns True if the value should be recomputed now.
+ */
+bool recompute_early(std::chrono::milliseconds remaining,
+                     std::chrono::milliseconds delta, double beta,
+                     double random);
+
 } // namespace redis
@@ -0,0 +1,350 @@
+#include "redis/local_cache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+
+namespace redis {
+
+namespace {
+
+/// The seeds that pick a different counter of a hash in each row.
+constexpr std::array<uint64_t, 4> sketch_seeds{
+    0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL,
+    0xcbf29ce484222325ULL};
+
+/// The largest value of a 4-bit counter.
+constexpr uint8_t max_frequency = 15;
+
+} // namespace
+
+frequency_sketch::frequency_sketch(size_t capacity)
+    : counters_()
+    , width_(16)
+    , additions_(0)
+    , sample_size_(10 * std::max<size_t>(capacity, 1)) {
+
+    // four counters per entry keep collisions rare enough that a key read
+    // once seldom looks popular
+    while (width_ < 4 * capacity) {
+        width_ <<= 1;
+    }
+    counters_.resize(sketch_seeds.size() * width_, 0);
+}
+
+void frequency_sketch::increment(uint64_t hash) {
+    for (size_t row = 0; row < sketch_seeds.size(); row++) {
+        auto& counter = counters_[index(hash, row)];
+        if (counter < max_frequency) {
+            counter++;
+        }
+    }
+
+    if (++additions_ >= sample_size_) {
+        for (auto& counter : counters_) {
+            counter >>= 1;
+        }
+        additions_ /= 2;
+    }
+}
+
+unsigned int frequency_sketch::frequency(uint64_t hash) const {
+    unsigned int frequency = max_frequency;
+    for (size_t row = 0; row < sketch_seeds.size(); row++) {
+        frequency = std::min<unsigned int>(frequency,
+                                           counters_[index(hash, row)]);
+    }
+
+    return frequency;
+}
+
+size_t frequency_sketch::index(uint64_t hash, size_t row) const {
+    auto mixed = (hash ^ sketch_seeds[row]) * 0x9e3779b97f4a7c15ULL;
+    mixed ^= mixed >> 32;
+    return row * width_ + (mixed & (width_ - 1));
+}
+
+local_cache::shard::shard(size_t capacity, eviction_policy policy)
+    : window()
+    , probation()
+    , protection()
+    , by_id()
+    , by_key()
+    , pending()
+    , sketch(capacity)
+    , window_capacity(0)
+    , main_capacity(0)
+    , protection_capacity(0)
+    , metrics()
+    , mutex() {
+
+    // a window of 1% lets bursts in without letting them flush the cache
+    if (policy == eviction_policy::tiny_lfu && capacity > 1) {
+        window_capacity = std::max<size_t>(capacity / 100, 1);
+    }
+    main_capacity = capacity - window_capacity;
+    protection_capacity = main_capacity * 4 / 5;
+}
+
+local_cache::local_cache(local_cache_config config)
+    : config_(std::move(config))
+    , shards_() {
+
+    auto shards = std::max<size_t>(config_.shards, 1);
+    auto capacity =
+        std::max<size_t>((config_.max_entries + shards - 1) / shards, 1);
+    for (size_t i = 0; i < shards; i++) {
+        shards_.push_back(std::make_unique<shard>(capacity, config_.policy));
+    }
+}
+
+std::optional<reply> local_cache::get(std::string_view key,
+                                      const std::string& id) {
+    auto& shard = shard_for(key);
+    auto hash = std::hash<std::string>{}(id);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.sketch.increment(hash);
+    auto found = shard.by_id.find(id);
+    if (found == shard.by_id.end()) {
+        shard.metrics.misses++;
+        return std::nullopt;
+    }
+
+    auto it = found->second;
+    if (it->expires <= std::chrono::steady_clock::now()) {
+        erase(shard, it);
+        shard.metrics.expirations++;
+        shard.metrics.misses++;
+        return std::nullopt;
+    }
+
+    shard.metrics.hits++;
+    if (it->place == segment::probation) {
+        move_to(shard, it, segment::protection);
+        demote(shard);
+    } else {
+        move_to(shard, it, it->place);
+    }
+
+    return it->reply;
+}
+
+void local_cache::put(std::string_view key, const std::string& id,
+                      const redis::reply& reply,
+                      std::chrono::milliseconds ttl) {
+    auto& shard = shard_for(key);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    insert(shard, key, id, reply, ttl);
+}
+
+uint64_t local_cache::begin_fill(std::string_view key) {
+    auto& shard = shard_for(key);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& pending = shard.pending[std::string(key)];
+    pending.count++;
+    return pending.erasures;
+}
+
+void local_cache::end_fill(std::string_view key, const std::string& id,
+                           uint64_t token, const redis::reply& reply,
+                           std::chrono::milliseconds ttl) {
+    auto& shard = shard_for(key);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto pending = shard.pending.find(std::string(key));
+    if (pending == shard.pending.end()) {
+        return;
+    }
+
+    // a write erased the key while the read was in flight, so the reply may
+    // predate it
+    bool valid = (pending->second.erasures == token);
+    if (--pending->second.count == 0) {
+        shard.pending.erase(pending);
+    }
+
+    if (valid) {
+        insert(shard, key, id, reply, ttl);
+    }
+}
+
+void local_cache::erase(std::string_view key) {
+    auto& shard = shard_for(key);
+    std::string name(key);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto pending = shard.pending.find(name);
+    if (pending != shard.pending.end()) {
+        pending->second.erasures++;
+    }
+
+    auto found = shard.by_key.find(name);
+    if (found == shard.by_key.end()) {
+        return;
+    }
+
+    // erase() edits the list of the key, so work on a copy
+    auto ids = found->second;
+    for (const auto& id : ids) {
+        auto it = shard.by_id.find(id);
+        if (it != shard.by_id.end()) {
+            erase(shard, it->second);
+        }
+    }
+}
+
+void local_cache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto& [key, pending] : shard->pending) {
+            pending.erasures++;
+        }
+
+        shard->window.clear();
+        shard->probation.clear();
+        shard->protection.clear();
+        shard->by_id.clear();
+        shard->by_key.clear();
+        shard->metrics.entries = 0;
+    }
+}
+
+void local_cache::insert(shard& shard, std::string_view key,
+                         const std::string& id, const redis::reply& reply,
+                         std::chrono::milliseconds ttl) {
+    if (reply.error() || ttl.count() <= 0) {
+        return;
+    }
+
+    auto expires = std::chrono::steady_clock::now() + ttl;
+    shard.sketch.increment(std::hash<std::string>{}(id));
+    auto found = shard.by_id.find(id);
+    if (found != shard.by_id.end()) {
+        found->second->reply = reply;
+        found->second->expires = expires;
+        return;
+    }
+
+    auto place = shard.window_capacity > 0 ? segment::window
+                                           : segment::probation;
+    auto& entries = list_of(shard, place);
+    entries.push_front(entry{id, std::string(key), reply, expires, place});
+    shard.by_id.emplace(id, entries.begin());
+    shard.by_key[std::string(key)].push_back(id);
+    shard.metrics.entries++;
+
+    evict(shard);
+}
+
+std::chrono::milliseconds local_cache::ttl_for(std::string_view key) const {
+    const key_ttl* best = nullptr;
+    for (const auto& ttl : config_.ttls) {
+        if (key.starts_with(ttl.prefix) &&
+            (best == nullptr || ttl.prefix.size() > best->prefix.size())) {
+            best = &ttl;
+        }
+    }
+
+    return best != nullptr ? best->ttl : config_.default_ttl;
+}
+
+const local_cache_config& local_cache::config() const { return config_; }
+
+local_cache_metrics local_cache::metrics() const {
+    local_cache_metrics total;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total.hits += shard->metrics.hits;
+        total.misses += shard->metrics.misses;
+        total.evictions += shard->metrics.evictions;
+        total.expirations += shard->metrics.expirations;
+        total.entries += shard->metrics.entries;
+    }
+
+    return total;
+}
+
+local_cache::shard& local_cache::shard_for(std::string_view key) {
+    auto hash = std::hash<std::string_view>{}(key);
+    return *shards_[hash % shards_.size()];
+}
+
+local_cache::entry_list& local_cache::list_of(shard& shard, segment place) {
+    switch (place) {
+    case segment::window:
+        return shard.window;
+    case segment::probation:
+        return shard.probation;
+    default:
+        return shard.protection;
+    }
+}
+
+void local_cache::move_to(shard& shard, entry_list::iterator it,
+                          segment place) {
+    auto& to = list_of(shard, place);
+    to.splice(to.begin(), list_of(shard, it->place), it);
+    it->place = place;
+}
+
+void local_cache::demote(shard& shard) {
+    while (shard.protection.size() > shard.protection_capacity) {
+        move_to(shard, std::prev(shard.protection.end()), segment::probation);
+    }
+}
+
+void local_cache::evict(shard& shard) {
+    auto main_size = [&shard]() {
+        return shard.probation.size() + shard.protection.size();
+    };
+    auto victim = [&shard]() {
+        return shard.probation.empty() ? std::prev(shard.protection.end())
+                                       : std::prev(shard.probation.end());
+    };
+
+    while (shard.window.size() > shard.window_capacity) {
+        auto candidate = std::prev(shard.window.end());
+        if (main_size() < shard.main_capacity) {
+            move_to(shard, candidate, segment::probation);
+            continue;
+        }
+
+        // the entry leaving the window only replaces the next victim of the
+        // main cache if it was used more often recently
+        auto evicted = victim();
+        auto hash = std::hash<std::string>{};
+        if (shard.sketch.frequency(hash(candidate->id)) >
+            shard.sketch.frequency(hash(evicted->id))) {
+            erase(shard, evicted);
+            move_to(shard, candidate, segment::probation);
+        } else {
+            erase(shard, candidate);
+        }
+        shard.metrics.evictions++;
+    }
+
+    while (main_size() > shard.main_capacity) {
+        erase(shard, victim());
+        shard.metrics.evictions++;
+    }
+}
+
+void local_cache::erase(shard& shard, entry_list::iterator it) {
+    auto ids = shard.by_key.find(it->key);
+    if (ids != shard.by_key.end()) {
+        auto& list = ids->second;
+        list.erase(std::remove(list.begin(), list.end(), it->id), list.end());
+        if (list.empty()) {
+            shard.by_key.erase(ids);
+        }
+    }
+
+    shard.by_id.erase(it->id);
+    list_of(shard, it->place).erase(it);
+    shard.metrics.entries--;
+}
+
+} // namespace redis
@@ -0,0 +1,414 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "redis/reply.hpp"
+
+namespace redis {
+
+using namespace std::chrono_literals;
+
+/**
+ * @brief How a local_cache picks the entries to drop when it is full.
+ */
+enum class eviction_policy : uint8_t {
+    /// Segmented LRU. New entries are probationary and are promoted to the
+    /// protected segment when they are read again, so a scan of keys read once
+    /// does not flush the keys that are read often.
+    segmented_lru,
+
+    /// W-TinyLFU. New entries pass through a small LRU window and then only
+    /// replace an entry of the segmented LRU if they were used more often
+    /// recently, which keeps the hit rate high under skewed traffic.
+    tiny_lfu
+};
+
+/**
+ * @brief The TTL of the keys that start with a prefix.
+ */
+struct key_ttl {
+    /// prefix The prefix of the keys, e.g. "user:".
+    std::string prefix;
+
+    /// ttl How long a reply for the keys may be served from the cache.
+    std::chrono::milliseconds ttl;
+};
+
+/**
+ * @brief Contains the parameters of a local_cache and a cached_client.
+ */
+struct local_cache_config {
+    /// max_entries The number of replies the cache may hold.
+    size_t max_entries;
+
+    /// policy How entries are evicted when the cache is full.
+    eviction_policy policy;
+
+    /// shards The number of independently locked parts of the cache.
+    size_t shards;
+
+    /// default_ttl How long a reply may be served from the cache if no prefix
+    /// in ttls matches its key.
+    std::chrono::milliseconds default_ttl;
+
+    /// ttls The TTL of keys by prefix. The longest matching prefix wins.
+    std::vector<key_ttl> ttls;
+
+    /// use_pttl Read the PTTL of the key along with the reply, so a reply is
+    /// never cached past the expiry of its key.
+    bool use_pttl;
+
+    /// negative_ttl How long a nil reply may be served from the cache. Zero
+    /// disables negative caching.
+    std::chrono::milliseconds negative_ttl;
+
+    /// Creates a configuration with default parameters
+    local_cache_config()
+        : max_entries(10000)
+        , policy(eviction_policy::tiny_lfu)
+        , shards(16)
+        , default_ttl(1s)
+        , ttls()
+        , use_pttl(true)
+        , negative_ttl(100ms) {}
+
+    /**
+     * @brief Sets the number of replies the cache may hold.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    local_cache_config set_max_entries(size_t max_entries) {
+        this->max_entries = max_entries;
+        return *this;
+    }
+
+    /**
+     * @brief Sets how entries are evicted when the cache is full.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    local_cache_config set_policy(eviction_policy policy) {
+        this->policy = policy;
+        return *this;
+    }
+
+    /**
+     * @brief Sets the number of independently locked parts of the cache.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    local_cache_config set_shards(size_t shards) {
+        this->shards = shards;
+        return *this;
+    }
+
+    /**
+     * @brief Sets how long replies may be served from the cache.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    local_cache_config set_default_ttl(std::chrono::milliseconds ttl) {
+        this->default_ttl = ttl;
+        return *this;
+    }
+
+    /**
+     * @brief Sets how long the replies of keys with a prefix may be served
+     * from the cache.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    local_cache_config add_ttl(std::string prefix,
+                               std::chrono::milliseconds ttl) {
+        this->ttls.push_back(key_ttl{std::move(prefix), ttl});
+        return *this;
+    }
+
+    /**
+     * @brief Sets whether the PTTL of keys bounds the TTL of their replies.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    local_cache_config set_use_pttl(bool use_pttl) {
+        this->use_pttl = use_pttl;
+        return *this;
+    }
+
+    /**
+     * @brief Sets how long nil replies may be served from the cache.
+     * @returns The configuration object so subsequent commands to set methods
+     * can be chained.
+     */
+    local_cache_config set_negative_ttl(std::chrono::milliseconds ttl) {
+        this->negative_ttl = ttl;
+        return *this;
+    }
+};
+
+/**
+ * @brief The counters of a local_cache.
+ */
+struct local_cache_metrics {
+    /// hits Reads answered from the cache.
+    uint64_t hits = 0;
+
+    /// misses Reads that were not cached or had expired.
+    uint64_t misses = 0;
+
+    /// evictions Entries removed to stay within max_entries, including
+    /// new entries that were not admitted.
+    uint64_t evictions = 0;
+
+    /// expirations Entries removed because they outlived their TTL.
+    uint64_t expirations = 0;
+
+    /// entries The number of cached replies.
+    size_t entries = 0;
+};
+
+/**
+ * @brief Estimates how often hashes were seen recently with a count-min
+ * sketch of 4-bit counters. All counters are halved once the sketch has
+ * recorded ten times its capacity, so old popularity fades. Not thread safe.
+ */
+class frequency_sketch {
+
+  public:
+    /**
+     * @brief Creates a sketch sized for the number of entries of a cache.
+     */
+    explicit frequency_sketch(size_t capacity);
+
+    /**
+     * @brief Records one use of the hash.
+     */
+    void increment(uint64_t hash);
+
+    /**
+     * @brief Returns the estimated number of recent uses of the hash, at
+     * most 15.
+     */
+    unsigned int frequency(uint64_t hash) const;
+
+  private:
+    /**
+     * @brief Returns the index of the counter of the hash in the given row.
+     */
+    size_t index(uint64_t hash, size_t row) const;
+
+  private:
+    /// Four rows of counters, one per byte.
+    std::vector<uint8_t> counters_;
+
+    /// The number of counters in a row, a power of two.
+    size_t width_;
+
+    /// The number of increments since the counters were last halved.
+    size_t additions_;
+
+    /// The number of increments after which the counters are halved.
+    size_t sample_size_;
+};
+
+/**
+ * @brief A bounded cache of replies held in the memory of the process, with
+ * a TTL per entry and no help from the server. Entries are grouped by key so
+ * every entry of a key lives in the same shard and can be dropped at once.
+ * Each shard has its own lock, so threads reading different keys rarely
+ * contend. Thread safe.
+ */
+class local_cache {
+
+  public:
+    /**
+     * @brief Creates an empty cache.
+     */
+    explicit local_cache(local_cache_config config = local_cache_config());
+
+    local_cache(const local_cache&) = delete;
+    local_cache& operator=(const local_cache&) = delete;
+
+    /**
+     * @brief Returns the reply cached for the command and counts a hit or a
+     * miss. Expired entries are dropped.
+     * @param key The key the command reads.
+     * @param id The serialized command.
+     */
+    std::optional<reply> get(std::string_view key, const std::string& id);
+
+    /**
+     * @brief Caches the reply of a command. Errors and zero TTLs are ignored.
+     * @param key The key the command reads.
+     * @param id The serialized command.
+     * @param reply The reply of the command.
+     * @param ttl How long the reply may be served.
+     */
+    void put(std::string_view key, const std::string& id,
+             const redis::reply& reply, std::chrono::milliseconds ttl);
+
+    /**
+     * @brief Announces that a command reading the key is being sent to the
+     * server.
+     * @returns A token to pass to end_fill().
+     */
+    uint64_t begin_fill(std::string_view key);
+
+    /**
+     * @brief Caches the reply of a read started with begin_fill(), unless the
+     * key was erased in the meantime. Errors and zero TTLs are ignored.
+     * @param key The key the command reads.
+     * @param id The serialized command.
+     * @param token The token returned by begin_fill().
+     * @param reply The reply of the command.
+     * @param ttl How long the reply may be served.
+     */
+    void end_fill(std::string_view key, const std::string& id, uint64_t token,
+                  const redis::reply& reply, std::chrono::milliseconds ttl);
+
+    /**
+     * @brief Drops every entry of a key.
+     */
+    void erase(std::string_view key);
+
+    /**
+     * @brief Drops every entry.
+     */
+    void clear();
+
+    /**
+     * @brief Returns the TTL configured for the key, from the longest
+     * matching prefix or default_ttl.
+     */
+    std::chrono::milliseconds ttl_for(std::string_view key) const;
+
+    /**
+     * @brief Returns the configuration of the cache.
+     */
+    const local_cache_config& config() const;
+
+    /**
+     * @brief Returns the counters of the cache.
+     */
+    local_cache_metrics metrics() const;
+
+  private:
+    /// The segment of a shard an entry is in
+    enum class segment : uint8_t { window, probation, protection };
+
+    /// A cached reply
+    struct entry {
+        std::string id;
+        std::string key;
+        redis::reply reply;
+        std::chrono::steady_clock::time_point expires;
+        segment place;
+    };
+
+    using entry_list = std::list<entry>;
+
+    /// The reads in flight for a key
+    struct pending_fill {
+        unsigned int count;
+        uint64_t erasures;
+    };
+
+    /// An independently locked part of the cache
+    struct shard {
+        explicit shard(size_t capacity, eviction_policy policy);
+
+        /// The most recently admitted entries, most recent first. Only used
+        /// by eviction_policy::tiny_lfu.
+        entry_list window;
+
+        /// Entries read once since they entered the main cache.
+        entry_list probation;
+
+        /// Entries read again while they were in probation.
+        entry_list protection;
+
+        /// The entries by serialized command.
+        std::unordered_map<std::string, entry_list::iterator> by_id;
+
+        /// The serialized commands cached for each key.
+        std::unordered_map<std::string, std::vector<std::string>> by_key;
+
+        /// The reads in flight by key.
+        std::unordered_map<std::string, pending_fill> pending;
+
+        /// The recent uses of each serialized command.
+        frequency_sketch sketch;
+
+        /// The maximum size of window.
+        size_t window_capacity;
+
+        /// The maximum size of probation and protection together.
+        size_t main_capacity;
+
+        /// The maximum size of protection.
+        size_t protection_capacity;
+
+        /// The counters of the shard.
+        local_cache_metrics metrics;
+
+        /// Guards all of the above.
+        mutable std::mutex mutex;
+    };
+
+    /**
+     * @brief Returns the shard that holds the entries of the key.
+     */
+    shard& shard_for(std::string_view key);
+
+    /**
+     * @brief Returns the list that holds entries of the segment.
+     */
+    static entry_list& list_of(shard& shard, segment place);
+
+    /**
+     * @brief Moves an entry to the front of a segment.
+     */
+    static void move_to(shard& shard, entry_list::iterator it, segment place);
+
+    /**
+     * @brief Moves a protected entry back to probation if protection is over
+     * its capacity.
+     */
+    static void demote(shard& shard);
+
+    /**
+     * @brief Caches a reply. Must be called with the mutex of the shard held.
+     */
+    static void insert(shard& shard, std::string_view key,
+                       const std::string& id, const redis::reply& reply,
+                       std::chrono::milliseconds ttl);
+
+    /**
+     * @brief Drops entries until the shard is within its capacity.
+     */
+    static void evict(shard& shard);
+
+    /**
+     * @brief Removes an entry. Must be called with the mutex of the shard
+     * held.
+     */
+    static void erase(shard& shard, entry_list::iterator it);
+
+  private:
+    /// The configuration of the cache.
+    local_cache_config config_;
+
+    /// The parts of the cache.
+    std::vector<std::unique_ptr<shard>> shards_;
+};
+
+} // namespace redis
@@ -0,0 +1,92 @@
+#include "redis/message.hpp"
+
+#include <array>
+
+namespace redis {
+
+namespace {
+
+using buffer_iterator = std::vector<uint8_t>::const_iterator;
+
+/// The longest bulk string accepted, as the server limits them to 512MB.
+constexpr int64_t max_bulk_length = int64_t(1) << 32;
+
+/// Reads a header such as "*3\r\n" or "$7\r\n" and moves it past it.
+/// Returns std::nullopt and leaves it alone if the header is incomplete or of
+/// another type.
+std::optional<int64_t> read_header(buffer_iterator& it, buffer_iterator end,
+                                   uint8_t type) {
+    if (it == end || *it != type) {
+        return std::nullopt;
+    }
+
+    auto digit = std::next(it);
+    auto first = digit;
+    int64_t length = 0;
+    while (digit != end && *digit >= '0' && *digit <= '9') {
+        length = length * 10 + (*digit++ - '0');
+        if (length > max_bulk_length) {
+            return std::nullopt;
+        }
+    }
+
+    if (digit == first || end - digit < 2 || digit[0] != '\r' ||
+        digit[1] != '\n') {
+        return std::nullopt;
+    }
+
+    it = digit + 2;
+    return length;
+}
+
+/// Reads a bulk string and moves it past it. Nil strings are not expected in
+/// a published message and are not accepted.
+std::optional<std::string_view> read_bulk_string(buffer_iterator& it,
+                                                 buffer_iterator end) {
+    auto next = it;
+    auto length = read_header(next, end, '$');
+    if (!length || end - next < *length + 2) {
+        return std::nullopt;
+    }
+
+    std::string_view bulk(reinterpret_cast<const char*>(&*next), *length);
+    it = next + *length + 2;
+    return bulk;
+}
+
+} // namespace
+
+std::optional<message_view> scan_message(buffer_iterator& it,
+                                         buffer_iterator end) {
+    auto next = it;
+    auto size = read_header(next, end, '*');
+    if (!size || (*size != 3 && *size != 4)) {
+        return std::nullopt;
+    }
+
+    std::array<std::string_view, 4> parts;
+    for (int64_t i = 0; i < *size; i++) {
+        auto part = read_bulk_string(next, end);
+        if (!part) {
+            return std::nullopt;
+        }
+        parts[i] = *part;
+    }
+
+    message_view message;
+    if (*size == 3 && parts[0] == "message") {
+        message.channel = parts[1];
+        message.contents = parts[2];
+    } else if (*size == 4 && parts[0] == "pmessage") {
+        message.pattern = parts[1];
+        message.channel = parts[2];
+        message.contents = parts[3];
+    } else {
+        return std::nullopt;
+    }
+
+    it = next;
+    return message;
+}
+
+} // namespace redis
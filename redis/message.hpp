@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace redis {
@@ -90,4 +93,39 @@ struct redis_message {
     bool empty() const { return contents.empty(); }
 };
 
+/**
+ * @brief A published message that refers to the bytes it was read from
+ * instead of copying them. Only valid while those bytes are.
+ */
+struct message_view {
+
+    std::string_view channel;
+    std::string_view pattern;
+    std::string_view contents;
+
+    /**
+     * @brief Copies the message so it can outlive the bytes it was read
+     * from.
+     */
+    redis_message to_message() const {
+        redis_message message;
+        message.channel = string(channel);
+        message.pattern = string(pattern);
+        message.contents = string(contents);
+        return message;
+    }
+};
+
+/**
+ * @brief Reads a message or pmessage frame in place.
+ * @param it The start of the frame. Moved past the frame if it is a complete
+ * published message, left alone otherwise.
+ * @param end The end of the bytes that were read.
+ * @returns The message, or std::nullopt if the bytes are not a complete
+ * published message, e.g. the reply of a command or a partial frame.
+ */
+std::optional<message_view>
+scan_message(std::vector<uint8_t>::const_iterator& it,
+             std::vector<uint8_t>::const_iterator end);
+
 } // namespace redis
@@ -0,0 +1,302 @@
+#include "redis/near_cache.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace redis {
+
+namespace {
+
+/// Reads of a single key whose reply only changes when the key is written.
+/// Commands such as TTL or SRANDMEMBER are left out because their reply
+/// changes on its own.
+const std::unordered_set<std::string_view> cacheable_commands{
+    "EXISTS", "GET", "GETRANGE", "HEXISTS", "HGET", "HGETALL", "HKEYS", "HLEN",
+    "HMGET", "HSTRLEN", "HVALS", "JSON.GET", "JSON.TYPE", "LINDEX", "LLEN",
+    "LPOS", "LRANGE", "SCARD", "SISMEMBER", "SMEMBERS", "SMISMEMBER", "STRLEN",
+    "TYPE", "ZCARD", "ZCOUNT", "ZMSCORE", "ZRANGE", "ZRANGEBYSCORE", "ZRANK",
+    "ZREVRANGE", "ZREVRANK", "ZSCORE"};
+
+/// The bookkeeping cost of an entry beyond its strings.
+constexpr size_t entry_overhead = 128;
+
+/// Estimates the memory held by a value.
+size_t value_size(const value& value) {
+    switch (value.type()) {
+    case redis_type::simple_string:
+    case redis_type::bulk_string:
+        return value.as<std::string>().value_or("").size();
+
+    case redis_type::array: {
+        size_t size = 0;
+        for (const auto& element : value.as<redis_array>().value_or(
+                 redis_array())) {
+            size += sizeof(redis::value) + value_size(element);
+        }
+        return size;
+    }
+
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+std::optional<invalidation> parse_invalidation(const reply& reply) {
+    auto message = reply.value().as<redis_array>();
+    if (!message || message->size() != 3 ||
+        (*message)[0].as<std::string>().value_or("") != "message" ||
+        (*message)[1].as<std::string>().value_or("") != invalidation_channel) {
+        return std::nullopt;
+    }
+
+    invalidation result;
+    const auto& keys = (*message)[2];
+    if (keys.type() == redis_type::nil) {
+        result.flush = true;
+        return result;
+    }
+
+    for (const auto& key : keys.as<redis_array>().value_or(redis_array())) {
+        result.keys.push_back(key.as<std::string>().value_or(""));
+    }
+
+    return result;
+}
+
+near_cache::near_cache(size_t max_bytes)
+    : broadcast_(false)
+    , regions_()
+    , by_command_()
+    , by_key_()
+    , pending_()
+    , metrics_()
+    , mutex_() {
+
+    regions_.push_back(region_state{{"", max_bytes, 0ms}, {}, 0});
+}
+
+near_cache::near_cache(std::vector<near_cache_region> regions)
+    : broadcast_(true)
+    , regions_()
+    , by_command_()
+    , by_key_()
+    , pending_()
+    , metrics_()
+    , mutex_() {
+
+    for (auto& region : regions) {
+        regions_.push_back(region_state{std::move(region), {}, 0});
+    }
+}
+
+bool near_cache::cacheable(const command& command) {
+    return cacheable_commands.contains(command.name()) &&
+           command.keys().size() == 1;
+}
+
+bool near_cache::covers(std::string_view key) const {
+    return region_for(key).has_value();
+}
+
+bool near_cache::broadcast() const { return broadcast_; }
+
+std::vector<std::string> near_cache::prefixes() const {
+    std::vector<std::string> prefixes;
+    if (broadcast_) {
+        for (const auto& region : regions_) {
+            prefixes.push_back(region.config.prefix);
+        }
+    }
+
+    return prefixes;
+}
+
+std::vector<std::string> near_cache::tracking_prefixes() const {
+    auto all = prefixes();
+    std::vector<std::string> tracked;
+    for (size_t i = 0; i < all.size(); i++) {
+        auto covered = [&all, i](size_t j) {
+            // of two equal prefixes the first one is kept
+            return all[i].starts_with(all[j]) &&
+                   (all[i].size() > all[j].size() || j < i);
+        };
+        bool overlaps = false;
+        for (size_t j = 0; j < all.size() && !overlaps; j++) {
+            overlaps = (j != i && covered(j));
+        }
+        if (!overlaps) {
+            tracked.push_back(all[i]);
+        }
+    }
+
+    return tracked;
+}
+
+std::optional<reply> near_cache::lookup(const command& command) {
+    auto serialized = command.serialized_command();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_command_.find(serialized);
+    if (it == by_command_.end()) {
+        metrics_.misses++;
+        return std::nullopt;
+    }
+
+    auto entry = it->second;
+    if (entry->expires <= std::chrono::steady_clock::now()) {
+        erase(entry);
+        metrics_.expirations++;
+        metrics_.misses++;
+        return std::nullopt;
+    }
+
+    metrics_.hits++;
+    auto& entries = regions_[entry->region].entries;
+    entries.splice(entries.begin(), entries, entry);
+    return entry->reply;
+}
+
+uint64_t near_cache::begin_fill(const command& command) {
+    auto keys = command.keys();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& pending = pending_[keys.front()];
+    pending.count++;
+    return pending.invalidations;
+}
+
+void near_cache::end_fill(const command& command, uint64_t token,
+                          const reply& reply) {
+    auto key = command.keys().front();
+    auto serialized = command.serialized_command();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto pending = pending_.find(key);
+    if (pending == pending_.end()) {
+        return;
+    }
+
+    bool valid = (pending->second.invalidations == token);
+    if (--pending->second.count == 0) {
+        pending_.erase(pending);
+    }
+
+    if (!valid || reply.error()) {
+        return;
+    }
+
+    auto index = region_for(key);
+    if (!index) {
+        return;
+    }
+
+    auto& region = regions_[*index];
+    auto bytes = entry_overhead + serialized.size() + key.size() +
+                 value_size(reply.value());
+    if (bytes > region.config.max_bytes) {
+        return;
+    }
+
+    auto existing = by_command_.find(serialized);
+    if (existing != by_command_.end()) {
+        erase(existing->second);
+    }
+
+    auto expires = std::chrono::steady_clock::time_point::max();
+    if (region.config.max_ttl.count() > 0) {
+        expires = std::chrono::steady_clock::now() + region.config.max_ttl;
+    }
+
+    region.entries.push_front(
+        entry{serialized, key, reply, bytes, *index, expires});
+    by_command_.emplace(serialized, region.entries.begin());
+    by_key_[key].push_back(region.entries.begin());
+    region.bytes += bytes;
+    metrics_.entries++;
+    metrics_.bytes += bytes;
+
+    while (region.bytes > region.config.max_bytes) {
+        erase(std::prev(region.entries.end()));
+        metrics_.evictions++;
+    }
+}
+
+void near_cache::invalidate(std::string_view key) {
+    std::string name(key);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto pending = pending_.find(name);
+    if (pending != pending_.end()) {
+        pending->second.invalidations++;
+    }
+
+    auto it = by_key_.find(name);
+    if (it == by_key_.end()) {
+        return;
+    }
+
+    // erase() edits the list of the key, so work on a copy
+    auto entries = it->second;
+    for (auto entry : entries) {
+        erase(entry);
+        metrics_.invalidations++;
+    }
+}
+
+void near_cache::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [key, pending] : pending_) {
+        pending.invalidations++;
+    }
+
+    for (auto& region : regions_) {
+        region.entries.clear();
+        region.bytes = 0;
+    }
+    by_command_.clear();
+    by_key_.clear();
+    metrics_.entries = 0;
+    metrics_.bytes = 0;
+    metrics_.flushes++;
+}
+
+near_cache_metrics near_cache::metrics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return metrics_;
+}
+
+std::optional<size_t> near_cache::region_for(std::string_view key) const {
+    std::optional<size_t> best;
+    for (size_t i = 0; i < regions_.size(); i++) {
+        const auto& prefix = regions_[i].config.prefix;
+        if (key.starts_with(prefix) &&
+            (!best || prefix.size() > regions_[*best].config.prefix.size())) {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+void near_cache::erase(entry_list::iterator it) {
+    auto key = by_key_.find(it->key);
+    if (key != by_key_.end()) {
+        auto& entries = key->second;
+        entries.erase(std::remove(entries.begin(), entries.end(), it),
+                      entries.end());
+        if (entries.empty()) {
+            by_key_.erase(key);
+        }
+    }
+
+    auto& region = regions_[it->region];
+    by_command_.erase(it->command);
+    region.bytes -= it->bytes;
+    metrics_.entries--;
+    metrics_.bytes -= it->bytes;
+    region.entries.erase(it);
+}
+
+} // namespace redis
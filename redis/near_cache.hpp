@@ -0,0 +1,231 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "redis/client_config.hpp"
+#include "redis/command.hpp"
+#include "redis/reply.hpp"
+
+namespace redis {
+
+/// The channel Redis publishes invalidations on when tracking redirects to a
+/// RESP2 connection.
+constexpr std::string_view invalidation_channel = "__redis__:invalidate";
+
+/**
+ * @brief The counters of a near_cache.
+ */
+struct near_cache_metrics {
+    /// hits Reads answered from the cache.
+    uint64_t hits = 0;
+
+    /// misses Cacheable reads that went to the server.
+    uint64_t misses = 0;
+
+    /// invalidations Entries removed because their key changed.
+    uint64_t invalidations = 0;
+
+    /// evictions Entries removed to stay within the memory limit.
+    uint64_t evictions = 0;
+
+    /// expirations Entries removed because they outlived the max_ttl of their
+    /// region.
+    uint64_t expirations = 0;
+
+    /// flushes Times the whole cache was dropped.
+    uint64_t flushes = 0;
+
+    /// entries The number of cached replies.
+    size_t entries = 0;
+
+    /// bytes The estimated memory used by the cached replies.
+    size_t bytes = 0;
+};
+
+/**
+ * @brief An invalidation message received on invalidation_channel.
+ */
+struct invalidation {
+    /// flush True if every key was invalidated, e.g. after FLUSHALL.
+    bool flush = false;
+
+    /// keys The keys that changed.
+    std::vector<std::string> keys;
+};
+
+/**
+ * @brief Parses a message received on invalidation_channel.
+ * @returns The invalidation, or std::nullopt if the reply is not one.
+ */
+std::optional<invalidation> parse_invalidation(const reply& reply);
+
+/**
+ * @brief A bounded LRU cache of read replies that is kept coherent by the
+ * server with CLIENT TRACKING. Entries are keyed by the serialized command
+ * and dropped when their key is invalidated. Thread safe.
+ *
+ * A reply is only stored if no invalidation of its key arrived while it was
+ * being read, so a reply that raced a write is never cached.
+ *
+ * With regions, only keys that start with the prefix of a region are cached,
+ * each region with its own memory limit and TTL, and the server is expected
+ * to broadcast invalidations for the prefixes.
+ */
+class near_cache {
+
+  public:
+    /**
+     * @brief Creates an empty cache for keys of any name.
+     * @param max_bytes The estimated memory the cache may use.
+     */
+    explicit near_cache(size_t max_bytes);
+
+    /**
+     * @brief Creates an empty cache for the keys of the regions.
+     * @param regions The prefixes and the limits of their entries.
+     */
+    explicit near_cache(std::vector<near_cache_region> regions);
+
+    near_cache(const near_cache&) = delete;
+    near_cache& operator=(const near_cache&) = delete;
+
+    /**
+     * @brief Returns true if the reply of the command can be cached: a read
+     * of a single key whose reply only changes when the key is written.
+     */
+    static bool cacheable(const command& command);
+
+    /**
+     * @brief Returns true if the key belongs to a region of the cache.
+     */
+    bool covers(std::string_view key) const;
+
+    /**
+     * @brief Returns true if the cache relies on broadcast tracking of the
+     * prefixes of its regions.
+     */
+    bool broadcast() const;
+
+    /**
+     * @brief Returns the prefixes of the regions, empty without regions.
+     */
+    std::vector<std::string> prefixes() const;
+
+    /**
+     * @brief Returns the prefixes to track, without the ones that another
+     * prefix already covers, e.g. "user:session:" next to "user:". Redis
+     * rejects overlapping prefixes in CLIENT TRACKING.
+     */
+    std::vector<std::string> tracking_prefixes() const;
+
+    /**
+     * @brief Returns the cached reply of the command and counts a hit or a
+     * miss. Entries past the max_ttl of their region are dropped.
+     */
+    std::optional<reply> lookup(const command& command);
+
+    /**
+     * @brief Announces that the command is being read from the server.
+     * @returns A token to pass to end_fill().
+     */
+    uint64_t begin_fill(const command& command);
+
+    /**
+     * @brief Stores the reply of a read started with begin_fill(), unless
+     * the key was invalidated in the meantime or the reply is an error.
+     */
+    void end_fill(const command& command, uint64_t token, const reply& reply);
+
+    /**
+     * @brief Drops the entries of a key.
+     */
+    void invalidate(std::string_view key);
+
+    /**
+     * @brief Drops every entry, e.g. after FLUSHALL or when invalidations may
+     * have been lost.
+     */
+    void flush();
+
+    /**
+     * @brief Returns the counters of the cache.
+     */
+    near_cache_metrics metrics() const;
+
+  private:
+    /// A cached reply
+    struct entry {
+        std::string command;
+        std::string key;
+        redis::reply reply;
+        size_t bytes;
+        size_t region;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    using entry_list = std::list<entry>;
+
+    /// The entries of one prefix
+    struct region_state {
+        near_cache_region config;
+
+        /// The entries, most recently used first.
+        entry_list entries;
+
+        /// The estimated memory used by entries.
+        size_t bytes;
+    };
+
+    /// The reads in flight for a key
+    struct pending_fill {
+        unsigned int count;
+        uint64_t invalidations;
+    };
+
+    /**
+     * @brief Returns the index of the region with the longest prefix of the
+     * key, or std::nullopt if none matches.
+     */
+    std::optional<size_t> region_for(std::string_view key) const;
+
+    /**
+     * @brief Removes an entry. Must be called with mutex_ held.
+     */
+    void erase(entry_list::iterator it);
+
+  private:
+    /// Whether the regions were configured, as opposed to one region for
+    /// every key.
+    bool broadcast_;
+
+    /// The regions and their entries. Guarded by mutex_.
+    std::vector<region_state> regions_;
+
+    /// The entries by serialized command.
+    std::unordered_map<std::string, entry_list::iterator> by_command_;
+
+    /// The entries of each key.
+    std::unordered_map<std::string, std::vector<entry_list::iterator>>
+        by_key_;
+
+    /// The reads in flight by key.
+    std::unordered_map<std::string, pending_fill> pending_;
+
+    /// The counters.
+    near_cache_metrics metrics_;
+
+    /// Guards all of the above.
+    mutable std::mutex mutex_;
+};
+
+} // namespace redis
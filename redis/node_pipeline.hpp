@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <cpool/awaitable_latch.hpp>
+
+#include "redis/command.hpp"
+#include "redis/reply.hpp"
+#include "redis/slot_pipeline.hpp"
+#include "redis/types.hpp"
+
+namespace redis {
+
+namespace asio = boost::asio;
+using boost::asio::awaitable;
+
+/**
+ * @brief Sends the commands at indexes to the node and stores the replies at
+ * the same indexes.
+ * @param send Sends a pipeline to a node.
+ * @param done Counted down once the replies are stored.
+ */
+template <typename Send, typename Node>
+awaitable<void> send_node_group(Send send, Node node, const commands& commands,
+                                std::vector<size_t> indexes, replies& replies,
+                                cpool::awaitable_latch& done) {
+    redis::commands group;
+    for (auto index : indexes) {
+        group.push_back(commands[index]);
+    }
+
+    auto group_replies = co_await send(node, group);
+    for (size_t i = 0; i < indexes.size(); i++) {
+        replies[indexes[i]] =
+            (i < group_replies.size())
+                ? group_replies[i]
+                : reply(client_error_code::response_command_mismatch);
+    }
+
+    done.count_down();
+}
+
+/**
+ * @brief Sends a pipeline to the nodes that own its keys. Multi-key commands
+ * are split by slot, the parts are grouped by node and every node gets its
+ * own pipeline, all at the same time.
+ * @param exec The Asio executor the pipelines run on.
+ * @param commands The commands to send.
+ * @param route Returns the node of a command.
+ * @param send Sends a pipeline to a node and returns its replies.
+ * @returns One reply per command, in order.
+ */
+template <typename Route, typename Send>
+awaitable<replies> send_by_node(cpool::net::any_io_executor exec,
+                                const commands& commands, Route route,
+                                Send send) {
+    using node_type = std::invoke_result_t<Route&, const command&>;
+
+    if (commands.empty()) {
+        co_return replies();
+    }
+
+    // split multi-key commands by slot, then group the parts by node
+    slot_pipeline pipeline(commands);
+    const auto& split = pipeline.split_commands();
+
+    std::vector<std::pair<node_type, std::vector<size_t>>> groups;
+    for (size_t i = 0; i < split.size(); i++) {
+        auto node = route(split[i]);
+        auto it = std::find_if(
+            groups.begin(), groups.end(),
+            [&node](const auto& group) { return group.first == node; });
+        if (it == groups.end()) {
+            it = groups.insert(groups.end(), {node, {}});
+        }
+        it->second.push_back(i);
+    }
+
+    redis::replies split_replies(split.size());
+    if (groups.size() == 1) {
+        split_replies = co_await send(groups.front().first, split);
+    } else {
+        // every node gets its own pipeline and they all run at once
+        cpool::awaitable_latch done(exec, groups.size());
+        for (const auto& [node, indexes] : groups) {
+            co_spawn(exec,
+                     send_node_group(send, node, split, indexes, split_replies,
+                                     done),
+                     detached);
+        }
+        co_await done.wait();
+    }
+
+    co_return pipeline.merge(split_replies);
+}
+
+} // namespace redis
@@ -0,0 +1,202 @@
+#include "redis/read_balancer.hpp"
+
+#include <cmath>
+
+namespace redis {
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+namespace {
+
+/// The weight of a new sample in the latency average, as a shift: 1/8
+constexpr int latency_weight_shift = 3;
+
+/// The number of samples after which the latency histogram is halved.
+constexpr uint32_t histogram_half_life = 1024;
+
+/// The number of samples needed before a percentile is reported.
+constexpr uint32_t min_percentile_samples = 20;
+
+/// How long a server is skipped after its first failure in a row.
+constexpr std::chrono::milliseconds min_down_time(100);
+
+/// The longest a server is skipped, however often it failed.
+constexpr std::chrono::milliseconds max_down_time(10000);
+
+/// Returns the histogram bucket of a latency in microseconds.
+size_t latency_bucket(int64_t latency, size_t num_buckets) {
+    auto bucket = static_cast<size_t>(4 * std::log2(double(latency)));
+    return std::min(bucket, num_buckets - 1);
+}
+
+/// Returns the largest latency in microseconds of a histogram bucket.
+int64_t bucket_limit(size_t bucket) {
+    return static_cast<int64_t>(std::ceil(std::exp2((bucket + 1) / 4.0)));
+}
+
+} // namespace
+
+server_stats::server_stats()
+    : outstanding_(0)
+    , latency_(0)
+    , histogram_()
+    , samples_(0)
+    , failures_(0)
+    , down_until_(0) {
+
+    for (auto& count : histogram_) {
+        count = 0;
+    }
+}
+
+void server_stats::begin() { outstanding_++; }
+
+void server_stats::end(std::chrono::steady_clock::duration latency) {
+    outstanding_--;
+    failures_ = 0;
+
+    auto sample = std::max<int64_t>(
+        duration_cast<microseconds>(latency).count(), 1);
+    auto average = latency_.load();
+    int64_t updated;
+    do {
+        updated = (average == 0)
+                      ? sample
+                      : average + ((sample - average) >> latency_weight_shift);
+    } while (!latency_.compare_exchange_weak(average, updated));
+
+    histogram_[latency_bucket(sample, num_buckets)]++;
+    if (++samples_ == histogram_half_life) {
+        // concurrent updates may be lost, which only blurs the histogram
+        for (auto& count : histogram_) {
+            count = count / 2;
+        }
+        samples_ = 0;
+    }
+}
+
+void server_stats::fail() {
+    outstanding_--;
+    mark_down();
+}
+
+void server_stats::mark_down() {
+    auto failures = std::min<uint32_t>(++failures_, 16);
+    auto down_time = std::min<std::chrono::steady_clock::duration>(
+        min_down_time * (1 << (failures - 1)), max_down_time);
+    auto until = std::chrono::steady_clock::now() + down_time;
+    down_until_ = until.time_since_epoch().count();
+}
+
+bool server_stats::available() const {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    return now >= down_until_.load();
+}
+
+uint64_t server_stats::outstanding() const { return outstanding_; }
+
+microseconds server_stats::latency() const {
+    return microseconds(latency_.load());
+}
+
+std::optional<microseconds> server_stats::percentile(double percentile) const {
+    std::array<uint32_t, num_buckets> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < num_buckets; i++) {
+        counts[i] = histogram_[i];
+        total += counts[i];
+    }
+
+    if (total < min_percentile_samples) {
+        return std::nullopt;
+    }
+
+    auto target = static_cast<uint64_t>(std::ceil(percentile * total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < num_buckets; i++) {
+        seen += counts[i];
+        if (seen >= target) {
+            return microseconds(bucket_limit(i));
+        }
+    }
+
+    return microseconds(bucket_limit(num_buckets - 1));
+}
+
+read_balancer::read_balancer(read_policy policy)
+    : policy_(policy)
+    , next_(0) {}
+
+read_balancer::read_balancer(const read_balancer& rhs)
+    : policy_(rhs.policy_)
+    , next_(rhs.next_.load()) {}
+
+read_balancer& read_balancer::operator=(const read_balancer& rhs) {
+    policy_ = rhs.policy_;
+    next_ = rhs.next_.load();
+    return *this;
+}
+
+read_policy read_balancer::policy() const { return policy_; }
+
+size_t read_balancer::select(const std::vector<const server_stats*>& servers) {
+    auto size = servers.size();
+    if (size <= 1 || policy_ == read_policy::master) {
+        return 0;
+    }
+
+    auto start = next_++ % size;
+    if (policy_ == read_policy::round_robin) {
+        return start;
+    }
+
+    // scan from a rotating start so ties are spread across the servers
+    auto best = start;
+    for (size_t i = 1; i < size; i++) {
+        auto candidate = (start + i) % size;
+        const auto& a = *servers[candidate];
+        const auto& b = *servers[best];
+
+        bool better;
+        if (policy_ == read_policy::least_outstanding) {
+            better = a.outstanding() < b.outstanding();
+        } else if (policy_ == read_policy::fastest) {
+            better = a.latency() * (a.outstanding() + 1) <
+                     b.latency() * (b.outstanding() + 1);
+        } else {
+            // servers that have not been measured yet are tried first
+            better = a.latency() < b.latency();
+        }
+
+        if (better) {
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+bool replica_unavailable(const reply& reply) {
+    auto error = reply.error();
+    if (error == client_error_code::write_error ||
+        error == client_error_code::read_error ||
+        error == client_error_code::disconnected ||
+        error == client_error_code::client_stopped) {
+        return true;
+    }
+
+    if (error != client_error_code::error) {
+        return false;
+    }
+
+    auto message = reply.value().as<redis::error>();
+    if (!message) {
+        return false;
+    }
+
+    std::string_view what = message->what();
+    return what.starts_with("LOADING") || what.starts_with("MASTERDOWN");
+}
+
+} // namespace redis
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "redis/client_config.hpp"
+#include "redis/reply.hpp"
+
+namespace redis {
+
+/**
+ * @brief The load and latency of one server, used to decide where reads go.
+ * Safe to update from several threads.
+ */
+class server_stats {
+
+  public:
+    server_stats();
+
+    /**
+     * @brief Records that a request was sent to the server.
+     */
+    void begin();
+
+    /**
+     * @brief Records that a request completed.
+     * @param latency The time from begin() until the reply arrived.
+     */
+    void end(std::chrono::steady_clock::duration latency);
+
+    /**
+     * @brief Records that a request failed because the server could not
+     * serve it. No latency is recorded, since a server that refuses
+     * connections quickly is not fast, and the server is marked down.
+     */
+    void fail();
+
+    /**
+     * @brief Stops sending reads to the server for a while. The pause
+     * doubles with each failure in a row, up to 10s, and ends with the first
+     * request that succeeds after it.
+     */
+    void mark_down();
+
+    /**
+     * @brief Returns false while the server is marked down.
+     */
+    bool available() const;
+
+    /**
+     * @brief Returns the number of requests in flight.
+     */
+    uint64_t outstanding() const;
+
+    /**
+     * @brief Returns the moving average of the latency. Zero until the first
+     * request completes.
+     */
+    std::chrono::microseconds latency() const;
+
+    /**
+     * @brief Returns a percentile of the recent latencies, rounded up to a
+     * quarter power of two.
+     * @param percentile The percentile, e.g. 0.95.
+     * @returns The latency, or std::nullopt if too few requests completed.
+     */
+    std::optional<std::chrono::microseconds>
+    percentile(double percentile) const;
+
+  private:
+    /// The number of histogram buckets, four per power of two microseconds.
+    static constexpr size_t num_buckets = 128;
+
+  private:
+    /// The number of requests in flight.
+    std::atomic<uint64_t> outstanding_;
+
+    /// The exponentially weighted moving average of the latency in
+    /// microseconds.
+    std::atomic<int64_t> latency_;
+
+    /// The recent latencies. All counts are halved regularly so old samples
+    /// fade out.
+    std::array<std::atomic<uint32_t>, num_buckets> histogram_;
+
+    /// The number of samples added since the histogram was last halved.
+    std::atomic<uint32_t> samples_;
+
+    /// The number of requests that failed since the last one that succeeded.
+    std::atomic<uint32_t> failures_;
+
+    /// When the server may be read from again, in ticks of steady_clock.
+    std::atomic<std::chrono::steady_clock::rep> down_until_;
+};
+
+/**
+ * @brief Picks the server a read is sent to according to a read_policy.
+ */
+class read_balancer {
+
+  public:
+    /**
+     * @brief Creates a balancer.
+     * @param policy How servers are picked. read_policy::master always picks
+     * the first server.
+     */
+    read_balancer(read_policy policy = read_policy::master);
+
+    read_balancer(const read_balancer& rhs);
+    read_balancer& operator=(const read_balancer& rhs);
+
+    /**
+     * @brief Returns the policy of the balancer.
+     */
+    read_policy policy() const;
+
+    /**
+     * @brief Picks a server. The callers leave out the servers that are not
+     * available().
+     * @param servers The stats of the candidate servers. Must not be empty.
+     * @returns The index of the chosen server.
+     */
+    size_t select(const std::vector<const server_stats*>& servers);
+
+  private:
+    /// How servers are picked.
+    read_policy policy_;
+
+    /// Rotates round_robin and breaks ties between equally good servers.
+    std::atomic<size_t> next_;
+};
+
+/**
+ * @brief Returns true if a read failed because the replica could not serve
+ * it, e.g. it is unreachable or still loading its dataset, so the read should
+ * be retried on the master.
+ */
+bool replica_unavailable(const reply& reply);
+
+} // namespace redis
@@ -11,6 +11,10 @@ reply::reply(const std::vector<uint8_t>& buffer) {
 reply::reply(const std::error_code& error)
     : error_(error) {}
 
+reply::reply(redis::value value, const std::error_code& error)
+    : value_(std::move(value))
+    , error_(error) {}
+
 std::vector<uint8_t>::const_iterator
 reply::load_data(std::vector<uint8_t>::const_iterator it,
                  const std::vector<uint8_t>::const_iterator end) {
@@ -48,7 +52,8 @@ reply::parse_reply(std::vector<uint8_t>::const_iterator it,
         break;
     }
 
-    return parse_response(redis::value(), std::error_code{}, end);
+    return parse_response(redis::value(), parse_error_code::malformed_message,
+                          it);
 }
 
 parse_response
@@ -64,6 +69,10 @@ reply::parse_simple_string(std::vector<uint8_t>::const_iterator it,
     while (it != end && *it != '\r') {
         value.push_back(*it++);
     }
+    // the '\r\n' has not arrived yet
+    if (end - it < 2) {
+        return parse_response(redis::value(), parse_error_code::eof, it);
+    }
     // consume the '\r\n'
     it += 2;
 
@@ -83,8 +92,8 @@ reply::parse_error(std::vector<uint8_t>::const_iterator it,
     while (it != end && *it != '\r') {
         value.push_back(*it++);
     }
-    // if we reached the end before we got to '\r' it's a parse error
-    if (it == end) {
+    // if we reached the end before the '\r\n' it's a parse error
+    if (end - it < 2) {
         return parse_response(redis::value(), parse_error_code::eof, it);
     }
     // consume the '\r\n'
@@ -109,8 +118,8 @@ reply::parse_bulk_string(std::vector<uint8_t>::const_iterator it,
         header.push_back(*it++);
     }
 
-    // if we reached the end before we got to '\r' it's a parse error
-    if (it == end) {
+    // if we reached the end before the '\r\n' it's a parse error
+    if (end - it < 2) {
         return parse_response(redis::value(), parse_error_code::eof, it);
     }
     // consume the '\r\n'
@@ -132,16 +141,18 @@ reply::parse_bulk_string(std::vector<uint8_t>::const_iterator it,
     if (stringSize == -1) {
         return parse_response(redis::value(), std::error_code{}, it);
     }
+    if (stringSize < -1) {
+        return parse_response(redis::value(),
+                              parse_error_code::malformed_message, it);
+    }
 
-    // copy the string
-    value.resize(stringSize);
-
-    // copy the string into value
-    try {
-        copy(it, it + stringSize, value.begin());
-    } catch (std::out_of_range& ex) {
+    // the rest of the string has not arrived yet
+    if (end - it < stringSize + 2) {
         return parse_response(redis::value(), parse_error_code::eof, it);
     }
+
+    // copy the string into value
+    value.assign(it, it + stringSize);
     // consume the bulk string and the '\r\n'
     it += stringSize + 2;
 
@@ -160,8 +171,8 @@ reply::parse_integer(std::vector<uint8_t>::const_iterator it,
     while (it != end && *it != '\r') {
         message.push_back(*it++);
     }
-    // if we reached the end before we got to '\r' it's a parse error
-    if (it == end) {
+    // if we reached the end before the '\r\n' it's a parse error
+    if (end - it < 2) {
         return parse_response(redis::value(), parse_error_code::eof, it);
     }
     // consume the '\r\n'
@@ -192,14 +203,20 @@ reply::parse_array(std::vector<uint8_t>::const_iterator it,
         header.push_back(*it++);
     }
     // return error if we're already at the end
-    if (it == end) {
+    if (end - it < 2) {
         return parse_response(redis::value(), parse_error_code::eof, it);
     }
     // consume the '\r\n'
     it += 2;
 
-    // determine size of bulk string
-    int64_t arraySize = stol(header);
+    // determine size of the array
+    int64_t arraySize = 0;
+    try {
+        arraySize = stol(header);
+    } catch (...) {
+        return parse_response(redis::value(),
+                              parse_error_code::malformed_message, it);
+    }
 
     redis::value tempValue;
     for (int64_t i = 0; i < arraySize; i++) {
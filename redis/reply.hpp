@@ -42,6 +42,15 @@ class reply {
      */
     reply(const std::error_code& error);
 
+    /**
+     * @brief Creates a reply that holds a value, e.g. one assembled from the
+     * replies of several commands.
+     * @param value The value of the reply.
+     * @param error An error code that relates to the value, if any.
+     */
+    explicit reply(redis::value value,
+                   const std::error_code& error = std::error_code());
+
     /**
      * @brief Creates a reply from a buffer that begins with "it" and ends with
      * "end".
@@ -0,0 +1,276 @@
+#include "redis/sentinel.hpp"
+
+#include <algorithm>
+#include <charconv>
+
+namespace redis {
+
+std::optional<master_address> parse_master_address(const reply& reply) {
+    if (reply.error()) {
+        return std::nullopt;
+    }
+
+    // [ip, port] or nil if the master is unknown
+    auto fields = reply.value().as<redis_array>();
+    if (!fields || fields->size() != 2) {
+        return std::nullopt;
+    }
+
+    auto host = (*fields)[0].as<string>();
+    auto port = (*fields)[1].as<int64_t>();
+    if (!host || host->empty() || !port || *port <= 0 || *port > UINT16_MAX) {
+        return std::nullopt;
+    }
+
+    return master_address{*host, static_cast<uint16_t>(*port)};
+}
+
+std::optional<master_address>
+parse_switch_master(std::string_view contents, std::string_view master_name) {
+    std::vector<std::string_view> fields;
+    while (!contents.empty()) {
+        auto space = contents.find(' ');
+        fields.push_back(contents.substr(0, space));
+        if (space == std::string_view::npos) {
+            break;
+        }
+        contents.remove_prefix(space + 1);
+    }
+
+    if (fields.size() != 5 || fields[0] != master_name || fields[3].empty()) {
+        return std::nullopt;
+    }
+
+    master_address address{std::string(fields[3]), 0};
+    auto port = fields[4];
+    auto [end, ec] =
+        std::from_chars(port.data(), port.data() + port.size(), address.port);
+    if (ec != std::errc() || end != port.data() + port.size() ||
+        address.port == 0) {
+        return std::nullopt;
+    }
+
+    return address;
+}
+
+std::optional<master_address>
+majority_master(const std::vector<std::optional<master_address>>& answers) {
+    for (const auto& answer : answers) {
+        if (!answer) {
+            continue;
+        }
+
+        auto votes = std::count(answers.begin(), answers.end(), answer);
+        if (static_cast<size_t>(votes) * 2 > answers.size()) {
+            return answer;
+        }
+    }
+
+    return std::nullopt;
+}
+
+sentinel::sentinel(cpool::net::any_io_executor exec, std::string master_name,
+                   std::vector<client_config> sentinels,
+                   std::chrono::milliseconds check_interval)
+    : exec_(std::move(exec))
+    , master_name_(std::move(master_name))
+    , sentinels_()
+    , subscribers_()
+    , check_interval_(check_interval)
+    , clients_()
+    , master_()
+    , mutex_()
+    , check_timer_(exec_)
+    , watching_(false)
+    , latch_(exec_, sentinels.size() + 1)
+    , on_log_(nullptr) {
+
+    for (const auto& config : sentinels) {
+        sentinels_.push_back(std::make_unique<client>(exec_, config));
+        // a dropped +switch-master would leave the clients on the old master
+        auto subscriber = config;
+        subscriber.subscriber_overflow = overflow_policy::block;
+        // watch() subscribes again when it is told of a disconnect
+        subscriber.subscriber_resubscribe = false;
+        subscribers_.push_back(
+            std::make_unique<redis_subscriber>(exec_, subscriber));
+    }
+}
+
+awaitable<std::optional<master_address>> sentinel::resolve_master() {
+    auto query = command(std::vector<string>{
+        "SENTINEL", "GET-MASTER-ADDR-BY-NAME", master_name_});
+
+    for (auto& sentinel : sentinels_) {
+        auto reply = co_await sentinel->send(query);
+        auto address = parse_master_address(reply);
+        if (address) {
+            co_return address;
+        }
+
+        log_message(log_level::warn,
+                    fmt::format("sentinel {}:{} did not resolve {}: {}",
+                                sentinel->config().host,
+                                sentinel->config().port, master_name_,
+                                reply.error().message()));
+    }
+
+    co_return std::nullopt;
+}
+
+awaitable<std::optional<master_address>> sentinel::resolve_quorum() {
+    auto query = command(std::vector<string>{
+        "SENTINEL", "GET-MASTER-ADDR-BY-NAME", master_name_});
+
+    std::vector<std::optional<master_address>> answers;
+    for (auto& sentinel : sentinels_) {
+        answers.push_back(parse_master_address(co_await sentinel->send(query)));
+    }
+
+    co_return majority_master(answers);
+}
+
+awaitable<cpool::error> sentinel::watch(client& client) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        clients_.push_back(&client);
+    }
+
+    auto address = co_await resolve_master();
+    start();
+    if (!address) {
+        co_return std::error_code(client_error_code::disconnected);
+    }
+
+    on_master(*address);
+    co_return cpool::error();
+}
+
+awaitable<void> sentinel::stop() {
+    bool expected = true;
+    if (!watching_.compare_exchange_strong(expected, false)) {
+        co_return;
+    }
+
+    check_timer_.cancel();
+    for (auto& subscriber : subscribers_) {
+        co_await subscriber->stop();
+    }
+    co_await latch_.wait();
+}
+
+std::optional<master_address> sentinel::master() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return master_;
+}
+
+void sentinel::set_logging_handler(logging_handler handler) {
+    on_log_ = handler;
+    for (auto& sentinel : sentinels_) {
+        sentinel->set_logging_handler(handler);
+    }
+    for (auto& subscriber : subscribers_) {
+        subscriber->set_logging_handler(handler);
+    }
+}
+
+void sentinel::start() {
+    bool expected = false;
+    if (!watching_.compare_exchange_strong(expected, true)) {
+        return;
+    }
+
+    for (auto& subscriber : subscribers_) {
+        co_spawn(exec_, listen(subscriber.get()), detached);
+    }
+    co_spawn(exec_, std::bind(&sentinel::check_master, this), detached);
+}
+
+awaitable<void> sentinel::listen(redis_subscriber* subscriber) {
+    subscriber->start();
+    auto error = co_await subscriber->subscribe("+switch-master");
+    if (error) {
+        log_message(log_level::warn,
+                    fmt::format("could not subscribe to +switch-master: {}",
+                                error.message()));
+    }
+
+    while (watching_) {
+        auto reply = co_await subscriber->read();
+        if (reply.error() == client_error_code::disconnected) {
+            // events sent while disconnected are caught by check_master
+            error = co_await subscriber->subscribe("+switch-master");
+            if (error) {
+                log_message(log_level::warn,
+                            fmt::format("could not resubscribe: {}",
+                                        error.message()));
+            }
+            continue;
+        }
+        if (reply.error()) {
+            // the subscriber was stopped
+            break;
+        }
+
+        auto message = reply.value().as<redis_message>();
+        if (!message || message->channel != "+switch-master") {
+            continue;
+        }
+
+        auto address = parse_switch_master(message->contents, master_name_);
+        if (address) {
+            log_message(log_level::info,
+                        fmt::format("+switch-master {}", message->contents));
+            on_master(*address);
+        }
+    }
+
+    latch_.count_down();
+}
+
+awaitable<void> sentinel::check_master() {
+    while (watching_) {
+        cpool::error_code ec;
+        check_timer_.expires_after(check_interval_);
+        co_await check_timer_.async_wait(
+            asio::redirect_error(asio::use_awaitable, ec));
+        if (!watching_) {
+            break;
+        }
+
+        // a lagging sentinel still reports the old master after a
+        // +switch-master, so a single answer must not repoint the clients
+        auto address = co_await resolve_quorum();
+        if (address) {
+            on_master(*address);
+        } else {
+            log_message(log_level::warn,
+                        fmt::format("sentinels disagree on the master of {}",
+                                    master_name_));
+        }
+    }
+
+    latch_.count_down();
+}
+
+void sentinel::on_master(const master_address& address) {
+    std::vector<client*> clients;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        master_ = address;
+        clients = clients_;
+    }
+
+    // repoint() does nothing for clients that already use the master
+    for (auto* client : clients) {
+        client->repoint(address.host, address.port);
+    }
+}
+
+void sentinel::log_message(log_level level, string_view message) {
+    if (on_log_) {
+        on_log_(level, message);
+    }
+}
+
+} // namespace redis
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <cpool/awaitable_latch.hpp>
+
+#include "redis/client.hpp"
+#include "redis/client_config.hpp"
+#include "redis/reply.hpp"
+#include "redis/subscriber.hpp"
+#include "redis/types.hpp"
+
+namespace redis {
+
+namespace asio = boost::asio;
+using boost::asio::awaitable;
+
+/**
+ * @brief The address of a master as reported by Sentinel.
+ */
+struct master_address {
+    /// host The IP Address or hostname of the master.
+    std::string host;
+
+    /// port The port of the master.
+    uint16_t port = 0;
+
+    bool operator==(const master_address& rhs) const = default;
+};
+
+/**
+ * @brief Parses the reply to SENTINEL GET-MASTER-ADDR-BY-NAME.
+ * @returns The address, or nullopt if the master is unknown.
+ */
+std::optional<master_address> parse_master_address(const reply& reply);
+
+/**
+ * @brief Parses the payload of a +switch-master event:
+ * "<master name> <old ip> <old port> <new ip> <new port>".
+ * @param contents The payload of the event.
+ * @param master_name Only events for this master are parsed.
+ * @returns The new master, or nullopt if the event is for another master or
+ * malformed.
+ */
+std::optional<master_address> parse_switch_master(std::string_view contents,
+                                                  std::string_view master_name);
+
+/**
+ * @brief Picks the master reported by more than half of the sentinels.
+ * @param answers The answer of each sentinel, nullopt if it did not answer.
+ * @returns The address, or nullopt if no address has a majority.
+ */
+std::optional<master_address>
+majority_master(const std::vector<std::optional<master_address>>& answers);
+
+/**
+ * @brief Discovers the master of a Redis deployment monitored by Sentinel and
+ * keeps clients pointed at it. The sentinels announce a failover on the
+ * +switch-master channel the moment the new master is elected, so the clients
+ * move without waiting for their reconnect back-off. The master is also
+ * resolved periodically in case an event was missed; that check only moves
+ * the clients when a majority of the sentinels agree, so a sentinel that has
+ * not yet seen a failover cannot undo it.
+ */
+class sentinel {
+
+  public:
+    /**
+     * @brief Creates a sentinel.
+     * @param exec The Asio executor to use for event handling.
+     * @param master_name The name of the master in the Sentinel configuration.
+     * @param sentinels The host, port and credentials of each sentinel.
+     * @param check_interval How often the master is resolved in case a
+     * +switch-master event was missed.
+     */
+    sentinel(cpool::net::any_io_executor exec, std::string master_name,
+             std::vector<client_config> sentinels,
+             std::chrono::milliseconds check_interval = 5s);
+
+    sentinel(const sentinel&) = delete;
+    sentinel& operator=(const sentinel&) = delete;
+
+    /**
+     * @brief Asks the sentinels for the address of the master, in order,
+     * until one of them answers.
+     * @returns The address, or nullopt if no sentinel knows the master.
+     */
+    [[nodiscard]] awaitable<std::optional<master_address>> resolve_master();
+
+    /**
+     * @brief Asks every sentinel for the address of the master.
+     * @returns The address reported by a majority of the sentinels, or
+     * nullopt if they do not agree.
+     */
+    [[nodiscard]] awaitable<std::optional<master_address>> resolve_quorum();
+
+    /**
+     * @brief Points the client at the current master and repoints it after
+     * every failover until stop() is called. The client must outlive the
+     * sentinel or stop().
+     * @returns An error if the master could not be resolved. The client is
+     * still watched and is repointed once the master is known.
+     */
+    [[nodiscard]] awaitable<cpool::error> watch(client& client);
+
+    /**
+     * @brief Stops watching for failovers. This must be awaited before the
+     * sentinel is destroyed if watch() was called.
+     */
+    awaitable<void> stop();
+
+    /**
+     * @brief Returns the last known master, if any.
+     */
+    std::optional<master_address> master() const;
+
+    /**
+     * @brief Sets the callback to be executed when an error message is
+     * generated.
+     */
+    void set_logging_handler(logging_handler handler);
+
+  private:
+    /**
+     * @brief Starts the event listeners and the periodic check.
+     */
+    void start();
+
+    /**
+     * @brief Reads +switch-master events from one sentinel.
+     */
+    awaitable<void> listen(redis_subscriber* subscriber);
+
+    /**
+     * @brief Resolves the master every check_interval and repoints the clients
+     * if a majority of the sentinels agree on it.
+     */
+    awaitable<void> check_master();
+
+    /**
+     * @brief Repoints the watched clients if the master has changed.
+     */
+    void on_master(const master_address& address);
+
+    /**
+     * @brief Logs the message using the on_log_ event hander.
+     */
+    void log_message(log_level level, string_view message);
+
+  private:
+    /// The io_service that is used to schedule asynchronous events.
+    cpool::net::any_io_executor exec_;
+
+    /// The name of the master in the Sentinel configuration.
+    std::string master_name_;
+
+    /// Used to query each sentinel.
+    std::vector<std::unique_ptr<client>> sentinels_;
+
+    /// Used to receive the events of each sentinel.
+    std::vector<std::unique_ptr<redis_subscriber>> subscribers_;
+
+    /// How often the master is resolved.
+    std::chrono::milliseconds check_interval_;
+
+    /// The clients to repoint. Guarded by mutex_.
+    std::vector<client*> clients_;
+
+    /// The last known master. Guarded by mutex_.
+    std::optional<master_address> master_;
+
+    /// Guards clients_ and master_.
+    mutable std::mutex mutex_;
+
+    /// Used to wake the periodic check.
+    asio::steady_timer check_timer_;
+
+    /// Whether the listeners and the check should continue running.
+    std::atomic_bool watching_;
+
+    /// Counted down when the listeners and the check exit.
+    cpool::awaitable_latch latch_;
+
+    // event handlers
+    /// Called when there is a call to log_message. Does nothing if set to
+    /// nullptr.
+    logging_handler on_log_;
+};
+
+} // namespace redis
@@ -0,0 +1,176 @@
+#include "redis/sharded_client.hpp"
+
+#include <future>
+#include <stdexcept>
+
+#include <pthread.h>
+
+namespace redis {
+
+namespace {
+
+/// The shard that the current thread belongs to
+struct local_shard {
+    const void* owner = nullptr;
+    size_t index = 0;
+};
+
+thread_local local_shard this_shard;
+
+} // namespace
+
+sharded_client::shard_state::shard_state(const client_config& config)
+    : ctx(1)
+    , work(asio::make_work_guard(ctx))
+    , client(std::make_unique<redis::client>(ctx.get_executor(), config))
+    , thread() {}
+
+sharded_client::sharded_client(client_config config, size_t num_shards,
+                               bool pin_threads)
+    : config_(config)
+    , pin_threads_(pin_threads)
+    , shards_()
+    , next_shard_(0)
+    , running_(false) {
+
+    if (num_shards == 0) {
+        num_shards = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < num_shards; i++) {
+        shards_.push_back(std::make_unique<shard_state>(config_));
+    }
+}
+
+sharded_client::~sharded_client() { stop(); }
+
+void sharded_client::start() {
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true)) {
+        return;
+    }
+
+    for (size_t i = 0; i < shards_.size(); i++) {
+        shards_[i]->thread = std::thread(&sharded_client::run_shard, this, i);
+    }
+}
+
+void sharded_client::stop() {
+    if (this_shard.owner == this) {
+        // the shard would wait for itself to stop
+        throw std::logic_error("sharded_client::stop called from a shard");
+    }
+
+    bool expected = true;
+    if (!running_.compare_exchange_strong(expected, false)) {
+        return;
+    }
+
+    for (auto& shard : shards_) {
+        auto stopped =
+            co_spawn(shard->ctx, shard->client->stop(), asio::use_future);
+        stopped.wait();
+
+        shard->work.reset();
+        shard->ctx.stop();
+        shard->thread.join();
+    }
+}
+
+awaitable<cpool::error> sharded_client::warm_up() {
+    if (!running_) {
+        // nothing runs the shards
+        co_return std::error_code(client_error_code::client_stopped);
+    }
+
+    cpool::error error;
+    for (auto& shard : shards_) {
+        auto shard_error = co_await co_spawn(
+            shard->ctx, shard->client->warm_up(), asio::use_awaitable);
+        if (shard_error && !error) {
+            error = shard_error;
+        }
+    }
+
+    co_return error;
+}
+
+size_t sharded_client::size() const { return shards_.size(); }
+
+cpool::net::any_io_executor sharded_client::get_executor(size_t shard) {
+    return shards_.at(shard)->ctx.get_executor();
+}
+
+cpool::net::any_io_executor sharded_client::get_executor() {
+    return get_executor(next_shard());
+}
+
+client* sharded_client::local() {
+    if (this_shard.owner != this) {
+        return nullptr;
+    }
+
+    return shards_[this_shard.index]->client.get();
+}
+
+client& sharded_client::shard(size_t shard) {
+    return *shards_.at(shard)->client;
+}
+
+awaitable<reply> sharded_client::send(command command) {
+    auto client = local();
+    if (client != nullptr) {
+        co_return co_await client->send(std::move(command));
+    }
+    if (!running_) {
+        co_return reply(client_error_code::client_stopped);
+    }
+
+    auto& shard = shards_[next_shard()];
+    co_return co_await co_spawn(shard->ctx,
+                                shard->client->send(std::move(command)),
+                                asio::use_awaitable);
+}
+
+awaitable<replies> sharded_client::send(commands commands) {
+    auto client = local();
+    if (client != nullptr) {
+        co_return co_await client->send(std::move(commands));
+    }
+    if (!running_) {
+        co_return replies(commands.size(),
+                          reply(client_error_code::client_stopped));
+    }
+
+    auto& shard = shards_[next_shard()];
+    co_return co_await co_spawn(shard->ctx,
+                                shard->client->send(std::move(commands)),
+                                asio::use_awaitable);
+}
+
+void sharded_client::set_logging_handler(logging_handler handler) {
+    for (auto& shard : shards_) {
+        shard->client->set_logging_handler(handler);
+    }
+}
+
+size_t sharded_client::next_shard() {
+    return next_shard_.fetch_add(1, std::memory_order_relaxed) %
+           shards_.size();
+}
+
+void sharded_client::run_shard(size_t shard) {
+    this_shard = local_shard{this, shard};
+
+    if (pin_threads_) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(shard % CPU_SETSIZE, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    shards_[shard]->ctx.run();
+    this_shard = local_shard{};
+}
+
+} // namespace redis
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "redis/client.hpp"
+#include "redis/client_config.hpp"
+#include "redis/command.hpp"
+#include "redis/reply.hpp"
+#include "redis/types.hpp"
+
+namespace redis {
+
+namespace asio = boost::asio;
+using boost::asio::awaitable;
+
+/**
+ * @brief Runs one io_context, one thread and one client per shard so that
+ * coroutines running on a shard only ever use that shard's connection pool.
+ * Spawn work onto the shards with get_executor() to keep requests on the
+ * calling thread; requests made from any other thread hop to a shard.
+ */
+class sharded_client {
+
+  public:
+    /**
+     * @brief Creates a sharded_client.
+     * @param config The configuration used for every shard. max_connections
+     * and min_idle_connections apply to each shard separately.
+     * @param num_shards The number of shards. Zero creates one shard per
+     * hardware thread.
+     * @param pin_threads Pins the thread of shard N to CPU N.
+     */
+    sharded_client(client_config config, size_t num_shards = 0,
+                   bool pin_threads = false);
+
+    sharded_client(const sharded_client&) = delete;
+    sharded_client& operator=(const sharded_client&) = delete;
+
+    /**
+     * @brief Stops the shards if they are still running.
+     */
+    ~sharded_client();
+
+    /**
+     * @brief Starts one thread per shard. Must be called before the client
+     * is used.
+     */
+    void start();
+
+    /**
+     * @brief Stops the clients and joins the shard threads.
+     * @throws std::logic_error If called from a shard thread, which would
+     * wait for itself forever. The same applies to the destructor.
+     */
+    void stop();
+
+    /**
+     * @brief Warms up the client of every shard. @see client::warm_up
+     * @returns The first error encountered, if any, or
+     * client_error_code::client_stopped if the shards are not running.
+     */
+    [[nodiscard]] awaitable<cpool::error> warm_up();
+
+    /**
+     * @brief Returns the number of shards.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns the executor of the given shard.
+     */
+    cpool::net::any_io_executor get_executor(size_t shard);
+
+    /**
+     * @brief Returns the executor of the next shard in round-robin order. Use
+     * this to spread work across the shards.
+     */
+    cpool::net::any_io_executor get_executor();
+
+    /**
+     * @brief Returns the client that belongs to the calling thread, or
+     * nullptr if the caller is not running on one of the shards.
+     */
+    client* local();
+
+    /**
+     * @brief Returns the client of the given shard.
+     */
+    client& shard(size_t shard);
+
+    /**
+     * @brief Sends the command using the calling thread's shard. Callers on
+     * other threads are moved to a shard for the duration of the request.
+     * @param command The command to send to the server.
+     * @returns The reply from the server, or client_error_code::client_stopped
+     * if the shards are not running.
+     */
+    [[nodiscard]] awaitable<reply> send(command command);
+
+    /**
+     * @brief Sends the commands using the calling thread's shard. Callers on
+     * other threads are moved to a shard for the duration of the request.
+     * @param commands The commands to send to the server.
+     * @returns The replies from the server, or
+     * client_error_code::client_stopped for each command if the shards are
+     * not running.
+     */
+    [[nodiscard]] awaitable<replies> send(commands commands);
+
+    /**
+     * @brief Sets the callback to be executed when an error message is
+     * generated. The callback is invoked from every shard thread.
+     */
+    void set_logging_handler(logging_handler handler);
+
+  private:
+    /// The state owned by one core
+    struct shard_state {
+        shard_state(const client_config& config);
+
+        asio::io_context ctx;
+        asio::executor_work_guard<asio::io_context::executor_type> work;
+        std::unique_ptr<redis::client> client;
+        std::thread thread;
+    };
+
+    /**
+     * @brief Returns the index of the next shard in round-robin order.
+     */
+    size_t next_shard();
+
+    /**
+     * @brief Runs the io_context of a shard on the calling thread.
+     */
+    void run_shard(size_t shard);
+
+  private:
+    /// The configuration options of the clients.
+    client_config config_;
+
+    /// Whether shard threads are pinned to CPUs.
+    bool pin_threads_;
+
+    /// One entry per core.
+    std::vector<std::unique_ptr<shard_state>> shards_;
+
+    /// Used to distribute work from threads that do not own a shard.
+    std::atomic<size_t> next_shard_;
+
+    /// Whether the shard threads are running.
+    std::atomic_bool running_;
+};
+
+} // namespace redis
@@ -0,0 +1,164 @@
+#include "redis/sharded_pool_client.hpp"
+
+#include <algorithm>
+
+#include "redis/node_pipeline.hpp"
+
+namespace redis {
+
+namespace {
+
+/// Returns the replies of a pipeline that had no node to go to.
+awaitable<replies> no_nodes(size_t count) {
+    co_return replies(count, reply(client_error_code::disconnected));
+}
+
+} // namespace
+
+sharded_pool_client::sharded_pool_client(cpool::net::any_io_executor exec,
+                                         std::vector<client_config> nodes,
+                                         hash_algorithm algorithm)
+    : exec_(std::move(exec))
+    , algorithm_(algorithm)
+    , nodes_()
+    , endpoints_()
+    , slots_()
+    , mutex_()
+    , on_log_(nullptr) {
+
+    for (auto& config : nodes) {
+        auto name = endpoint(config);
+        if (std::find(endpoints_.begin(), endpoints_.end(), name) !=
+            endpoints_.end()) {
+            continue;
+        }
+
+        nodes_.push_back(std::make_unique<client>(exec_, std::move(config)));
+        endpoints_.push_back(std::move(name));
+    }
+
+    slots_ = assign_slots(algorithm_, endpoints_);
+}
+
+awaitable<cpool::error> sharded_pool_client::warm_up() {
+    std::vector<client*> nodes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& node : nodes_) {
+            nodes.push_back(node.get());
+        }
+    }
+
+    cpool::error error;
+    for (auto* node : nodes) {
+        auto node_error = co_await node->warm_up();
+        if (node_error && !error) {
+            error = node_error;
+        }
+    }
+
+    co_return error;
+}
+
+awaitable<void> sharded_pool_client::stop() {
+    std::vector<client*> nodes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& node : nodes_) {
+            nodes.push_back(node.get());
+        }
+    }
+
+    for (auto* node : nodes) {
+        co_await node->stop();
+    }
+}
+
+bool sharded_pool_client::add_node(client_config config) {
+    auto name = endpoint(config);
+    auto node = std::make_unique<client>(exec_, std::move(config));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (std::find(endpoints_.begin(), endpoints_.end(), name) !=
+        endpoints_.end()) {
+        return false;
+    }
+
+    if (on_log_) {
+        node->set_logging_handler(on_log_);
+        on_log_(log_level::info, fmt::format("adding node {}", name));
+    }
+
+    nodes_.push_back(std::move(node));
+    endpoints_.push_back(std::move(name));
+    slots_ = assign_slots(algorithm_, endpoints_);
+    return true;
+}
+
+awaitable<reply> sharded_pool_client::send(command command) {
+    auto* node = route(command);
+    if (node == nullptr) {
+        co_return reply(client_error_code::disconnected);
+    }
+
+    co_return co_await node->send(std::move(command));
+}
+
+awaitable<replies> sharded_pool_client::send(commands commands) {
+    co_return co_await send_by_node(
+        exec_, commands,
+        [this](const command& command) { return route(command); },
+        [](client* node, const redis::commands& group) -> awaitable<replies> {
+            if (node == nullptr) {
+                return no_nodes(group.size());
+            }
+            return node->send(group);
+        });
+}
+
+size_t sharded_pool_client::node_for_key(std::string_view key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_[hash_slot(key)];
+}
+
+size_t sharded_pool_client::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nodes_.size();
+}
+
+client& sharded_pool_client::node(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return *nodes_.at(index);
+}
+
+void sharded_pool_client::set_logging_handler(logging_handler handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    on_log_ = std::move(handler);
+    for (auto& node : nodes_) {
+        node->set_logging_handler(on_log_);
+    }
+}
+
+std::string sharded_pool_client::endpoint(const client_config& config) {
+    if (!config.unix_socket.empty()) {
+        return config.unix_socket;
+    }
+
+    return config.host + ":" + std::to_string(config.port);
+}
+
+client* sharded_pool_client::route(const command& command) const {
+    auto keys = command.keys();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (nodes_.empty()) {
+        return nullptr;
+    }
+    if (keys.empty()) {
+        return nodes_.front().get();
+    }
+
+    return nodes_[slots_[hash_slot(keys.front())]].get();
+}
+
+} // namespace redis
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "redis/client.hpp"
+#include "redis/client_config.hpp"
+#include "redis/command.hpp"
+#include "redis/consistent_hash.hpp"
+#include "redis/hash_slot.hpp"
+#include "redis/reply.hpp"
+#include "redis/types.hpp"
+
+namespace redis {
+
+namespace asio = boost::asio;
+using boost::asio::awaitable;
+
+/**
+ * @brief Spreads keys over independent Redis servers with a consistent hash,
+ * for caches that do not need Redis Cluster. Each node has its own client and
+ * connection pool. Keys are assigned by hash slot, so hash tags keep related
+ * keys on one node, and adding a node only moves about 1/N of the keys.
+ */
+class sharded_pool_client {
+
+  public:
+    /**
+     * @brief Creates a sharded pool client.
+     * @param exec The Asio executor to use for event handling.
+     * @param nodes The configuration of each node. Commands fail with
+     * client_error_code::disconnected until a node is added.
+     * @param algorithm How slots are spread over the nodes.
+     */
+    sharded_pool_client(cpool::net::any_io_executor exec,
+                        std::vector<client_config> nodes,
+                        hash_algorithm algorithm = hash_algorithm::ketama);
+
+    sharded_pool_client(const sharded_pool_client&) = delete;
+    sharded_pool_client& operator=(const sharded_pool_client&) = delete;
+
+    /**
+     * @brief Warms up the client of every node. @see client::warm_up
+     * @returns The first error encountered, if any.
+     */
+    [[nodiscard]] awaitable<cpool::error> warm_up();
+
+    /**
+     * @brief Stops the clients of every node. This must be awaited before the
+     * sharded pool client is destroyed if warm_up() was called.
+     */
+    awaitable<void> stop();
+
+    /**
+     * @brief Adds a node and moves the slots it now owns to it. With
+     * hash_algorithm::jump the node is appended to the end of the list.
+     * @param config The configuration of the node.
+     * @returns False if a node with the same address already exists.
+     */
+    bool add_node(client_config config);
+
+    /**
+     * @brief Sends the command to the node that owns its first key. Commands
+     * without a key go to the first node.
+     * @param command The command to send to the server.
+     * @returns The reply from the server.
+     */
+    [[nodiscard]] awaitable<reply> send(command command);
+
+    /**
+     * @brief Splits the commands by node and sends one pipeline to each node,
+     * all at the same time. MGET, DEL, EXISTS, TOUCH and UNLINK with keys on
+     * several nodes are split and their replies are merged.
+     * @param commands The commands to send to the servers.
+     * @returns One reply per command, in order.
+     */
+    [[nodiscard]] awaitable<replies> send(commands commands);
+
+    /**
+     * @brief Returns the index of the node that owns the key.
+     */
+    size_t node_for_key(std::string_view key) const;
+
+    /**
+     * @brief Returns the number of nodes.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns the client of the given node.
+     */
+    client& node(size_t index);
+
+    /**
+     * @brief Sets the callback to be executed when an error message is
+     * generated.
+     */
+    void set_logging_handler(logging_handler handler);
+
+  private:
+    /**
+     * @brief Returns the address used to place a node on the ring.
+     */
+    static std::string endpoint(const client_config& config);
+
+    /**
+     * @brief Returns the node that owns the first key of the command, or
+     * nullptr if there are no nodes.
+     */
+    client* route(const command& command) const;
+
+  private:
+    /// The io_service that is used to schedule asynchronous events.
+    cpool::net::any_io_executor exec_;
+
+    /// How slots are spread over the nodes.
+    hash_algorithm algorithm_;
+
+    /// The clients of the nodes. Nodes are kept until the client is
+    /// destroyed so routed pointers stay valid. Guarded by mutex_.
+    std::vector<std::unique_ptr<client>> nodes_;
+
+    /// The address of each node. Guarded by mutex_.
+    std::vector<std::string> endpoints_;
+
+    /// The index of the owner of each hash slot. Guarded by mutex_.
+    std::vector<uint16_t> slots_;
+
+    /// Guards nodes_, endpoints_ and slots_.
+    mutable std::mutex mutex_;
+
+    // event handlers
+    /// Called when there is a call to log_message. Does nothing if set to
+    /// nullptr.
+    logging_handler on_log_;
+};
+
+} // namespace redis
@@ -0,0 +1,113 @@
+#include "redis/slot_pipeline.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "redis/hash_slot.hpp"
+
+namespace redis {
+
+slot_pipeline::slot_pipeline(const commands& commands)
+    : split_()
+    , parts_() {
+
+    for (const auto& command : commands) {
+        const auto& name = command.name();
+        auto keys = command.keys();
+        bool splittable = (name == "MGET" || name == "DEL" ||
+                           name == "EXISTS" || name == "TOUCH" ||
+                           name == "UNLINK");
+
+        // group the keys by slot in the order the slots first appear
+        std::vector<std::pair<uint16_t, std::vector<std::string>>> groups;
+        std::vector<key_position> positions;
+        if (splittable && keys.size() > 1) {
+            for (const auto& key : keys) {
+                auto slot = hash_slot(key);
+                auto it = std::find_if(
+                    groups.begin(), groups.end(),
+                    [slot](const auto& group) { return group.first == slot; });
+                if (it == groups.end()) {
+                    it = groups.insert(groups.end(), {slot, {command.name()}});
+                }
+                it->second.push_back(key);
+                positions.push_back(key_position{
+                    static_cast<size_t>(it - groups.begin()),
+                    it->second.size() - 2});
+            }
+        }
+
+        if (groups.size() <= 1) {
+            parts_.push_back(
+                part_range{merge_kind::single, split_.size(), 1, {}});
+            split_.push_back(command);
+            continue;
+        }
+
+        auto kind = (name == "MGET") ? merge_kind::array : merge_kind::sum;
+        parts_.push_back(part_range{kind, split_.size(), groups.size(),
+                                    (kind == merge_kind::array)
+                                        ? std::move(positions)
+                                        : std::vector<key_position>()});
+        for (auto& group : groups) {
+            split_.push_back(redis::command(std::move(group.second)));
+        }
+    }
+}
+
+const commands& slot_pipeline::split_commands() const { return split_; }
+
+replies slot_pipeline::merge(const replies& split_replies) const {
+    replies merged;
+    merged.reserve(parts_.size());
+
+    for (const auto& part : parts_) {
+        if (part.first + part.count > split_replies.size()) {
+            merged.emplace_back(client_error_code::response_command_mismatch);
+            continue;
+        }
+
+        if (part.kind == merge_kind::single) {
+            merged.push_back(split_replies[part.first]);
+            continue;
+        }
+
+        auto begin = split_replies.cbegin() + part.first;
+        auto end = begin + part.count;
+        auto failed = std::find_if(
+            begin, end, [](const auto& reply) { return (bool)reply.error(); });
+        if (failed != end) {
+            merged.push_back(*failed);
+            continue;
+        }
+
+        if (part.kind == merge_kind::sum) {
+            int64_t total = 0;
+            for (auto it = begin; it != end; ++it) {
+                total += it->value().as<int64_t>().value_or(0);
+            }
+            merged.emplace_back(redis::value(total));
+            continue;
+        }
+
+        std::vector<redis_array> values;
+        for (auto it = begin; it != end; ++it) {
+            values.push_back(it->value().as<redis_array>().value_or(
+                redis_array()));
+        }
+
+        redis_array array;
+        for (const auto& position : part.positions) {
+            const auto& values_of_part = values[position.part];
+            array.push_back((position.index < values_of_part.size())
+                                ? values_of_part[position.index]
+                                : redis::value());
+        }
+        merged.emplace_back(redis::value(array));
+    }
+
+    return merged;
+}
+
+} // namespace redis
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "redis/command.hpp"
+#include "redis/reply.hpp"
+
+namespace redis {
+
+/**
+ * @brief Splits a pipeline so that every command touches a single hash slot.
+ * Multi-key MGET, DEL, EXISTS, TOUCH and UNLINK commands whose keys span
+ * several slots are split into one command per slot; all other commands are
+ * kept as they are. The replies to the split commands are merged back into
+ * one reply per original command, in the original order.
+ */
+class slot_pipeline {
+
+  public:
+    /**
+     * @brief Splits the commands by hash slot.
+     * @param commands The pipeline to split.
+     */
+    explicit slot_pipeline(const commands& commands);
+
+    /**
+     * @returns The commands to send. Each one touches at most one slot.
+     */
+    const commands& split_commands() const;
+
+    /**
+     * @brief Reassembles the replies of split_commands().
+     * @param split_replies One reply per split command.
+     * @returns One reply per original command. MGET values are returned in
+     * the order of the original keys and the counts of DEL, EXISTS, TOUCH and
+     * UNLINK are summed. The first error of a split command is returned as
+     * its reply.
+     */
+    replies merge(const replies& split_replies) const;
+
+  private:
+    /// How the replies of a command are merged
+    enum class merge_kind : uint8_t {
+        /// The command was not split.
+        single,
+        /// The values of the parts are reordered into one array.
+        array,
+        /// The integers of the parts are added.
+        sum
+    };
+
+    /// Where the value of one MGET key is found in the split replies
+    struct key_position {
+        size_t part;
+        size_t index;
+    };
+
+    /// The split commands that make up an original command
+    struct part_range {
+        merge_kind kind;
+        size_t first;
+        size_t count;
+        std::vector<key_position> positions;
+    };
+
+  private:
+    /// The commands to send.
+    commands split_;
+
+    /// One entry per original command.
+    std::vector<part_range> parts_;
+};
+
+} // namespace redis
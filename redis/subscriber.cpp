@@ -1,13 +1,106 @@
 #include "redis/subscriber.hpp"
 
+#include "redis/tcp_connection.hpp"
+
 #include <absl/cleanup/cleanup.h>
 
 namespace redis {
 
+namespace {
+
+/// The number of bytes requested from the connection by each read.
+constexpr size_t read_chunk_size = 4096;
+
+/// The number of strands the handlers of a subscriber are spread over. The
+/// channels that share a strand are handled one after the other.
+constexpr size_t handler_strand_count = 64;
+
+/// Shared by read_batch() and its timer, which may complete after the batch
+/// was returned.
+struct batch_expiry {
+    /// Cancels the receive when the timer expires.
+    asio::cancellation_signal signal;
+
+    /// Whether the timer expired.
+    bool expired = false;
+};
+
+/// The number of channels or patterns sent in one SUBSCRIBE or PSUBSCRIBE.
+constexpr size_t subscribe_chunk_size = 1000;
+
+/// The number of bytes of channels or patterns sent in one SUBSCRIBE or
+/// PSUBSCRIBE, so long names do not make a single huge write.
+constexpr size_t subscribe_chunk_bytes = 64 * 1024;
+
+/// Returns the first element of an array reply, e.g. "message" or
+/// "subscribe", or an empty string for other replies.
+std::string kind_of(const reply& reply) {
+    auto array = reply.value().as<redis_array>();
+    if (!array || array->empty()) {
+        return "";
+    }
+
+    return array->front().as<std::string>().value_or("");
+}
+
+/// Returns true if the reply is a message published on a channel, as opposed
+/// to the reply of a command.
+bool is_published(const reply& reply) {
+    auto kind = kind_of(reply);
+    return kind == "message" || kind == "pmessage";
+}
+
+/// Splits a subscription to many channels or patterns into commands of at
+/// most subscribe_chunk_size arguments or subscribe_chunk_bytes bytes.
+template <typename Arguments>
+std::vector<command> chunked(const std::string& name,
+                             const Arguments& arguments) {
+    std::vector<command> commands;
+    std::vector<string> parts;
+    size_t bytes = 0;
+    for (const auto& argument : arguments) {
+        if (parts.empty()) {
+            parts.push_back(name);
+            bytes = 0;
+        }
+        parts.push_back(argument);
+        bytes += argument.size();
+        if (parts.size() > subscribe_chunk_size ||
+            bytes >= subscribe_chunk_bytes) {
+            commands.emplace_back(std::move(parts));
+            parts.clear();
+        }
+    }
+
+    if (!parts.empty()) {
+        commands.emplace_back(std::move(parts));
+    }
+    return commands;
+}
+
+} // namespace
+
 redis_subscriber::redis_subscriber(
-    std::unique_ptr<cpool::tcp_connection> connection)
+    std::unique_ptr<connection> connection)
     : connection_(std::move(connection))
-    , message_queue_(connection_.get_executor(), 8)
+    , message_queue_(connection_.get_executor(),
+                     config_.subscriber_queue_capacity)
+    , dropped_oldest_(0)
+    , dropped_newest_(0)
+    , overflow_disconnects_(0)
+    , channel_handlers_()
+    , pattern_handlers_()
+    , handler_strands_()
+    , in_flight_()
+    , max_in_flight_(0)
+    , channels_()
+    , patterns_()
+    , resubscribing_(false)
+    , restored_channels_()
+    , restored_patterns_()
+    , on_reconnect_()
+    , waiters_()
+    , read_buffer_()
     , on_log_()
     , latch_(connection_.get_executor(), 1)
     , read_messages_(false) {}
@@ -16,8 +109,24 @@ redis_subscriber::redis_subscriber(cpool::net::any_io_executor exec,
                                    client_config config)
     : exec_(std::move(exec))
     , config_(config)
+    , tls_context_(make_tls_context(config_))
     , connection_(connection_ctor())
-    , message_queue_(exec_, 8)
+    , message_queue_(exec_, config_.subscriber_queue_capacity)
+    , dropped_oldest_(0)
+    , dropped_newest_(0)
+    , overflow_disconnects_(0)
+    , channel_handlers_()
+    , pattern_handlers_()
+    , handler_strands_()
+    , in_flight_()
+    , max_in_flight_(0)
+    , channels_()
+    , patterns_()
+    , resubscribing_(false)
+    , restored_channels_()
+    , restored_patterns_()
+    , on_reconnect_()
+    , read_buffer_()
     , on_log_(nullptr)
     , latch_(exec_, 1)
     , read_messages_(false) {}
@@ -26,8 +135,23 @@ redis_subscriber::redis_subscriber(net::any_io_executor exec, string host,
                                    uint16_t port)
     : exec_(std::move(exec))
     , config_()
-    , connection_(std::make_unique<cpool::tcp_connection>(exec_, host, port))
-    , message_queue_(exec_, 8)
+    , connection_(std::make_unique<tcp_connection>(exec_, host, port))
+    , message_queue_(exec_, config_.subscriber_queue_capacity)
+    , dropped_oldest_(0)
+    , dropped_newest_(0)
+    , overflow_disconnects_(0)
+    , channel_handlers_()
+    , pattern_handlers_()
+    , handler_strands_()
+    , in_flight_()
+    , max_in_flight_(0)
+    , channels_()
+    , patterns_()
+    , resubscribing_(false)
+    , restored_channels_()
+    , restored_patterns_()
+    , on_reconnect_()
+    , read_buffer_()
     , on_log_()
     , latch_(exec_, 1)
     , read_messages_(false) {
@@ -45,23 +169,43 @@ awaitable<cpool::error> redis_subscriber::ping() {
 
 awaitable<cpool::error> redis_subscriber::subscribe(string channel) {
     log_message(log_level::debug, fmt::format("Subscribing to {0}", channel));
-    return send(command(std::vector<string>{"SUBSCRIBE", channel}));
+    auto request = command(std::vector<string>{"SUBSCRIBE", channel});
+    auto error = co_await send(std::move(request));
+    if (!error) {
+        channels_.insert(std::move(channel));
+    }
+    co_return error;
 }
 
 awaitable<cpool::error> redis_subscriber::unsubscribe(string channel) {
     log_message(log_level::debug, fmt::format("Unsubscribing to {0}", channel));
-    return send(command(std::vector<string>{"UNSUBSCRIBE", channel}));
+    auto request = command(std::vector<string>{"UNSUBSCRIBE", channel});
+    auto error = co_await send(std::move(request));
+    if (!error) {
+        channels_.erase(channel);
+    }
+    co_return error;
 }
 
 awaitable<cpool::error> redis_subscriber::psubscribe(string pattern) {
     log_message(log_level::debug, fmt::format("Psubscribing to {0}", pattern));
-    return send(command(std::vector<string>{"PSUBSCRIBE", pattern}));
+    auto request = command(std::vector<string>{"PSUBSCRIBE", pattern});
+    auto error = co_await send(std::move(request));
+    if (!error) {
+        patterns_.insert(std::move(pattern));
+    }
+    co_return error;
 }
 
 awaitable<cpool::error> redis_subscriber::punsubscribe(string pattern) {
     log_message(log_level::debug,
                 fmt::format("Punsubscribing to {0}", pattern));
-    return send(command(std::vector<string>{"PUNSUBSCRIBE", pattern}));
+    auto request = command(std::vector<string>{"PUNSUBSCRIBE", pattern});
+    auto error = co_await send(std::move(request));
+    if (!error) {
+        patterns_.erase(pattern);
+    }
+    co_return error;
 }
 
 void redis_subscriber::start() {
@@ -79,21 +223,44 @@ awaitable<void> redis_subscriber::stop() {
     read_messages_ = false;
     message_queue_.close();
     connection_.cancel();
+    if (in_flight_) {
+        in_flight_->cancel();
+    }
     co_await latch_.wait();
+    fail_waiters(std::error_code(client_error_code::disconnected));
+
+    if (in_flight_) {
+        // every slot is free once the handlers in flight are done
+        cpool::error_code ec;
+        auto tok = asio::redirect_error(asio::use_awaitable, ec);
+        for (size_t i = 0; i < max_in_flight_; i++) {
+            co_await in_flight_->async_send(cpool::error_code(), tok);
+        }
+        while (in_flight_->try_receive([](cpool::error_code) {})) {
+        }
+    }
     co_await connection_.async_disconnect();
 }
 
 awaitable<cpool::error> redis_subscriber::reset() {
     log_message(log_level::debug, fmt::format("Reseting subscriptions"));
-    return send(command("RESET"));
+    auto error = co_await send(command("RESET"));
+    if (!error) {
+        channels_.clear();
+        patterns_.clear();
+    }
+    co_return error;
 }
 
 // Send Commands
 awaitable<cpool::error> redis_subscriber::send(command command) {
+    return send_buffer(command.serialized_command());
+}
+
+awaitable<cpool::error> redis_subscriber::send_buffer(std::string buffer) {
     log_message(log_level::trace, "getting connection for send");
     auto conn = co_await connection_.get();
     log_message(log_level::trace, "got connection for send");
-    auto buffer = command.serialized_command();
     auto [write_error, bytes_written] =
         co_await conn->async_write(asio::buffer(buffer));
     if (write_error) {
@@ -108,16 +275,28 @@ awaitable<cpool::error> redis_subscriber::send(command command) {
 
 awaitable<void> redis_subscriber::read_messages() {
     log_message(log_level::trace, "starting to read messages");
-    buffer_t read_buffer(4096);
+    read_buffer_.clear();
 
     while (read_messages_) {
         cpool::error_code err;
         log_message(log_level::trace, "getting connection");
         auto conn = co_await connection_.get();
+        if (resubscribing_) {
+            resubscribing_ = false;
+            err = co_await resubscribe(conn);
+            if (err) {
+                break;
+            }
+            continue;
+        }
 
+        // read after the leftover of the last read
         log_message(log_level::trace, "reading");
-        auto [read_error, bytes_read] =
-            co_await conn->async_read_some(asio::buffer(read_buffer));
+        auto used = read_buffer_.size();
+        read_buffer_.resize(used + read_chunk_size);
+        auto [read_error, bytes_read] = co_await conn->async_read_some(
+            asio::buffer(read_buffer_.data() + used, read_chunk_size));
+        read_buffer_.resize(used + bytes_read);
         if (read_error.value() == (int)net::error::operation_aborted) {
             log_message(log_level::trace, "cancelled, wrapping up");
             break;
@@ -126,11 +305,14 @@ awaitable<void> redis_subscriber::read_messages() {
             log_message(
                 log_level::error,
                 std::error_code(client_error_code::read_error).message());
+            err = co_await drop_connection(conn);
+            if (err) {
+                break;
+            }
             continue;
         }
 
-        err = co_await parse_buffer(read_buffer.cbegin(),
-                                    read_buffer.cbegin() + bytes_read);
+        err = co_await parse_buffer(conn);
         if (err) {
             break;
         }
@@ -141,25 +323,363 @@ awaitable<void> redis_subscriber::read_messages() {
 }
 
 awaitable<cpool::error_code>
-redis_subscriber::parse_buffer(buffer_t::const_iterator begin,
-                               buffer_t::const_iterator end) {
-    auto it = begin;
+redis_subscriber::parse_buffer(connection* conn) {
+    auto it = read_buffer_.cbegin();
+    auto end = read_buffer_.cend();
+    cpool::error_code ec;
+    auto has_handlers =
+        !channel_handlers_.empty() || !pattern_handlers_.empty();
     while (it != end) {
+        if (has_handlers) {
+            // messages with a handler are never decoded into a reply
+            auto next = it;
+            auto message = scan_message(next, end);
+            auto handler = message ? handler_for(*message) : nullptr;
+            if (handler && handler_strands_.empty()) {
+                run_handler(*handler, *message);
+                it = next;
+                continue;
+            }
+
+            if (handler) {
+                it = next;
+                ec = co_await post_handler(std::move(handler), *message);
+                if (ec) {
+                    log_message(log_level::trace, "stopped, wrapping up");
+                    break;
+                }
+                continue;
+            }
+        }
+
         reply reply;
-        it = reply.load_data(it, end);
+        auto next = reply.load_data(it, end);
+        if (reply.error() == parse_error_code::eof) {
+            // the rest of the message comes with the next read
+            break;
+        }
+
+        if (reply.error() == parse_error_code::malformed_message) {
+            // the start of the next message is unknown, start over
+            log_message(log_level::error,
+                        fmt::format("could not parse message: {}",
+                                    reply.error().message()));
+            co_return co_await drop_connection(conn);
+        }
+
+        it = next;
+        if (confirm_restored(reply)) {
+            // the subscription was made before the reconnect
+            continue;
+        }
+
+        if (!waiters_.empty() && confirm(reply)) {
+            continue;
+        }
+
+        if (config_.subscriber_overflow != overflow_policy::block &&
+            is_published(reply)) {
+            if (!offer(reply)) {
+                overflow_disconnects_++;
+                log_message(log_level::warn,
+                            "subscriber queue is full, disconnecting");
+                co_return co_await drop_connection(conn);
+            }
+            continue;
+        }
 
-        cpool::error_code ec;
         auto tok = asio::redirect_error(asio::use_awaitable, ec);
         co_await message_queue_.async_send(ec, reply, tok);
         if (ec) {
             log_message(log_level::trace, "channel closed, wrapping up");
-            co_return ec;
+            break;
+        }
+    }
+
+    read_buffer_.erase(read_buffer_.cbegin(), it);
+    co_return ec;
+}
+
+std::shared_ptr<const message_handler>
+redis_subscriber::handler_for(const message_view& message) const {
+    auto& handlers =
+        message.pattern.empty() ? channel_handlers_ : pattern_handlers_;
+    auto found = handlers.find(message.pattern.empty() ? message.channel
+                                                       : message.pattern);
+    if (found == handlers.end()) {
+        return nullptr;
+    }
+
+    return found->second;
+}
+
+void redis_subscriber::run_handler(const message_handler& handler,
+                                   const message_view& message) {
+    try {
+        handler(message);
+    } catch (const std::exception& ex) {
+        // the read loop must survive a failing handler
+        log_message(log_level::error,
+                    fmt::format("message handler for {} failed: {}",
+                                message.channel, ex.what()));
+    }
+}
+
+awaitable<cpool::error_code>
+redis_subscriber::post_handler(std::shared_ptr<const message_handler> handler,
+                               const message_view& message) {
+    // waits while max_in_flight_ messages are being handled
+    cpool::error_code ec;
+    auto tok = asio::redirect_error(asio::use_awaitable, ec);
+    co_await in_flight_->async_send(cpool::error_code(), tok);
+    if (ec) {
+        co_return ec;
+    }
+
+    auto hash = std::hash<std::string_view>{}(message.channel);
+    auto& strand = handler_strands_[hash % handler_strands_.size()];
+    asio::post(strand, [this, handler = std::move(handler),
+                        message = message.to_message()]() {
+        run_handler(*handler, message_view{message.channel, message.pattern,
+                                           message.contents});
+        in_flight_->try_receive([](cpool::error_code) {});
+    });
+
+    co_return ec;
+}
+
+bool redis_subscriber::offer(const reply& message) {
+    if (message_queue_.try_send(cpool::error_code(), message)) {
+        return true;
+    }
+
+    switch (config_.subscriber_overflow) {
+    case overflow_policy::drop_oldest: {
+        // only a published message may be dropped, the replies in front of
+        // it go back to the queue in their original order
+        std::vector<reply> kept;
+        bool dropped = false;
+        while (!dropped) {
+            std::optional<reply> oldest;
+            message_queue_.try_receive(
+                [&oldest](cpool::error_code, reply queued) {
+                    oldest = std::move(queued);
+                });
+            if (!oldest) {
+                break;
+            }
+            if (is_published(*oldest)) {
+                dropped = true;
+            } else {
+                kept.push_back(std::move(*oldest));
+            }
+        }
+
+        if (!kept.empty()) {
+            // the rest of the queue must stay behind the kept replies
+            bool more = true;
+            while (more) {
+                more = message_queue_.try_receive(
+                    [&kept](cpool::error_code, reply queued) {
+                        kept.push_back(std::move(queued));
+                    });
+            }
+            for (auto& queued : kept) {
+                message_queue_.try_send(cpool::error_code(), std::move(queued));
+            }
+        }
+
+        if (dropped) {
+            dropped_oldest_++;
+        }
+        if (!dropped ||
+            !message_queue_.try_send(cpool::error_code(), message)) {
+            // the queue holds no published message or has no room at all
+            dropped_newest_++;
+        }
+        return true;
+    }
+
+    case overflow_policy::drop_newest:
+        dropped_newest_++;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+awaitable<cpool::error>
+redis_subscriber::send_subscriptions(string kind,
+                                     std::vector<string> arguments) {
+    if (arguments.empty()) {
+        co_return cpool::error();
+    }
+    if (!running()) {
+        // nothing would read the confirmations
+        co_return std::error_code(client_error_code::disconnected);
+    }
+
+    // a repeated name is confirmed more than once, keep the first only
+    std::unordered_set<string> seen;
+    std::erase_if(arguments, [&seen](const string& argument) {
+        return !seen.insert(argument).second;
+    });
+
+    auto commands = chunked(kind, arguments);
+    log_message(log_level::debug,
+                fmt::format("sending {} {} commands for {} arguments",
+                            commands.size(), kind, arguments.size()));
+
+    auto waiter = std::make_shared<confirmation_waiter>(
+        co_await asio::this_coro::executor);
+    waiter->kind = kind;
+    waiter->remaining.insert(arguments.begin(), arguments.end());
+    waiter->done.expires_at(asio::steady_timer::time_point::max());
+    waiters_.push_back(waiter);
+
+    // one write per chunk keeps the buffers small
+    for (auto& command : commands) {
+        auto error = co_await send_buffer(command.serialized_command());
+        if (error) {
+            std::erase(waiters_, waiter);
+            co_return error;
+        }
+    }
+
+    if (kind == "subscribe") {
+        channels_.insert(arguments.begin(), arguments.end());
+    } else if (kind == "psubscribe") {
+        patterns_.insert(arguments.begin(), arguments.end());
+    } else {
+        auto& subscriptions = kind == "unsubscribe" ? channels_ : patterns_;
+        for (const auto& argument : arguments) {
+            subscriptions.erase(argument);
         }
     }
 
+    cpool::error_code ec;
+    if (!waiter->remaining.empty() && !waiter->error) {
+        co_await waiter->done.async_wait(
+            asio::redirect_error(asio::use_awaitable, ec));
+    }
+    co_return waiter->error;
+}
+
+bool redis_subscriber::confirm(const reply& reply) {
+    auto array = reply.value().as<redis_array>();
+    if (!array || array->size() < 2) {
+        return false;
+    }
+
+    auto kind = (*array)[0].as<string>().value_or("");
+    auto argument = (*array)[1].as<string>().value_or("");
+    for (auto it = waiters_.begin(); it != waiters_.end(); ++it) {
+        auto& waiter = *it;
+        if (waiter->kind != kind) {
+            continue;
+        }
+
+        auto found = waiter->remaining.find(argument);
+        if (found == waiter->remaining.end()) {
+            continue;
+        }
+
+        waiter->remaining.erase(found);
+        if (waiter->remaining.empty()) {
+            waiter->done.expires_at(asio::steady_timer::time_point::min());
+            waiters_.erase(it);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void redis_subscriber::fail_waiters(cpool::error error) {
+    for (auto& waiter : waiters_) {
+        waiter->error = error;
+        waiter->done.expires_at(asio::steady_timer::time_point::min());
+    }
+    waiters_.clear();
+}
+
+awaitable<cpool::error_code> redis_subscriber::resubscribe(connection* conn) {
+    auto commands = chunked("SUBSCRIBE", channels_);
+    auto patterns = chunked("PSUBSCRIBE", patterns_);
+    commands.insert(commands.end(), patterns.begin(), patterns.end());
+
+    if (!commands.empty()) {
+        log_message(log_level::info,
+                    fmt::format("restoring {} subscriptions in {} commands",
+                                channels_.size() + patterns_.size(),
+                                commands.size()));
+        for (auto& command : commands) {
+            auto buffer = command.serialized_command();
+            auto [write_error, bytes_written] =
+                co_await conn->async_write(asio::buffer(buffer));
+            if (write_error) {
+                log_message(log_level::error,
+                            fmt::format("could not restore subscriptions: {}",
+                                        write_error.message()));
+                co_return co_await drop_connection(conn);
+            }
+        }
+        restored_channels_.insert(channels_.begin(), channels_.end());
+        restored_patterns_.insert(patterns_.begin(), patterns_.end());
+    }
+
+    if (on_reconnect_) {
+        on_reconnect_();
+    }
     co_return cpool::error_code();
 }
 
+bool redis_subscriber::confirm_restored(const reply& reply) {
+    if (restored_channels_.empty() && restored_patterns_.empty()) {
+        return false;
+    }
+
+    auto array = reply.value().as<redis_array>();
+    if (!array || array->size() < 2) {
+        return false;
+    }
+
+    auto kind = (*array)[0].as<string>().value_or("");
+    if (kind != "subscribe" && kind != "psubscribe") {
+        return false;
+    }
+
+    auto& restored =
+        (kind == "subscribe") ? restored_channels_ : restored_patterns_;
+    auto found = restored.find((*array)[1].as<string>().value_or(""));
+    if (found == restored.end()) {
+        return false;
+    }
+
+    restored.erase(found);
+    return true;
+}
+
+awaitable<cpool::error_code>
+redis_subscriber::drop_connection(connection* conn) {
+    // a partial message of the lost connection can not be completed
+    read_buffer_.clear();
+    restored_channels_.clear();
+    restored_patterns_.clear();
+    resubscribing_ = config_.subscriber_resubscribe;
+    fail_waiters(std::error_code(client_error_code::disconnected));
+
+    // the server forgot the subscriptions along with the connection
+    co_await conn->async_disconnect();
+    cpool::error_code ec;
+    auto tok = asio::redirect_error(asio::use_awaitable, ec);
+    co_await message_queue_.async_send(
+        ec, reply(client_error_code::disconnected), tok);
+
+    co_return ec;
+}
+
 awaitable<reply> redis_subscriber::read() {
     cpool::error_code ec;
     auto tok = asio::redirect_error(asio::use_awaitable, ec);
@@ -172,27 +692,117 @@ awaitable<reply> redis_subscriber::read() {
     co_return reply;
 }
 
+awaitable<message_batch>
+redis_subscriber::read_batch(size_t max_messages,
+                             std::chrono::milliseconds max_wait) {
+    message_batch batch;
+    while (batch.messages.size() < max_messages) {
+        std::optional<redis::reply> next;
+        message_queue_.try_receive(
+            [&next](cpool::error_code ec, redis::reply reply) {
+                next = ec ? redis::reply(ec) : std::move(reply);
+            });
+
+        if (!next) {
+            if (!batch.messages.empty()) {
+                break;
+            }
+
+            // the timer cancels the receive instead of racing it, so a
+            // message that arrives as the timer expires is still returned
+            auto expiry = std::make_shared<batch_expiry>();
+            asio::steady_timer timer(co_await asio::this_coro::executor,
+                                     max_wait);
+            timer.async_wait([expiry](cpool::error_code ec) {
+                if (!ec) {
+                    expiry->expired = true;
+                    expiry->signal.emit(asio::cancellation_type::terminal);
+                }
+            });
+            auto [ec, reply] = co_await message_queue_.async_receive(
+                asio::bind_cancellation_slot(
+                    expiry->signal.slot(), as_tuple(asio::use_awaitable)));
+            timer.cancel();
+            if (ec && expiry->expired) {
+                // nothing arrived in time
+                break;
+            }
+
+            next = ec ? redis::reply(ec) : std::move(reply);
+        }
+
+        auto message = next->value().as<redis_message>();
+        if (!message) {
+            batch.control = std::move(next);
+            break;
+        }
+        batch.messages.push_back(std::move(*message));
+    }
+
+    co_return batch;
+}
+
 void redis_subscriber::set_logging_handler(logging_handler handler) {
     on_log_ = std::move(handler);
 }
 
+void redis_subscriber::set_channel_handler(string channel,
+                                           message_handler handler) {
+    if (handler) {
+        channel_handlers_[std::move(channel)] =
+            std::make_shared<const message_handler>(std::move(handler));
+    } else {
+        channel_handlers_.erase(channel);
+    }
+}
+
+void redis_subscriber::set_pattern_handler(string pattern,
+                                           message_handler handler) {
+    if (handler) {
+        pattern_handlers_[std::move(pattern)] =
+            std::make_shared<const message_handler>(std::move(handler));
+    } else {
+        pattern_handlers_.erase(pattern);
+    }
+}
+
+void redis_subscriber::set_handler_executor(net::any_io_executor exec,
+                                            size_t max_in_flight) {
+    handler_strands_.clear();
+    for (size_t i = 0; i < handler_strand_count; i++) {
+        handler_strands_.push_back(asio::make_strand(exec));
+    }
+
+    max_in_flight_ = std::max<size_t>(max_in_flight, 1);
+    in_flight_ = std::make_unique<concurrent_channel<void(cpool::error_code)>>(
+        exec, max_in_flight_);
+}
+
+void redis_subscriber::set_reconnect_handler(reconnect_handler handler) {
+    on_reconnect_ = std::move(handler);
+}
+
 bool redis_subscriber::running() const {
     return (latch_.value() != 0 && read_messages_);
 }
 
-std::unique_ptr<cpool::tcp_connection> redis_subscriber::connection_ctor() {
+tls_metrics redis_subscriber::handshake_metrics() const {
+    return tls_context_ ? tls_context_->metrics() : tls_metrics();
+}
+
+subscriber_metrics redis_subscriber::queue_metrics() const {
+    return subscriber_metrics{dropped_oldest_, dropped_newest_,
+                              overflow_disconnects_};
+}
 
-    auto conn = std::make_unique<cpool::tcp_connection>(exec_, config_.host,
-                                                        config_.port);
-    if (!config_.password.empty()) {
-        if (config_.username.empty()) {
-            config_.username = "default";
-        }
+std::unique_ptr<connection> redis_subscriber::connection_ctor() {
 
-        // login when a connection is created
-        conn->set_state_change_handler(std::bind(&redis_subscriber::auth_client,
-                                                 this, std::placeholders::_1,
-                                                 std::placeholders::_2));
+    auto conn = make_connection(exec_, config_, tls_context_);
+    if (!handshake_commands(config_).empty()) {
+        // authenticate and configure when a connection is created
+        conn->set_state_change_handler(
+            std::bind(&redis_subscriber::init_connection, this,
+                      std::placeholders::_1, std::placeholders::_2));
     }
 
     return conn;
@@ -200,31 +810,31 @@ std::unique_ptr<cpool::tcp_connection> redis_subscriber::connection_ctor() {
 
 [[nodiscard]] awaitable<cpool::error>
 redis_subscriber::on_connection_state_change(
-    cpool::tcp_connection* conn, const cpool::client_connection_state state) {
+    connection* conn, const cpool::client_connection_state state) {
     switch (state) {
     case cpool::client_connection_state::disconnected:
-        log_message(log_level::info, fmt::format("disconnected from {0}:{1}",
-                                                 conn->host(), conn->port()));
+        log_message(log_level::info, fmt::format("disconnected from {0}",
+                                                 conn->endpoint()));
         break;
 
     case cpool::client_connection_state::resolving:
         log_message(log_level::info,
-                    fmt::format("resolving {0}", conn->host()));
+                    fmt::format("resolving {0}", conn->endpoint()));
         break;
 
     case cpool::client_connection_state::connecting:
-        log_message(log_level::info, fmt::format("connecting to {0}:{1}",
-                                                 conn->host(), conn->port()));
+        log_message(log_level::info, fmt::format("connecting to {0}",
+                                                 conn->endpoint()));
         break;
 
     case cpool::client_connection_state::connected:
-        log_message(log_level::info, fmt::format("connected to {0}:{1}",
-                                                 conn->host(), conn->port()));
+        log_message(log_level::info, fmt::format("connected to {0}",
+                                                 conn->endpoint()));
         break;
 
     case cpool::client_connection_state::disconnecting:
-        log_message(log_level::info, fmt::format("disconnecting from {0}:{1}",
-                                                 conn->host(), conn->port()));
+        log_message(log_level::info, fmt::format("disconnecting from {0}",
+                                                 conn->endpoint()));
         break;
 
     default:
@@ -236,39 +846,86 @@ redis_subscriber::on_connection_state_change(
     co_return cpool::error();
 }
 
+awaitable<replies> redis_subscriber::read_replies(connection* conn,
+                                                  size_t count) {
+    redis::replies replies;
+    buffer_t read_buffer;
+    size_t parsed = 0;
+    std::error_code error;
+    while (replies.size() < count && !error) {
+        auto used = read_buffer.size();
+        read_buffer.resize(used + read_chunk_size);
+        auto [read_error, bytes_read] = co_await conn->async_read_some(
+            asio::buffer(read_buffer.data() + used, read_chunk_size));
+        read_buffer.resize(used + bytes_read);
+        if (read_error || bytes_read == 0) {
+            log_message(log_level::error,
+                        fmt::format("could not read the init replies: {}",
+                                    read_error ? read_error.message()
+                                               : "connection closed"));
+            error = client_error_code::read_error;
+            break;
+        }
+
+        auto it = read_buffer.cbegin() + parsed;
+        auto end = read_buffer.cend();
+        while (it != end && replies.size() < count) {
+            redis::reply reply;
+            auto next = reply.load_data(it, end);
+            if (reply.error() == parse_error_code::eof) {
+                // the rest of the reply comes with the next read
+                break;
+            }
+            if (reply.error() == parse_error_code::malformed_message) {
+                log_message(log_level::error,
+                            "init commands and replies do not match");
+                error = client_error_code::response_command_mismatch;
+                break;
+            }
+
+            it = next;
+            replies.push_back(reply);
+        }
+        parsed = it - read_buffer.cbegin();
+    }
+
+    replies.resize(count, redis::reply(error));
+    co_return replies;
+}
+
 awaitable<cpool::error>
-redis_subscriber::auth_client(cpool::tcp_connection* conn,
-                              const cpool::client_connection_state state) {
+redis_subscriber::init_connection(connection* conn,
+                                  const cpool::client_connection_state state) {
 
     if (state == cpool::client_connection_state::connected) {
-        auto username = config_.username;
-        auto password = config_.password;
-        auto loginCmd =
-            command(std::vector<std::string>{"AUTH", username, password});
-
-        // send auth
-        this->log_message(redis::log_level::trace, "AUTH password");
-        auto err = co_await this->send(loginCmd);
-        if (err) {
-            this->log_message(redis::log_level::error, err.message());
-            co_return err;
-        }
-
-        // read response
-        buffer_t read_buffer(4096);
-        auto [read_error, bytes_read] =
-            co_await conn->async_read_some(asio::buffer(read_buffer));
-        if (read_error) {
-            log_message(redis::log_level::error, read_error.message());
-            co_return read_error;
-        }
-        redis::reply authReply;
-        authReply.load_data(read_buffer.cbegin(), read_buffer.cend());
-        if (authReply.error()) {
-            log_message(redis::log_level::error,
-                        authReply.value().as<std::string>().value_or(
-                            authReply.error().message()));
-            co_return authReply.error();
+        auto handshake = handshake_commands(config_);
+        std::string buffer;
+        for (auto& command : handshake) {
+            buffer += command.serialized_command();
+        }
+
+        // send all of the init commands in one write
+        this->log_message(redis::log_level::trace,
+                          fmt::format("sending {} init commands in one batch",
+                                      handshake.size()));
+        auto [write_error, bytes_written] =
+            co_await conn->async_write(asio::buffer(buffer));
+        if (write_error) {
+            this->log_message(redis::log_level::error, write_error.message());
+            co_return write_error;
+        }
+
+        // the replies may span several reads, e.g. the map of HELLO
+        auto replies = co_await read_replies(conn, handshake.size());
+        for (size_t i = 0; i < handshake.size(); i++) {
+            if (replies[i].error()) {
+                auto message = replies[i].value().as<std::string>().value_or(
+                    replies[i].error().message());
+                log_message(redis::log_level::error,
+                            fmt::format("{} failed: {}", handshake[i].name(),
+                                        message));
+                co_return replies[i].error();
+            }
         }
     }
 
@@ -1,20 +1,37 @@
 #pragma once
 
+#include <chrono>
+#include <concepts>
+#include <deque>
+#include <functional>
+#include <optional>
 #include <queue>
+#include <ranges>
+#include <set>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include <boost/asio/bind_cancellation_slot.hpp>
+#include <boost/asio/cancellation_signal.hpp>
 #include <boost/asio/experimental/channel.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
+#include <boost/asio/strand.hpp>
 #include <cpool/awaitable_latch.hpp>
 #include <cpool/connection_pool.hpp>
-#include <cpool/tcp_connection.hpp>
 
 #include "redis/client_config.hpp"
 #include "redis/command.hpp"
+#include "redis/connection.hpp"
 #include "redis/errors.hpp"
+#include "redis/handshake.hpp"
 #include "redis/helper_functions.hpp"
 #include "redis/message.hpp"
 #include "redis/reply.hpp"
 #include "redis/subscriber_connection.hpp"
+#include "redis/tls_connection.hpp"
 #include "redis/types.hpp"
 #include "redis/value.hpp"
 
@@ -23,6 +40,47 @@ namespace redis {
 using namespace cpool;
 using namespace boost::asio::experimental;
 
+/**
+ * @brief The counters of the queue of a redis_subscriber.
+ */
+struct subscriber_metrics {
+    /// dropped_oldest Messages discarded by overflow_policy::drop_oldest.
+    uint64_t dropped_oldest = 0;
+
+    /// dropped_newest Messages discarded by overflow_policy::drop_newest.
+    uint64_t dropped_newest = 0;
+
+    /// overflow_disconnects Connections closed by overflow_policy::disconnect.
+    uint64_t overflow_disconnects = 0;
+};
+
+/**
+ * @brief The messages returned by redis_subscriber::read_batch().
+ */
+struct message_batch {
+    /// messages The published messages, in the order they arrived.
+    std::vector<redis_message> messages;
+
+    /// control A reply that is not a published message, e.g. the
+    /// confirmation of a subscription or client_error_code::disconnected. It
+    /// arrived after messages and ends the batch.
+    std::optional<reply> control;
+};
+
+/// Called with a published message. The views are only valid during the
+/// call.
+using message_handler = std::function<void(const message_view& message)>;
+
+/// A range of channels or patterns.
+template <typename Range>
+concept string_range =
+    std::ranges::input_range<Range> &&
+    std::convertible_to<std::ranges::range_reference_t<Range>, string>;
+
+/// Called when a subscriber has reconnected and restored its subscriptions.
+/// The messages published while it was disconnected were lost.
+using reconnect_handler = std::function<void()>;
+
 /**
  * @brief This class is used to coordinate communication with a Redis
  * Server.
@@ -34,7 +92,7 @@ class redis_subscriber {
      * @brief Creates a redis_subscriber using default properties.
      * @param connection The connection on which the subscribe request was made.
      */
-    redis_subscriber(std::unique_ptr<cpool::tcp_connection> connection);
+    redis_subscriber(std::unique_ptr<connection> connection);
 
     /**
      * @brief Creates a subscriber using default properties.
@@ -87,6 +145,88 @@ class redis_subscriber {
      */
     [[nodiscard]] awaitable<cpool::error> punsubscribe(string pattern);
 
+    /**
+     * @brief Subscribes to many channels with a few SUBSCRIBE commands of up
+     * to 1000 channels each, sent in one write. The confirmations are not
+     * returned by read(). Requires start().
+     * @param channels The channels to subscribe to.
+     * @returns The error of the write, or client_error_code::disconnected if
+     * the connection was lost before every channel was confirmed.
+     */
+    template <string_range Channels>
+    [[nodiscard]] awaitable<cpool::error> subscribe(const Channels& channels) {
+        return send_subscriptions("subscribe", to_strings(channels));
+    }
+
+    /**
+     * @brief Unsubscribes from many channels. @see subscribe(const Channels&)
+     */
+    template <string_range Channels>
+    [[nodiscard]] awaitable<cpool::error>
+    unsubscribe(const Channels& channels) {
+        return send_subscriptions("unsubscribe", to_strings(channels));
+    }
+
+    /**
+     * @brief Subscribes to many patterns. @see subscribe(const Channels&)
+     */
+    template <string_range Patterns>
+    [[nodiscard]] awaitable<cpool::error>
+    psubscribe(const Patterns& patterns) {
+        return send_subscriptions("psubscribe", to_strings(patterns));
+    }
+
+    /**
+     * @brief Unsubscribes from many patterns. @see subscribe(const Channels&)
+     */
+    template <string_range Patterns>
+    [[nodiscard]] awaitable<cpool::error>
+    punsubscribe(const Patterns& patterns) {
+        return send_subscriptions("punsubscribe", to_strings(patterns));
+    }
+
+    /**
+     * @brief Subscribes to the channels, e.g. subscribe("a", "b", "c").
+     * @see subscribe(const Channels&)
+     */
+    template <std::convertible_to<string>... Channels>
+        requires(sizeof...(Channels) > 1)
+    [[nodiscard]] awaitable<cpool::error> subscribe(Channels&&... channels) {
+        return send_subscriptions(
+            "subscribe", {string(std::forward<Channels>(channels))...});
+    }
+
+    /**
+     * @brief Unsubscribes from the channels. @see subscribe(const Channels&)
+     */
+    template <std::convertible_to<string>... Channels>
+        requires(sizeof...(Channels) > 1)
+    [[nodiscard]] awaitable<cpool::error> unsubscribe(Channels&&... channels) {
+        return send_subscriptions(
+            "unsubscribe", {string(std::forward<Channels>(channels))...});
+    }
+
+    /**
+     * @brief Subscribes to the patterns. @see subscribe(const Channels&)
+     */
+    template <std::convertible_to<string>... Patterns>
+        requires(sizeof...(Patterns) > 1)
+    [[nodiscard]] awaitable<cpool::error> psubscribe(Patterns&&... patterns) {
+        return send_subscriptions(
+            "psubscribe", {string(std::forward<Patterns>(patterns))...});
+    }
+
+    /**
+     * @brief Unsubscribes from the patterns. @see subscribe(const Channels&)
+     */
+    template <std::convertible_to<string>... Patterns>
+        requires(sizeof...(Patterns) > 1)
+    [[nodiscard]] awaitable<cpool::error>
+    punsubscribe(Patterns&&... patterns) {
+        return send_subscriptions(
+            "punsubscribe", {string(std::forward<Patterns>(patterns))...});
+    }
+
     /**
      * @brief Starts reading subscribed messages
      *
@@ -106,28 +246,155 @@ class redis_subscriber {
     [[nodiscard]] awaitable<cpool::error> reset();
 
     /**
-     * @brief Reads messages published from the channel
-     *
+     * @brief Reads messages published from the channel. A reply with the
+     * error client_error_code::disconnected is returned when the connection
+     * was lost. The subscriber reconnects and, unless
+     * client_config::subscriber_resubscribe is false, restores its
+     * subscriptions without queueing their confirmations.
      */
     [[nodiscard]] awaitable<reply> read();
 
+    /**
+     * @brief Reads the messages that are already queued, decoded, in one
+     * wakeup. Waits for the first one if the queue is empty.
+     * @param max_messages The largest number of messages to return.
+     * @param max_wait How long to wait for the first message. An empty batch
+     * is returned if none arrives in time.
+     */
+    [[nodiscard]] awaitable<message_batch>
+    read_batch(size_t max_messages, std::chrono::milliseconds max_wait);
+
+    /**
+     * @brief Sends a command without waiting for its reply. The reply is
+     * returned by read(), e.g. for CLIENT ID sent before subscribing.
+     * @param command The command to send to the server.
+     */
+    [[nodiscard]] awaitable<cpool::error> send(command command);
+
     /**
      * @brief Sets the callback to be executed when an error message is
      * generated.
      */
     void set_logging_handler(logging_handler handler);
 
+    /**
+     * @brief Sets the callback that receives the messages of a channel
+     * instead of read(). The channel is looked up in the bytes read from the
+     * connection, so the messages are not copied or decoded into replies.
+     * Messages of channels without a handler are queued for read(). Handlers
+     * must be set before start() or from the executor of the subscriber, and
+     * not from a handler.
+     * @param channel The channel subscribed to with subscribe().
+     * @param handler The callback. nullptr removes the handler.
+     */
+    void set_channel_handler(string channel, message_handler handler);
+
+    /**
+     * @brief Sets the callback that receives the messages matched by a
+     * pattern instead of read(). @see set_channel_handler
+     * @param pattern The pattern subscribed to with psubscribe().
+     * @param handler The callback. nullptr removes the handler.
+     */
+    void set_pattern_handler(string pattern, message_handler handler);
+
+    /**
+     * @brief Runs the handlers on another executor, e.g. a thread pool,
+     * instead of in the read loop, so a slow handler does not hold up the
+     * messages of other channels. The messages of a channel are still handled
+     * one at a time and in order, while different channels are handled
+     * concurrently. Each message is copied before it is handed over. Must be
+     * called before start().
+     * @param exec The executor to run the handlers on.
+     * @param max_in_flight The number of messages that may be waiting for or
+     * running in a handler. Reading stops while it is reached.
+     */
+    void set_handler_executor(net::any_io_executor exec,
+                              size_t max_in_flight = 1024);
+
+    /**
+     * @brief Sets the callback to be executed when the subscriber has
+     * reconnected and restored its subscriptions, e.g. to read what was
+     * published meanwhile from somewhere else. Called from the read loop.
+     */
+    void set_reconnect_handler(reconnect_handler handler);
+
     /**
      * @brief Returns whether or not the client is running.
      */
     bool running() const;
 
+    /**
+     * @brief Returns the cost of the TLS handshakes made by the connection.
+     * Empty if TLS is not used.
+     */
+    tls_metrics handshake_metrics() const;
+
+    /**
+     * @brief Returns the number of replies discarded because the queue was
+     * full.
+     */
+    subscriber_metrics queue_metrics() const;
+
   private:
+    /// A call of send_subscriptions() waiting for its confirmations
+    struct confirmation_waiter {
+        explicit confirmation_waiter(net::any_io_executor exec)
+            : kind()
+            , remaining()
+            , error()
+            , done(exec) {}
+
+        /// The kind of the confirmations, e.g. "subscribe".
+        string kind;
+
+        /// The channels or patterns that have not been confirmed yet.
+        std::unordered_multiset<string> remaining;
+
+        /// Set if the connection was lost before all were confirmed.
+        cpool::error error;
+
+        /// Expires when remaining is empty or error is set.
+        asio::steady_timer done;
+    };
+
     /**
-     * @brief Used to send the command to the server.
-     * @param command The command to send to the server.
+     * @brief Copies channels or patterns into strings.
      */
-    [[nodiscard]] awaitable<cpool::error> send(command command);
+    template <string_range Range>
+    static std::vector<string> to_strings(const Range& range) {
+        std::vector<string> strings;
+        for (auto&& value : range) {
+            strings.emplace_back(value);
+        }
+        return strings;
+    }
+
+    /**
+     * @brief Sends a subscription command for many channels or patterns, in
+     * chunks of one write each, and waits for every confirmation. Repeated
+     * channels or patterns are sent once.
+     * @param kind The lowercase name of the command, e.g. "subscribe".
+     * @param arguments The channels or patterns.
+     */
+    [[nodiscard]] awaitable<cpool::error>
+    send_subscriptions(string kind, std::vector<string> arguments);
+
+    /**
+     * @brief Writes serialized commands in one write.
+     */
+    [[nodiscard]] awaitable<cpool::error> send_buffer(std::string buffer);
+
+    /**
+     * @brief Counts a confirmation towards the oldest call of
+     * send_subscriptions() that waits for it.
+     * @returns False if no call waits for the confirmation.
+     */
+    bool confirm(const reply& reply);
+
+    /**
+     * @brief Wakes every call of send_subscriptions() with an error.
+     */
+    void fail_waiters(cpool::error error);
 
     /**
      * @brief reads messages from the server.
@@ -135,26 +402,94 @@ class redis_subscriber {
     [[nodiscard]] awaitable<void> read_messages();
 
     /**
-     * @brief parses the messages in the read buffer
-     *
+     * @brief Queues the complete messages in read_buffer_ and keeps the bytes
+     * of a message that has not fully arrived for the next read. The
+     * connection is dropped if the stream can not be parsed.
+     * @param conn The connection the bytes were read from.
+     * @returns The error of the queue if it was closed.
+     */
+    [[nodiscard]] awaitable<cpool::error_code> parse_buffer(connection* conn);
+
+    /**
+     * @brief Returns the handler of the channel or pattern of a message, or
+     * nullptr if there is none.
+     */
+    std::shared_ptr<const message_handler>
+    handler_for(const message_view& message) const;
+
+    /**
+     * @brief Calls a handler, logging the exceptions it throws.
+     */
+    void run_handler(const message_handler& handler,
+                     const message_view& message);
+
+    /**
+     * @brief Runs a handler on the strand of the channel of the message once
+     * fewer than max_in_flight_ messages are being handled.
+     * @returns The error of the wait if the subscriber was stopped.
+     */
+    [[nodiscard]] awaitable<cpool::error_code>
+    post_handler(std::shared_ptr<const message_handler> handler,
+                 const message_view& message);
+
+    /**
+     * @brief Queues a published message without waiting, applying the
+     * overflow policy if the queue is full. overflow_policy::drop_oldest only
+     * drops published messages, never the replies to commands.
+     * @returns False if the message did not fit and the policy is
+     * overflow_policy::disconnect.
+     */
+    bool offer(const reply& message);
+
+    /**
+     * @brief Sends the subscriptions of the subscriber on a new connection,
+     * a few channels or patterns per command and all commands in one write.
+     * @returns The error of the queue if it was closed.
+     */
+    [[nodiscard]] awaitable<cpool::error_code> resubscribe(connection* conn);
+
+    /**
+     * @brief Consumes the confirmation of a subscription sent by
+     * resubscribe(). Confirmations of other subscriptions are left alone.
+     * @returns True if the reply was consumed.
+     */
+    bool confirm_restored(const reply& reply);
+
+    /**
+     * @brief Drops a connection that can not be read anymore and queues a
+     * client_error_code::disconnected reply.
+     * @returns The error of the queue if it was closed.
      */
     [[nodiscard]] awaitable<cpool::error_code>
-    parse_buffer(buffer_t::const_iterator begin, buffer_t::const_iterator end);
+    drop_connection(connection* conn);
 
     /**
      * @brief Creates the connection object
      *
-     * @return std::unique_ptr<cpool::tcp_connection>
+     * @return std::unique_ptr<redis::connection>
      */
-    std::unique_ptr<cpool::tcp_connection> connection_ctor();
+    std::unique_ptr<connection> connection_ctor();
 
     [[nodiscard]] awaitable<cpool::error>
-    on_connection_state_change(cpool::tcp_connection* conn,
+    on_connection_state_change(connection* conn,
                                const cpool::client_connection_state state);
 
+    /**
+     * @brief Reads the replies of a pipeline, across as many reads as they
+     * take.
+     * @returns count replies. The ones that could not be read hold the
+     * error.
+     */
+    [[nodiscard]] awaitable<replies> read_replies(connection* conn,
+                                                  size_t count);
+
+    /**
+     * @brief Sends the handshake commands as one pipeline when the connection
+     * is established. @see handshake_commands
+     */
     [[nodiscard]] awaitable<cpool::error>
-    auth_client(cpool::tcp_connection* conn,
-                const cpool::client_connection_state state);
+    init_connection(connection* conn,
+                    const cpool::client_connection_state state);
 
     /**
      * @brief Logs the message using the on_log_ event hander.
@@ -170,12 +505,73 @@ class redis_subscriber {
     /// The configuration options of the client.
     client_config config_;
 
-    /// The connection to the server. @see cpool::tcp_connection.
+    /// The TLS state kept across reconnects so they resume the session.
+    /// nullptr if TLS is not used.
+    std::shared_ptr<tls_context> tls_context_;
+
+    /// The connection to the server. @see redis::connection.
     redis_subscriber_connection connection_;
 
     /// The queue to read messages from
     channel<void(cpool::error_code, reply)> message_queue_;
 
+    /// The replies discarded because the queue was full.
+    std::atomic<uint64_t> dropped_oldest_;
+    std::atomic<uint64_t> dropped_newest_;
+    std::atomic<uint64_t> overflow_disconnects_;
+
+    /// Hashes std::string and std::string_view alike, so handlers can be
+    /// found without copying the channel out of read_buffer_.
+    struct string_hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    using handler_map =
+        std::unordered_map<std::string, std::shared_ptr<const message_handler>,
+                           string_hash, std::equal_to<>>;
+
+    /// The handlers of messages by channel and by pattern. Shared with the
+    /// handlers that are in flight, so they can be replaced meanwhile.
+    handler_map channel_handlers_;
+    handler_map pattern_handlers_;
+
+    /// The strands the handlers run on, picked by the hash of the channel.
+    /// Empty if the handlers run in the read loop.
+    std::vector<asio::strand<net::any_io_executor>> handler_strands_;
+
+    /// Holds one element per message handed to handler_strands_ that has not
+    /// been handled yet, so sending blocks at max_in_flight_.
+    std::unique_ptr<concurrent_channel<void(cpool::error_code)>> in_flight_;
+    size_t max_in_flight_;
+
+    /// The channels and patterns subscribed to, restored on reconnect.
+    std::set<string> channels_;
+    std::set<string> patterns_;
+
+    /// Whether the subscriptions must be sent again before reading.
+    bool resubscribing_;
+
+    /// The channels and patterns sent by resubscribe() that have not been
+    /// confirmed yet. Their confirmations are dropped instead of queued.
+    std::unordered_multiset<string> restored_channels_;
+    std::unordered_multiset<string> restored_patterns_;
+
+    /// Called when the subscriptions were restored. Does nothing if set to
+    /// nullptr.
+    reconnect_handler on_reconnect_;
+
+    /// The calls of send_subscriptions() waiting for confirmations, oldest
+    /// first.
+    std::deque<std::shared_ptr<confirmation_waiter>> waiters_;
+
+    /// The bytes read from the connection that have not been parsed yet,
+    /// starting with a message that has not fully arrived. Only used by
+    /// read_messages().
+    buffer_t read_buffer_;
+
     // event handlers
     /// Called when there is a call to logMessage. Does nothing if set to
     /// nullptr.
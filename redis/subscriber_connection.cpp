@@ -2,10 +2,12 @@
 
 #include <cpool/back_off.hpp>
 
+#include "redis/tcp_connection.hpp"
+
 namespace redis {
 
 redis_subscriber_connection::redis_subscriber_connection(
-    std::unique_ptr<cpool::tcp_connection> connection)
+    std::unique_ptr<redis::connection> connection)
     : connection_(std::move(connection))
     , on_log_()
     , connecting_(false) {}
@@ -20,7 +22,7 @@ net::any_io_executor redis_subscriber_connection::get_executor() const {
     return connection_->get_executor();
 }
 
-awaitable<tcp_connection*> redis_subscriber_connection::get() {
+awaitable<redis::connection*> redis_subscriber_connection::get() {
     // log_message(redis::log_level::trace, "Getting connection");
     if (connection_->connected()) {
         co_return connection_.get();
@@ -31,9 +33,7 @@ awaitable<tcp_connection*> redis_subscriber_connection::get() {
 }
 
 cpool::error redis_subscriber_connection::cancel() {
-    cpool::error_code err;
-    connection_->socket().cancel(err);
-    return cpool::error(err);
+    return connection_->cancel();
 }
 
 bool redis_subscriber_connection::connected() const {
@@ -80,8 +80,8 @@ redis_subscriber_connection::async_connect() {
         co_await timer.async_wait(delay);
 
         log_message(redis::log_level::info,
-                    fmt::format("attempting connection to: {0}:{1}",
-                                connection_->host(), connection_->port()));
+                    fmt::format("attempting connection to: {0}",
+                                connection_->endpoint()));
         auto error = co_await connection_->async_connect();
         if (error.value() == (int)net::error::operation_aborted) {
             connecting_ = false;
@@ -95,8 +95,7 @@ redis_subscriber_connection::async_connect() {
     }
 
     log_message(redis::log_level::info,
-                fmt::format("connected to: {0}:{1}", connection_->host(),
-                            connection_->port()));
+                fmt::format("connected to: {0}", connection_->endpoint()));
     connecting_ = false;
     co_return cpool::error();
 }
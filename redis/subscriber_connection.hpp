@@ -5,9 +5,9 @@
 #include <string>
 
 #include <cpool/condition_variable.hpp>
-#include <cpool/tcp_connection.hpp>
 #include <cpool/timer.hpp>
 
+#include "redis/connection.hpp"
 #include "redis/types.hpp"
 
 namespace redis {
@@ -16,14 +16,14 @@ using namespace cpool;
 
 class redis_subscriber_connection {
   public:
-    redis_subscriber_connection(std::unique_ptr<tcp_connection> connection);
+    redis_subscriber_connection(std::unique_ptr<redis::connection> connection);
 
     redis_subscriber_connection(net::any_io_executor exec, string host,
                                 uint16_t port);
 
     net::any_io_executor get_executor() const;
 
-    [[nodiscard]] awaitable<tcp_connection*> get();
+    [[nodiscard]] awaitable<redis::connection*> get();
 
     /**
      * @brief Cancels all pending requests
@@ -60,8 +60,8 @@ class redis_subscriber_connection {
     void log_message(log_level level, string_view message);
 
   private:
-    /// The connection to the server. @see cpool::tcp_connection.
-    std::unique_ptr<cpool::tcp_connection> connection_;
+    /// The connection to the server. @see redis::connection.
+    std::unique_ptr<redis::connection> connection_;
 
     /// Called when there is a call to logMessage. Does nothing if set to
     /// nullptr.
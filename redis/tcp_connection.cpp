@@ -0,0 +1,54 @@
+#include "redis/tcp_connection.hpp"
+
+#include <fmt/format.h>
+
+namespace redis {
+
+tcp_connection::tcp_connection(net::any_io_executor exec, std::string host,
+                               uint16_t port)
+    : connection(exec)
+    , connection_(std::make_unique<cpool::tcp_connection>(exec, host, port)) {
+
+    // forward state changes so handlers see this connection
+    connection_->set_state_change_handler(
+        [this](cpool::tcp_connection*,
+               const cpool::client_connection_state state) {
+            return set_state(state);
+        });
+}
+
+std::string tcp_connection::endpoint() const {
+    return fmt::format("{0}:{1}", connection_->host(), connection_->port());
+}
+
+bool tcp_connection::connected() const { return connection_->connected(); }
+
+awaitable<cpool::error> tcp_connection::async_connect() {
+    return connection_->async_connect();
+}
+
+awaitable<cpool::error> tcp_connection::async_disconnect() {
+    return connection_->async_disconnect();
+}
+
+awaitable<std::tuple<cpool::error, std::size_t>>
+tcp_connection::async_write(net::const_buffer buffer) {
+    auto [error, bytes_written] = co_await connection_->async_write(buffer);
+    co_return std::make_tuple(cpool::error(error), bytes_written);
+}
+
+awaitable<std::tuple<cpool::error, std::size_t>>
+tcp_connection::async_read_some(net::mutable_buffer buffer) {
+    auto [error, bytes_read] = co_await connection_->async_read_some(buffer);
+    co_return std::make_tuple(cpool::error(error), bytes_read);
+}
+
+cpool::error tcp_connection::cancel() {
+    cpool::error_code err;
+    connection_->socket().cancel(err);
+    return cpool::error(err);
+}
+
+void tcp_connection::expires_never() { connection_->expires_never(); }
+
+} // namespace redis
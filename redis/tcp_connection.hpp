@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <cpool/tcp_connection.hpp>
+
+#include "redis/connection.hpp"
+
+namespace redis {
+
+/**
+ * @brief A connection to a Redis server over TCP. @see cpool::tcp_connection
+ */
+class tcp_connection : public connection {
+
+  public:
+    /**
+     * @brief Creates a TCP connection.
+     * @param exec The Asio executor to use for event handling.
+     * @param host The IP Address or hostname of the server.
+     * @param port The remote port on which the server is listening.
+     */
+    tcp_connection(net::any_io_executor exec, std::string host,
+                   uint16_t port);
+
+    std::string endpoint() const override;
+
+    bool connected() const override;
+
+    [[nodiscard]] awaitable<cpool::error> async_connect() override;
+
+    [[nodiscard]] awaitable<cpool::error> async_disconnect() override;
+
+    [[nodiscard]] awaitable<std::tuple<cpool::error, std::size_t>>
+    async_write(net::const_buffer buffer) override;
+
+    [[nodiscard]] awaitable<std::tuple<cpool::error, std::size_t>>
+    async_read_some(net::mutable_buffer buffer) override;
+
+    cpool::error cancel() override;
+
+    void expires_never() override;
+
+  private:
+    /// The underlying TCP connection.
+    std::unique_ptr<cpool::tcp_connection> connection_;
+};
+
+} // namespace redis
@@ -0,0 +1,299 @@
+#include "redis/tls_connection.hpp"
+
+namespace redis {
+
+using cpool::client_connection_state;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+namespace {
+
+/// The SSL_CTX slot that points back to the tls_context. The app data slot is
+/// taken by asio.
+int context_index() {
+    static const int index =
+        SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+} // namespace
+
+tls_context::tls_context(const client_config& config)
+    : context_(net::ssl::context::tls_client)
+    , server_name_(config.tls_server_name.empty() ? config.host
+                                                   : config.tls_server_name)
+    , verify_peer_(config.tls_verify_peer)
+    , session_(nullptr)
+    , session_mutex_()
+    , handshakes_(0)
+    , resumed_handshakes_(0)
+    , failed_handshakes_(0)
+    , handshake_time_(0)
+    , last_handshake_time_(0) {
+
+    context_.set_options(net::ssl::context::default_workarounds |
+                         net::ssl::context::no_sslv2 |
+                         net::ssl::context::no_sslv3 |
+                         net::ssl::context::no_tlsv1 |
+                         net::ssl::context::no_tlsv1_1);
+
+    if (config.tls_ca_file.empty()) {
+        context_.set_default_verify_paths();
+    } else {
+        context_.load_verify_file(config.tls_ca_file);
+    }
+
+    if (!config.tls_cert_file.empty()) {
+        context_.use_certificate_chain_file(config.tls_cert_file);
+        context_.use_private_key_file(config.tls_key_file,
+                                      net::ssl::context::pem);
+    }
+
+    // keep the sessions ourselves so every connection resumes the latest one
+    auto* ctx = context_.native_handle();
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT |
+                                            SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_set_ex_data(ctx, context_index(), this);
+    SSL_CTX_sess_set_new_cb(ctx, &tls_context::on_new_session);
+}
+
+tls_context::~tls_context() {
+    if (session_ != nullptr) {
+        SSL_SESSION_free(session_);
+    }
+}
+
+net::ssl::context& tls_context::context() { return context_; }
+
+const std::string& tls_context::server_name() const { return server_name_; }
+
+cpool::error_code
+tls_context::prepare(net::ssl::stream<net::ip::tcp::socket>& stream) const {
+    cpool::error_code ec;
+    auto* ssl = stream.native_handle();
+
+    if (!SSL_set_tlsext_host_name(ssl, server_name_.c_str())) {
+        return cpool::error_code(static_cast<int>(ERR_get_error()),
+                                 net::error::get_ssl_category());
+    }
+
+    if (verify_peer_) {
+        stream.set_verify_mode(net::ssl::verify_peer, ec);
+        if (!ec) {
+            stream.set_verify_callback(
+                net::ssl::host_name_verification(server_name_), ec);
+        }
+    } else {
+        stream.set_verify_mode(net::ssl::verify_none, ec);
+    }
+    if (ec) {
+        return ec;
+    }
+
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    if (session_ != nullptr) {
+        // takes its own reference to the session
+        SSL_set_session(ssl, session_);
+    }
+
+    return ec;
+}
+
+void tls_context::record_handshake(
+    std::chrono::steady_clock::duration duration, bool resumed) {
+    auto us =
+        static_cast<uint64_t>(duration_cast<microseconds>(duration).count());
+    handshakes_++;
+    if (resumed) {
+        resumed_handshakes_++;
+    }
+    handshake_time_ += us;
+    last_handshake_time_ = us;
+}
+
+void tls_context::record_failure() { failed_handshakes_++; }
+
+tls_metrics tls_context::metrics() const {
+    tls_metrics metrics;
+    metrics.handshakes = handshakes_;
+    metrics.resumed_handshakes = resumed_handshakes_;
+    metrics.failed_handshakes = failed_handshakes_;
+    metrics.handshake_time = microseconds(handshake_time_);
+    metrics.last_handshake_time = microseconds(last_handshake_time_);
+    return metrics;
+}
+
+int tls_context::on_new_session(SSL* ssl, SSL_SESSION* session) {
+    auto* self = static_cast<tls_context*>(
+        SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+    if (self == nullptr) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(self->session_mutex_);
+    if (self->session_ != nullptr) {
+        SSL_SESSION_free(self->session_);
+    }
+    self->session_ = session;
+
+    // returning 1 keeps the reference OpenSSL passed to us
+    return 1;
+}
+
+tls_connection::tls_connection(net::any_io_executor exec, std::string host,
+                               uint16_t port,
+                               std::shared_ptr<tls_context> context)
+    : connection(exec)
+    , host_(std::move(host))
+    , port_(port)
+    , context_(std::move(context))
+    , stream_(nullptr) {}
+
+std::string tls_connection::endpoint() const {
+    return host_ + ":" + std::to_string(port_);
+}
+
+awaitable<cpool::error> tls_connection::async_connect() {
+    if (connected()) {
+        co_return cpool::error();
+    }
+
+    auto ec = co_await open();
+    if (ec) {
+        close();
+        co_await set_state(client_connection_state::disconnected);
+        co_return ec;
+    }
+
+    auto error = co_await set_state(client_connection_state::connected);
+    if (error) {
+        co_await async_disconnect();
+        co_return error;
+    }
+
+    co_return cpool::error();
+}
+
+awaitable<cpool::error_code> tls_connection::open() {
+    auto exec = get_executor();
+    stream_ = std::make_unique<net::ssl::stream<net::ip::tcp::socket>>(
+        exec, context_->context());
+
+    co_await set_state(client_connection_state::resolving);
+
+    cpool::error_code ec;
+    net::ip::tcp::resolver resolver(exec);
+    auto endpoints = co_await resolver.async_resolve(
+        host_, std::to_string(port_),
+        net::redirect_error(net::use_awaitable, ec));
+    if (ec) {
+        co_return ec;
+    }
+
+    co_await set_state(client_connection_state::connecting);
+
+    co_await net::async_connect(stream_->lowest_layer(), endpoints,
+                                net::redirect_error(net::use_awaitable, ec));
+    if (ec) {
+        co_return ec;
+    }
+
+    stream_->lowest_layer().set_option(net::ip::tcp::no_delay(true), ec);
+
+    ec = context_->prepare(*stream_);
+    if (ec) {
+        co_return ec;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    co_await stream_->async_handshake(
+        net::ssl::stream_base::client,
+        net::redirect_error(net::use_awaitable, ec));
+    if (ec) {
+        context_->record_failure();
+        co_return ec;
+    }
+
+    context_->record_handshake(std::chrono::steady_clock::now() - start,
+                               SSL_session_reused(stream_->native_handle()));
+    co_return ec;
+}
+
+void tls_connection::close() {
+    if (!stream_) {
+        return;
+    }
+
+    // skip the close_notify exchange, Redis does not wait for it either
+    cpool::error_code ec;
+    stream_->lowest_layer().shutdown(net::socket_base::shutdown_both, ec);
+    stream_->lowest_layer().close(ec);
+}
+
+awaitable<cpool::error> tls_connection::async_disconnect() {
+    co_await set_state(client_connection_state::disconnecting);
+
+    // OpenSSL invalidates the session of a stream freed without a shutdown,
+    // mark it as clean so a later connection can still resume it
+    if (stream_) {
+        SSL_set_shutdown(stream_->native_handle(),
+                         SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+    }
+    close();
+    co_await set_state(client_connection_state::disconnected);
+    co_return cpool::error();
+}
+
+awaitable<std::tuple<cpool::error, std::size_t>>
+tls_connection::async_write(net::const_buffer buffer) {
+    if (!stream_ || !connected()) {
+        co_return std::make_tuple(cpool::error(net::error::not_connected),
+                                  std::size_t{0});
+    }
+
+    cpool::error_code ec;
+    auto bytes_written = co_await net::async_write(
+        *stream_, buffer, net::redirect_error(net::use_awaitable, ec));
+    if (ec) {
+        co_await on_error(ec);
+    }
+
+    co_return std::make_tuple(cpool::error(ec), bytes_written);
+}
+
+awaitable<std::tuple<cpool::error, std::size_t>>
+tls_connection::async_read_some(net::mutable_buffer buffer) {
+    if (!stream_ || !connected()) {
+        co_return std::make_tuple(cpool::error(net::error::not_connected),
+                                  std::size_t{0});
+    }
+
+    cpool::error_code ec;
+    auto bytes_read = co_await stream_->async_read_some(
+        buffer, net::redirect_error(net::use_awaitable, ec));
+    if (ec) {
+        co_await on_error(ec);
+    }
+
+    co_return std::make_tuple(cpool::error(ec), bytes_read);
+}
+
+cpool::error tls_connection::cancel() {
+    cpool::error_code err;
+    if (stream_) {
+        stream_->lowest_layer().cancel(err);
+    }
+    return cpool::error(err);
+}
+
+awaitable<void> tls_connection::on_error(const cpool::error_code& error) {
+    // a cancelled operation leaves the connection usable
+    if (error == net::error::operation_aborted || !connected()) {
+        co_return;
+    }
+
+    close();
+    co_await set_state(client_connection_state::disconnected);
+}
+
+} // namespace redis
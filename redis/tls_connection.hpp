@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+
+#include "redis/client_config.hpp"
+#include "redis/connection.hpp"
+
+namespace redis {
+
+/**
+ * @brief The cost of the TLS handshakes made with a tls_context.
+ */
+struct tls_metrics {
+    /// handshakes The number of completed handshakes.
+    uint64_t handshakes = 0;
+
+    /// resumed_handshakes The number of handshakes that resumed a session.
+    uint64_t resumed_handshakes = 0;
+
+    /// failed_handshakes The number of handshakes that failed.
+    uint64_t failed_handshakes = 0;
+
+    /// handshake_time The total time spent in completed handshakes.
+    std::chrono::microseconds handshake_time{0};
+
+    /// last_handshake_time The duration of the most recent handshake.
+    std::chrono::microseconds last_handshake_time{0};
+};
+
+/**
+ * @brief The TLS state shared by every connection of a client or subscriber:
+ * the SSL context, the session to resume and the handshake metrics. A full
+ * handshake costs an extra round trip and the key exchange, resuming the
+ * session of an earlier connection skips the latter.
+ */
+class tls_context {
+
+  public:
+    /**
+     * @brief Creates the SSL context from the TLS settings of the
+     * configuration. Throws boost::system::system_error if a certificate or
+     * key can not be loaded.
+     * @param config The configuration object.
+     */
+    tls_context(const client_config& config);
+
+    ~tls_context();
+
+    tls_context(const tls_context&) = delete;
+    tls_context& operator=(const tls_context&) = delete;
+
+    /**
+     * @brief Returns the SSL context used to create streams.
+     */
+    net::ssl::context& context();
+
+    /**
+     * @brief Returns the name used for SNI and certificate verification.
+     */
+    const std::string& server_name() const;
+
+    /**
+     * @brief Prepares a stream for the handshake: sets SNI, peer
+     * verification and the session to resume, if any.
+     * @returns An error if the stream could not be configured.
+     */
+    cpool::error_code
+    prepare(net::ssl::stream<net::ip::tcp::socket>& stream) const;
+
+    /**
+     * @brief Records a handshake in the metrics.
+     * @param duration The time the handshake took.
+     * @param resumed Whether the handshake resumed a session.
+     */
+    void record_handshake(std::chrono::steady_clock::duration duration,
+                          bool resumed);
+
+    /**
+     * @brief Records a failed handshake in the metrics.
+     */
+    void record_failure();
+
+    /**
+     * @brief Returns a snapshot of the handshake metrics.
+     */
+    tls_metrics metrics() const;
+
+  private:
+    /**
+     * @brief Called by OpenSSL when the server issues a session, during the
+     * handshake for TLS 1.2 and after it for TLS 1.3 tickets.
+     */
+    static int on_new_session(SSL* ssl, SSL_SESSION* session);
+
+  private:
+    /// The SSL context shared by all streams.
+    net::ssl::context context_;
+
+    /// The name used for SNI and certificate verification.
+    std::string server_name_;
+
+    /// Whether the server certificate is verified.
+    bool verify_peer_;
+
+    /// The most recent session issued by the server. Guarded by
+    /// session_mutex_.
+    SSL_SESSION* session_;
+
+    /// Guards session_.
+    mutable std::mutex session_mutex_;
+
+    /// The number of completed handshakes.
+    std::atomic<uint64_t> handshakes_;
+
+    /// The number of handshakes that resumed a session.
+    std::atomic<uint64_t> resumed_handshakes_;
+
+    /// The number of handshakes that failed.
+    std::atomic<uint64_t> failed_handshakes_;
+
+    /// The total time spent in completed handshakes in microseconds.
+    std::atomic<uint64_t> handshake_time_;
+
+    /// The duration of the most recent handshake in microseconds.
+    std::atomic<uint64_t> last_handshake_time_;
+};
+
+/**
+ * @brief A connection to a Redis server over TLS. Connections created with the
+ * same tls_context resume each other's sessions.
+ */
+class tls_connection : public connection {
+
+  public:
+    /**
+     * @brief Creates a TLS connection.
+     * @param exec The Asio executor to use for event handling.
+     * @param host The host of the Redis server.
+     * @param port The port of the Redis server.
+     * @param context The shared TLS state.
+     */
+    tls_connection(net::any_io_executor exec, std::string host, uint16_t port,
+                   std::shared_ptr<tls_context> context);
+
+    std::string endpoint() const override;
+
+    [[nodiscard]] awaitable<cpool::error> async_connect() override;
+
+    [[nodiscard]] awaitable<cpool::error> async_disconnect() override;
+
+    [[nodiscard]] awaitable<std::tuple<cpool::error, std::size_t>>
+    async_write(net::const_buffer buffer) override;
+
+    [[nodiscard]] awaitable<std::tuple<cpool::error, std::size_t>>
+    async_read_some(net::mutable_buffer buffer) override;
+
+    cpool::error cancel() override;
+
+  private:
+    /**
+     * @brief Resolves the host, connects the socket and performs the
+     * handshake.
+     */
+    [[nodiscard]] awaitable<cpool::error_code> open();
+
+    /**
+     * @brief Closes the socket.
+     */
+    void close();
+
+    /**
+     * @brief Closes the socket after a read or write error.
+     */
+    [[nodiscard]] awaitable<void> on_error(const cpool::error_code& error);
+
+  private:
+    /// The host of the Redis server.
+    std::string host_;
+
+    /// The port of the Redis server.
+    uint16_t port_;
+
+    /// The shared TLS state.
+    std::shared_ptr<tls_context> context_;
+
+    /// The stream, recreated for every connect since an SSL stream can not
+    /// be reused after it was shut down.
+    std::unique_ptr<net::ssl::stream<net::ip::tcp::socket>> stream_;
+};
+
+} // namespace redis
@@ -0,0 +1,93 @@
+#include "redis/unix_connection.hpp"
+
+namespace redis {
+
+using cpool::client_connection_state;
+
+unix_connection::unix_connection(net::any_io_executor exec, std::string path)
+    : connection(exec)
+    , path_(std::move(path))
+    , socket_(exec) {}
+
+std::string unix_connection::endpoint() const { return path_; }
+
+awaitable<cpool::error> unix_connection::async_connect() {
+    if (connected()) {
+        co_return cpool::error();
+    }
+
+    co_await set_state(client_connection_state::connecting);
+
+    cpool::error_code ec;
+    co_await socket_.async_connect(
+        net::local::stream_protocol::endpoint(path_),
+        net::redirect_error(net::use_awaitable, ec));
+    if (ec) {
+        cpool::error_code ignored;
+        socket_.close(ignored);
+        co_await set_state(client_connection_state::disconnected);
+        co_return ec;
+    }
+
+    auto error = co_await set_state(client_connection_state::connected);
+    if (error) {
+        co_await async_disconnect();
+        co_return error;
+    }
+
+    co_return cpool::error();
+}
+
+awaitable<cpool::error> unix_connection::async_disconnect() {
+    co_await set_state(client_connection_state::disconnecting);
+
+    cpool::error_code ec;
+    socket_.shutdown(net::socket_base::shutdown_both, ec);
+    socket_.close(ec);
+
+    co_await set_state(client_connection_state::disconnected);
+    co_return ec;
+}
+
+awaitable<std::tuple<cpool::error, std::size_t>>
+unix_connection::async_write(net::const_buffer buffer) {
+    cpool::error_code ec;
+    auto bytes_written = co_await net::async_write(
+        socket_, buffer, net::redirect_error(net::use_awaitable, ec));
+    if (ec) {
+        co_await on_error(ec);
+    }
+
+    co_return std::make_tuple(cpool::error(ec), bytes_written);
+}
+
+awaitable<std::tuple<cpool::error, std::size_t>>
+unix_connection::async_read_some(net::mutable_buffer buffer) {
+    cpool::error_code ec;
+    auto bytes_read = co_await socket_.async_read_some(
+        buffer, net::redirect_error(net::use_awaitable, ec));
+    if (ec) {
+        co_await on_error(ec);
+    }
+
+    co_return std::make_tuple(cpool::error(ec), bytes_read);
+}
+
+cpool::error unix_connection::cancel() {
+    cpool::error_code err;
+    socket_.cancel(err);
+    return cpool::error(err);
+}
+
+awaitable<void> unix_connection::on_error(const cpool::error_code& error) {
+    // a cancelled operation leaves the connection usable
+    if (error == net::error::operation_aborted || !connected()) {
+        co_return;
+    }
+
+    cpool::error_code ec;
+    socket_.close(ec);
+    co_await set_state(client_connection_state::disconnected);
+}
+
+} // namespace redis
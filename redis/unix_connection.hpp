@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+
+#include <boost/asio.hpp>
+
+#include "redis/connection.hpp"
+
+namespace redis {
+
+/**
+ * @brief A connection to a Redis server over a Unix domain socket. Useful
+ * when the server runs on the same host since it bypasses the TCP stack.
+ */
+class unix_connection : public connection {
+
+  public:
+    /**
+     * @brief Creates a Unix domain socket connection.
+     * @param exec The Asio executor to use for event handling.
+     * @param path The path of the socket, e.g. /var/run/redis/redis.sock
+     */
+    unix_connection(net::any_io_executor exec, std::string path);
+
+    std::string endpoint() const override;
+
+    [[nodiscard]] awaitable<cpool::error> async_connect() override;
+
+    [[nodiscard]] awaitable<cpool::error> async_disconnect() override;
+
+    [[nodiscard]] awaitable<std::tuple<cpool::error, std::size_t>>
+    async_write(net::const_buffer buffer) override;
+
+    [[nodiscard]] awaitable<std::tuple<cpool::error, std::size_t>>
+    async_read_some(net::mutable_buffer buffer) override;
+
+    cpool::error cancel() override;
+
+  private:
+    /**
+     * @brief Closes the socket after a read or write error.
+     */
+    [[nodiscard]] awaitable<void> on_error(const cpool::error_code& error);
+
+  private:
+    /// The path of the socket.
+    std::string path_;
+
+    /// The socket connected to the server.
+    net::local::stream_protocol::socket socket_;
+};
+
+} // namespace redis
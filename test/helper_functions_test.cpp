@@ -20,4 +20,20 @@ TEST(Helper_Functions, vector_to_string) {
     EXPECT_EQ(test_string, redis::vector_to_string(test_vector));
 }
 
+TEST(Helper_Functions, recompute_early) {
+    using namespace std::chrono_literals;
+
+    // -ln(0.5) is about 0.69, so a 100ms computation starts 69ms early
+    EXPECT_FALSE(redis::recompute_early(100ms, 100ms, 1.0, 0.5));
+    EXPECT_TRUE(redis::recompute_early(60ms, 100ms, 1.0, 0.5));
+    EXPECT_TRUE(redis::recompute_early(100ms, 100ms, 2.0, 0.5));
+
+    // a draw of 1 only recomputes once the value has expired
+    EXPECT_FALSE(redis::recompute_early(1ms, 100ms, 1.0, 1.0));
+    EXPECT_TRUE(redis::recompute_early(0ms, 100ms, 1.0, 1.0));
+
+    // values without an expiry are never recomputed
+    EXPECT_FALSE(redis::recompute_early(-1ms, 100ms, 1.0, 0.01));
+}
+
 }
\ No newline at end of file
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <string>
@@ -6,6 +7,7 @@
 #include <fmt/format.h>
 
 #include "cpool/awaitable_latch.hpp"
+#include "redis/cached_client.hpp"
 #include "redis/client.hpp"
 #include "redis/command.hpp"
 #include "redis/commands-hash.hpp"
@@ -717,6 +719,532 @@ awaitable<void> run_json_tests(asio::io_context& ctx) {
     co_return;
 }
 
+awaitable<void> run_warm_up_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    auto config =
+        client_config{}.set_host(host).set_port(6379).set_min_idle_connections(
+            4);
+
+    client client(exec, config);
+    client.set_logging_handler(std::bind(
+        logMessage, logLevel, std::placeholders::_1, std::placeholders::_2));
+
+    auto error = co_await client.warm_up();
+    EXPECT_FALSE(error) << error.message();
+    EXPECT_TRUE(client.running());
+
+    auto reply = co_await client.ping();
+    testForValue("PING", reply, "PONG");
+
+    co_await client.stop();
+
+    ctx.stop();
+    co_return;
+}
+
+/// Holds a connection of the client for a moment.
+awaitable<void> block_briefly(client& client, cpool::awaitable_latch& done) {
+    auto reply = co_await client.send(redis::command("BLPOP health:none 0.1"));
+    testForType("BLPOP", reply, redis_type::nil);
+    done.count_down();
+}
+
+/// Returns the ID of the connection the client uses next.
+awaitable<string> connection_id(client& client) {
+    auto reply = co_await client.send(redis::command("CLIENT ID"));
+    co_return std::to_string(reply.value().as<int64_t>().value_or(0));
+}
+
+/// Counts the logged messages that contain the text.
+size_t count_logged(const std::vector<string>& messages,
+                    std::string_view text) {
+    return std::count_if(messages.begin(), messages.end(),
+                         [text](const string& message) {
+                             return message.find(text) != string::npos;
+                         });
+}
+
+awaitable<void> run_health_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    client admin(exec, client_config{}.set_host(host));
+    asio::steady_timer timer(exec);
+
+    // the connection beyond min_idle_connections idles out
+    std::vector<string> messages;
+    auto config = client_config{}
+                      .set_host(host)
+                      .set_max_connections(2)
+                      .set_min_idle_connections(1)
+                      .set_idle_ping_interval(50ms)
+                      .set_max_idle_time(200ms);
+    client client(exec, config);
+    client.set_logging_handler([&messages](log_level, string_view message) {
+        messages.emplace_back(message);
+    });
+    auto error = co_await client.warm_up();
+    EXPECT_FALSE(error) << error.message();
+
+    cpool::awaitable_latch done(exec, 2);
+    cpool::co_spawn(exec, block_briefly(client, done), cpool::detached);
+    cpool::co_spawn(exec, block_briefly(client, done), cpool::detached);
+    co_await done.wait();
+
+    // the pings of the keep-alive do not count as uses
+    for (int i = 0; i < 100 && count_logged(messages, "idle timeout") == 0;
+         i++) {
+        timer.expires_after(10ms);
+        co_await timer.async_wait(asio::use_awaitable);
+    }
+    EXPECT_EQ(count_logged(messages, "idle timeout"), 1);
+
+    // a connection that fails its PING is evicted and reconnected on use
+    auto id = co_await connection_id(client);
+    auto kill = redis::command(std::vector<string>{"CLIENT", "KILL", "ID", id});
+    auto reply = co_await admin.send(kill);
+    testForValue("CLIENT KILL", reply, 1);
+    for (int i = 0; i < 100 && count_logged(messages, "ping of pooled") == 0;
+         i++) {
+        timer.expires_after(10ms);
+        co_await timer.async_wait(asio::use_awaitable);
+    }
+    EXPECT_GE(count_logged(messages, "ping of pooled"), 1);
+
+    reply = co_await client.ping();
+    testForValue("PING", reply, "PONG");
+    co_await client.stop();
+
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_retry_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    client admin(exec, client_config{}.set_host(host));
+    client client(exec,
+                  client_config{}.set_host(host).set_max_connections(1));
+
+    auto reply = co_await client.send(redis::set("retry", "42"));
+    testForSuccess("SET", reply);
+
+    // a read-only command is retried once on a fresh connection
+    auto id = co_await connection_id(client);
+    auto kill = redis::command(std::vector<string>{"CLIENT", "KILL", "ID", id});
+    reply = co_await admin.send(kill);
+    testForValue("CLIENT KILL", reply, 1);
+    reply = co_await client.send(redis::get("retry"));
+    testForValue("GET", reply, 42);
+
+    // a write is not, since it may have been executed
+    id = co_await connection_id(client);
+    kill = redis::command(std::vector<string>{"CLIENT", "KILL", "ID", id});
+    reply = co_await admin.send(kill);
+    testForValue("CLIENT KILL", reply, 1);
+    reply = co_await client.send(redis::set("retry", "43"));
+    EXPECT_TRUE(reply.error());
+
+    reply = co_await client.send(redis::del("retry"));
+    testForValue("DEL", reply, 1);
+
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_repoint_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+
+    // start on the server that requires a password
+    client client(exec, client_config{}.set_host(host).set_port(6380));
+    client.set_logging_handler(std::bind(
+        logMessage, logLevel, std::placeholders::_1, std::placeholders::_2));
+
+    auto reply = co_await client.ping();
+    EXPECT_EQ(reply.error(), client_error_code::error);
+
+    client.repoint(host, 6379);
+    EXPECT_EQ(client.config().port, 6379);
+
+    reply = co_await client.ping();
+    testForValue("PING", reply, "PONG");
+
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_replica_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+
+    // the server stands in for its own replicas
+    client client(exec, client_config{}
+                            .set_host(host)
+                            .add_replica(host, 6379)
+                            .add_replica(host, 6379)
+                            .set_read_policy(read_policy::fastest)
+                            .set_hedge_reads(true)
+                            .set_hedge_min_delay(0ms));
+    client.set_logging_handler(std::bind(
+        logMessage, logLevel, std::placeholders::_1, std::placeholders::_2));
+
+    auto reply = co_await client.send(redis::set("replica", "42"));
+    testForSuccess("SET", reply);
+
+    // enough reads for the replicas to have latency percentiles to hedge on
+    for (int i = 0; i < 100; i++) {
+        reply = co_await client.send(redis::get("replica"));
+        testForValue("GET", reply, 42);
+    }
+
+    // reads fall back to the master when the replica is unreachable
+    auto fallback_config = client_config{}
+                               .set_host(host)
+                               .add_replica(host, 6399)
+                               .set_read_policy(read_policy::round_robin);
+    redis::client fallback(exec, fallback_config);
+    reply = co_await fallback.send(redis::get("replica"));
+    testForValue("GET", reply, 42);
+
+    reply = co_await client.send(redis::del("replica"));
+    testForValue("DEL", reply, 1);
+
+    co_await client.stop();
+    co_await fallback.stop();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_near_cache_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+
+    client cached(exec, client_config{}.set_host(host).set_near_cache(1 << 20));
+    client writer(exec, client_config{}.set_host(host));
+    cached.set_logging_handler(std::bind(
+        logMessage, logLevel, std::placeholders::_1, std::placeholders::_2));
+
+    auto error = co_await cached.warm_up();
+    EXPECT_FALSE(error) << error.message();
+
+    auto reply = co_await writer.send(redis::set("near", "1"));
+    testForSuccess("SET", reply);
+
+    reply = co_await cached.send(redis::get("near"));
+    testForValue("GET", reply, 1);
+    reply = co_await cached.send(redis::get("near"));
+    testForValue("GET", reply, 1);
+    EXPECT_EQ(cached.cache_metrics().hits, 1);
+    EXPECT_EQ(cached.cache_metrics().misses, 1);
+
+    // the write of another client evicts the cached reply
+    reply = co_await writer.send(redis::set("near", "2"));
+    testForSuccess("SET", reply);
+
+    asio::steady_timer timer(exec);
+    for (int i = 0; i < 100 && cached.cache_metrics().invalidations == 0;
+         i++) {
+        timer.expires_after(10ms);
+        co_await timer.async_wait(asio::use_awaitable);
+    }
+    EXPECT_EQ(cached.cache_metrics().invalidations, 1);
+
+    reply = co_await cached.send(redis::get("near"));
+    testForValue("GET", reply, 2);
+
+    reply = co_await writer.send(redis::del("near"));
+    testForValue("DEL", reply, 1);
+
+    co_await cached.stop();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> test_coalesced_read(client& client,
+                                    cpool::awaitable_latch& barrier) {
+    auto reply = co_await client.send(redis::get("coalesced"));
+    testForValue("GET", reply, 42);
+
+    barrier.count_down();
+    co_return;
+}
+
+awaitable<void> run_coalesce_tests(asio::io_context& ctx) {
+    const int num_runners = 50;
+    auto exec = co_await cpool::net::this_coro::executor;
+    cpool::awaitable_latch barrier(exec, num_runners);
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+
+    client client(exec, client_config{}.set_host(host).set_coalesce_reads(true));
+
+    auto reply = co_await client.send(redis::set("coalesced", "42"));
+    testForSuccess("SET", reply);
+
+    for (int i = 0; i < num_runners; i++) {
+        cpool::co_spawn(ctx, test_coalesced_read(client, barrier),
+                        cpool::detached);
+    }
+
+    co_await barrier.wait();
+    EXPECT_GT(client.coalesced_reads(), 0);
+
+    // a read sent after the flight landed sees the latest write
+    reply = co_await client.send(redis::set("coalesced", "43"));
+    testForSuccess("SET", reply);
+    reply = co_await client.send(redis::get("coalesced"));
+    testForValue("GET", reply, 43);
+
+    reply = co_await client.send(redis::del("coalesced"));
+    testForValue("DEL", reply, 1);
+
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> test_get_or_compute(client& client, int& computations,
+                                    cpool::awaitable_latch& barrier) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto reply = co_await client.get_or_compute(
+        "computed", 10s, [&computations, exec]() -> awaitable<std::string> {
+            computations++;
+            asio::steady_timer timer(exec, 50ms);
+            co_await timer.async_wait(asio::use_awaitable);
+            co_return "42";
+        });
+    testForValue("GET", reply, 42);
+
+    barrier.count_down();
+    co_return;
+}
+
+awaitable<void> run_get_or_compute_tests(asio::io_context& ctx) {
+    const int num_runners = 20;
+    auto exec = co_await cpool::net::this_coro::executor;
+    cpool::awaitable_latch barrier(exec, num_runners);
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+
+    client client(exec, client_config{}.set_host(host));
+    auto reply = co_await client.send(
+        redis::del("computed", "computed:delta", "computed:lock"));
+    testForType("DEL", reply, redis_type::integer);
+
+    // every caller misses, but only the lock holder computes
+    int computations = 0;
+    for (int i = 0; i < num_runners; i++) {
+        cpool::co_spawn(ctx, test_get_or_compute(client, computations, barrier),
+                        cpool::detached);
+    }
+
+    co_await barrier.wait();
+    EXPECT_EQ(computations, 1);
+
+    reply = co_await client.send(redis::get("computed:delta"));
+    EXPECT_GE(reply.value().as<int64_t>().value_or(0), 50);
+    reply = co_await client.send(redis::pttl("computed"));
+    EXPECT_GT(reply.value().as<int64_t>().value_or(0), 0);
+    reply = co_await client.send(redis::exists("computed:lock"));
+    testForValue("EXISTS", reply, 0);
+
+    reply = co_await client.send(redis::del("computed", "computed:delta"));
+    testForValue("DEL", reply, 2);
+
+    // a failed compute releases the lock for the next caller
+    bool thrown = false;
+    try {
+        co_await client.get_or_compute(
+            "computed", 10s, []() -> awaitable<std::string> {
+                throw std::runtime_error("compute failed");
+                co_return "";
+            });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    EXPECT_TRUE(thrown);
+    reply = co_await client.send(redis::exists("computed:lock"));
+    testForValue("EXISTS", reply, 0);
+
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_cached_client_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+
+    client client(exec, client_config{}.set_host(host));
+    cached_client cached(client, local_cache_config().set_default_ttl(10s));
+
+    auto reply = co_await cached.send(redis::set("local", "1"));
+    testForSuccess("SET", reply);
+    reply = co_await cached.send(redis::pexpire("local", 50ms));
+    testForValue("PEXPIRE", reply, 1);
+
+    reply = co_await cached.send(redis::get("local"));
+    testForValue("GET", reply, 1);
+    reply = co_await cached.send(redis::get("local"));
+    testForValue("GET", reply, 1);
+    EXPECT_EQ(cached.metrics().hits, 1);
+
+    // the reply is not served past the expiry of the key
+    asio::steady_timer timer(exec);
+    timer.expires_after(100ms);
+    co_await timer.async_wait(asio::use_awaitable);
+    reply = co_await cached.send(redis::get("local"));
+    testForType("GET", reply, redis_type::nil);
+
+    // the nil reply is cached briefly
+    reply = co_await cached.send(redis::get("local"));
+    testForType("GET", reply, redis_type::nil);
+    EXPECT_EQ(cached.metrics().hits, 2);
+
+    // writes through the cached client drop the entries of their key
+    reply = co_await cached.send(redis::set("local", "2"));
+    testForSuccess("SET", reply);
+    reply = co_await cached.send(redis::get("local"));
+    testForValue("GET", reply, 2);
+
+    reply = co_await cached.send(redis::del("local"));
+    testForValue("DEL", reply, 1);
+
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_broadcast_cache_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+
+    client cached(exec, client_config{}.set_host(host).add_near_cache_region(
+                            "bcast:", 1 << 20));
+    client writer(exec, client_config{}.set_host(host));
+
+    auto error = co_await cached.warm_up();
+    EXPECT_FALSE(error) << error.message();
+
+    auto reply = co_await writer.send(redis::set("bcast:near", "1"));
+    testForSuccess("SET", reply);
+    reply = co_await writer.send(redis::set("near", "1"));
+    testForSuccess("SET", reply);
+
+    // keys outside the regions are not cached
+    reply = co_await cached.send(redis::get("near"));
+    testForValue("GET", reply, 1);
+    reply = co_await cached.send(redis::get("bcast:near"));
+    testForValue("GET", reply, 1);
+    reply = co_await cached.send(redis::get("bcast:near"));
+    testForValue("GET", reply, 1);
+    EXPECT_EQ(cached.cache_metrics().hits, 1);
+    EXPECT_EQ(cached.cache_metrics().entries, 1);
+
+    reply = co_await writer.send(redis::set("bcast:near", "2"));
+    testForSuccess("SET", reply);
+
+    asio::steady_timer timer(exec);
+    for (int i = 0; i < 100 && cached.cache_metrics().invalidations == 0;
+         i++) {
+        timer.expires_after(10ms);
+        co_await timer.async_wait(asio::use_awaitable);
+    }
+    EXPECT_EQ(cached.cache_metrics().invalidations, 1);
+
+    reply = co_await cached.send(redis::get("bcast:near"));
+    testForValue("GET", reply, 2);
+
+    reply = co_await writer.send(redis::del("bcast:near"));
+    testForValue("DEL", reply, 1);
+    reply = co_await writer.send(redis::del("near"));
+    testForValue("DEL", reply, 1);
+
+    co_await cached.stop();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_nested_region_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+
+    // Redis rejects overlapping tracking prefixes, so only "nest:" is sent
+    client cached(exec, client_config{}
+                            .set_host(host)
+                            .add_near_cache_region("nest:", 1 << 20)
+                            .add_near_cache_region("nest:session:", 1 << 20));
+    client writer(exec, client_config{}.set_host(host));
+
+    auto error = co_await cached.warm_up();
+    EXPECT_FALSE(error) << error.message();
+
+    auto reply = co_await writer.send(redis::set("nest:session:1", "1"));
+    testForSuccess("SET", reply);
+    reply = co_await cached.send(redis::get("nest:session:1"));
+    testForValue("GET", reply, 1);
+    reply = co_await cached.send(redis::get("nest:session:1"));
+    testForValue("GET", reply, 1);
+    EXPECT_EQ(cached.cache_metrics().hits, 1);
+
+    // the invalidations of the outer prefix cover the inner region
+    reply = co_await writer.send(redis::set("nest:session:1", "2"));
+    testForSuccess("SET", reply);
+
+    asio::steady_timer timer(exec);
+    for (int i = 0; i < 100 && cached.cache_metrics().invalidations == 0;
+         i++) {
+        timer.expires_after(10ms);
+        co_await timer.async_wait(asio::use_awaitable);
+    }
+    EXPECT_EQ(cached.cache_metrics().invalidations, 1);
+
+    reply = co_await cached.send(redis::get("nest:session:1"));
+    testForValue("GET", reply, 2);
+
+    reply = co_await writer.send(redis::del("nest:session:1"));
+    testForValue("DEL", reply, 1);
+
+    co_await cached.stop();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_large_reply_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    client client(exec,
+                  client_config{}.set_host(host).set_max_connections(1));
+
+    // much larger than one read, and shaped like replies once truncated
+    std::string payload;
+    while (payload.size() < 20000) {
+        payload += ":1\r\n+OK\r\n";
+    }
+    auto reply = co_await client.send(redis::set("large", payload));
+    testForValue("SET", reply, "OK");
+
+    redis::commands pipeline;
+    pipeline.push_back(redis::get("large"));
+    pipeline.push_back(redis::command("PING"));
+    pipeline.push_back(redis::get("large"));
+    auto replies = co_await client.send(pipeline);
+    EXPECT_EQ(replies.size(), 3);
+    if (replies.size() == 3) {
+        testForValue("GET", replies[0], payload);
+        testForValue("PING", replies[1], "PONG");
+        testForValue("GET", replies[2], payload);
+    }
+
+    // nothing is left on the connection for the next command
+    reply = co_await client.send(redis::get("large"));
+    testForValue("GET", reply, payload);
+    reply = co_await client.ping();
+    testForValue("PING", reply, "PONG");
+
+    reply = co_await client.send(redis::del("large"));
+    testForValue("DEL", reply, 1);
+
+    ctx.stop();
+    co_return;
+}
+
 TEST(Redis, BasicTest) {
     asio::io_context ctx(1);
 
@@ -781,4 +1309,105 @@ TEST(Redis, JsonTest) {
     ctx.run();
 }
 
+TEST(Redis, WarmUpTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_warm_up_tests(std::ref(ctx)), cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Redis, HealthTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_health_tests(std::ref(ctx)), cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Redis, RetryTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_retry_tests(std::ref(ctx)), cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Redis, RepointTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_repoint_tests(std::ref(ctx)), cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Redis, ReplicaTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_replica_tests(std::ref(ctx)), cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Redis, NearCacheTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_near_cache_tests(std::ref(ctx)), cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Redis, CoalesceTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_coalesce_tests(std::ref(ctx)), cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Redis, GetOrComputeTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_get_or_compute_tests(std::ref(ctx)),
+                    cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Redis, CachedClientTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_cached_client_tests(std::ref(ctx)),
+                    cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Redis, LargeReplyTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_large_reply_tests(std::ref(ctx)),
+                    cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Redis, BroadcastCacheTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_broadcast_cache_tests(std::ref(ctx)),
+                    cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Redis, NestedRegionTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_nested_region_tests(std::ref(ctx)),
+                    cpool::detached);
+
+    ctx.run();
+}
+
 } // namespace
\ No newline at end of file
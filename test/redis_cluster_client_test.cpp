@@ -0,0 +1,143 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "redis/cluster_client.hpp"
+#include "redis/commands.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "test_functions.hpp"
+
+namespace {
+
+using string = std::string;
+using namespace redis;
+
+// A cluster started with redis-server --cluster-enabled yes on ports 7000 to
+// 7005, e.g. the redis-cluster service in docker-compose.yml
+const std::string DEFAULT_REDIS_CLUSTER_HOST = "host.docker.internal";
+const uint16_t DEFAULT_REDIS_CLUSTER_PORT = 7000;
+
+std::optional<std::string> get_env_var(std::string const& key) {
+    char* val = getenv(key.c_str());
+    return (val == NULL) ? std::nullopt : std::optional(std::string(val));
+}
+
+client_config cluster_config() {
+    auto host =
+        get_env_var("REDIS_CLUSTER_HOST").value_or(DEFAULT_REDIS_CLUSTER_HOST);
+    auto port = get_env_var("REDIS_CLUSTER_PORT");
+    return client_config{}.set_host(host).set_port(
+        port ? std::stoi(*port) : DEFAULT_REDIS_CLUSTER_PORT);
+}
+
+awaitable<void> run_cluster_tests(asio::io_context& ctx) {
+    auto exec = co_await asio::this_coro::executor;
+    cluster_client client(exec, cluster_config());
+
+    auto error = co_await client.start();
+    EXPECT_FALSE(error) << error.message();
+    EXPECT_GT(client.size(), 1);
+
+    // keys on every node
+    for (int i = 0; i < 32; i++) {
+        auto key = "cluster" + std::to_string(i);
+        EXPECT_TRUE(client.node_for_slot(hash_slot(key)).has_value());
+
+        auto reply = co_await client.send(redis::set(key, "42"));
+        testForSuccess("SET", reply);
+
+        reply = co_await client.send(redis::get(key));
+        testForValue("GET", reply, 42);
+
+        reply = co_await client.send(redis::del(key));
+        testForValue("DEL", reply, 1);
+    }
+
+    // hash tags keep multi-key commands on one node
+    commands tagged{redis::set("{user1}.name", "bob"),
+                    redis::set("{user1}.age", "42"),
+                    redis::command("MGET {user1}.name {user1}.age"),
+                    redis::command("DEL {user1}.name {user1}.age")};
+    auto replies = co_await client.send(tagged);
+    EXPECT_EQ(replies.size(), 4);
+    if (replies.size() == 4) {
+        testForSuccess("SET", replies[0]);
+        testForSuccess("SET", replies[1]);
+        testForArraySize("MGET", replies[2], 2);
+        testForValue("DEL", replies[3], 2);
+    }
+
+    // a pipeline spanning nodes is redirected per command
+    commands spanning{redis::set("foo", "1"),    redis::set("bar", "2"),
+                      redis::get("foo"),         redis::get("bar"),
+                      redis::command("DEL foo"), redis::command("DEL bar")};
+    replies = co_await client.send(spanning);
+    EXPECT_EQ(replies.size(), 6);
+    if (replies.size() == 6) {
+        testForValue("GET", replies[2], 1);
+        testForValue("GET", replies[3], 2);
+    }
+
+    // multi-key commands are split by slot and merged in the key order
+    commands batch{redis::set("foo", "1"), redis::set("bar", "2"),
+                   redis::set("baz", "3"),
+                   redis::command("MGET foo missing bar baz"),
+                   redis::command("EXISTS foo bar baz missing"),
+                   redis::command("DEL foo bar baz")};
+    replies = co_await client.send(batch);
+    EXPECT_EQ(replies.size(), 6);
+    if (replies.size() == 6) {
+        auto values = replies[3].value().as<redis_array>();
+        EXPECT_TRUE(values.has_value());
+        if (values.has_value() && values->size() == 4) {
+            EXPECT_EQ((*values)[0].as<int>().value_or(0), 1);
+            EXPECT_EQ((*values)[1].type(), redis_type::nil);
+            EXPECT_EQ((*values)[2].as<int>().value_or(0), 2);
+            EXPECT_EQ((*values)[3].as<int>().value_or(0), 3);
+        }
+        testForValue("EXISTS", replies[4], 3);
+        testForValue("DEL", replies[5], 3);
+    }
+
+    co_await client.stop();
+    ctx.stop();
+}
+
+awaitable<void> run_redirect_tests(asio::io_context& ctx) {
+    auto exec = co_await asio::this_coro::executor;
+    cluster_client client(exec, cluster_config());
+
+    // without the slot map every keyed command starts at the seed and is
+    // redirected with MOVED
+    for (int i = 0; i < 8; i++) {
+        auto key = "redirect" + std::to_string(i);
+        auto reply = co_await client.send(redis::set(key, "1"));
+        testForSuccess("SET", reply);
+        EXPECT_TRUE(client.node_for_slot(hash_slot(key)).has_value());
+
+        reply = co_await client.send(redis::del(key));
+        testForValue("DEL", reply, 1);
+    }
+
+    co_await client.stop();
+    ctx.stop();
+}
+
+TEST(ClusterClient, Send) {
+    asio::io_context ctx(1);
+
+    asio::co_spawn(ctx, run_cluster_tests(ctx), asio::detached);
+    ctx.run();
+}
+
+TEST(ClusterClient, Redirect) {
+    asio::io_context ctx(1);
+
+    asio::co_spawn(ctx, run_redirect_tests(ctx), asio::detached);
+    ctx.run();
+}
+
+} // namespace
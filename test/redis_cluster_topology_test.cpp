@@ -0,0 +1,102 @@
+#include <string>
+#include <vector>
+
+#include "redis/cluster_topology.hpp"
+#include "redis/reply.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using string = std::string;
+using namespace redis;
+
+redis::reply make_reply(string data) {
+    return redis::reply(std::vector<uint8_t>(data.begin(), data.end()));
+}
+
+TEST(Redis_Cluster_Topology, Moved) {
+    auto redirect =
+        parse_redirect(make_reply("-MOVED 3999 127.0.0.1:6381\r\n"));
+    ASSERT_TRUE(redirect.has_value());
+    EXPECT_FALSE(redirect->ask);
+    EXPECT_EQ(redirect->slot, 3999);
+    EXPECT_EQ(redirect->node, (cluster_node{"127.0.0.1", 6381}));
+    EXPECT_EQ(redirect->node.endpoint(), "127.0.0.1:6381");
+}
+
+TEST(Redis_Cluster_Topology, Ask) {
+    auto redirect = parse_redirect(make_reply("-ASK 42 redis-2:7001\r\n"));
+    ASSERT_TRUE(redirect.has_value());
+    EXPECT_TRUE(redirect->ask);
+    EXPECT_EQ(redirect->slot, 42);
+    EXPECT_EQ(redirect->node, (cluster_node{"redis-2", 7001}));
+
+    // nodes without an announced host name redirect to the same host
+    redirect = parse_redirect(make_reply("-ASK 42 :7001\r\n"));
+    ASSERT_TRUE(redirect.has_value());
+    EXPECT_EQ(redirect->node, (cluster_node{"", 7001}));
+
+    // IPv6 addresses contain colons
+    redirect = parse_redirect(make_reply("-MOVED 1 ::1:7002\r\n"));
+    ASSERT_TRUE(redirect.has_value());
+    EXPECT_EQ(redirect->node, (cluster_node{"::1", 7002}));
+}
+
+TEST(Redis_Cluster_Topology, Not_A_Redirect) {
+    EXPECT_FALSE(parse_redirect(make_reply("+OK\r\n")).has_value());
+    EXPECT_FALSE(parse_redirect(make_reply("-ERR unknown\r\n")).has_value());
+    EXPECT_FALSE(
+        parse_redirect(make_reply("-MOVED 99999 a:1\r\n")).has_value());
+    EXPECT_FALSE(parse_redirect(make_reply("-MOVED 1 nohost\r\n")).has_value());
+}
+
+TEST(Redis_Cluster_Topology, Retry) {
+    EXPECT_EQ(parse_retry(make_reply("-TRYAGAIN Multiple keys request during "
+                                     "rehashing of slot\r\n")),
+              cluster_retry::try_again);
+    EXPECT_EQ(parse_retry(make_reply("-CLUSTERDOWN The cluster is down\r\n")),
+              cluster_retry::cluster_down);
+    EXPECT_FALSE(parse_retry(make_reply("+OK\r\n")).has_value());
+    EXPECT_FALSE(parse_retry(make_reply("-ERR unknown\r\n")).has_value());
+    EXPECT_FALSE(
+        parse_retry(make_reply("-MOVED 3999 127.0.0.1:6381\r\n")).has_value());
+}
+
+TEST(Redis_Cluster_Topology, Cluster_Slots) {
+    auto ranges = parse_cluster_slots(make_reply(
+        "*2\r\n"
+        "*4\r\n:0\r\n:5460\r\n"
+        "*3\r\n$9\r\n127.0.0.1\r\n:30001\r\n$2\r\nid\r\n"
+        "*3\r\n$9\r\n127.0.0.1\r\n:30004\r\n$2\r\nid\r\n"
+        "*3\r\n:5461\r\n:16383\r\n"
+        "*2\r\n$0\r\n\r\n:30002\r\n"));
+    ASSERT_TRUE(ranges.has_value());
+    ASSERT_EQ(ranges->size(), 2);
+
+    EXPECT_EQ((*ranges)[0].first, 0);
+    EXPECT_EQ((*ranges)[0].last, 5460);
+    EXPECT_EQ((*ranges)[0].master, (cluster_node{"127.0.0.1", 30001}));
+    ASSERT_EQ((*ranges)[0].replicas.size(), 1);
+    EXPECT_EQ((*ranges)[0].replicas[0], (cluster_node{"127.0.0.1", 30004}));
+
+    EXPECT_EQ((*ranges)[1].first, 5461);
+    EXPECT_EQ((*ranges)[1].last, 16383);
+    EXPECT_EQ((*ranges)[1].master, (cluster_node{"", 30002}));
+    EXPECT_TRUE((*ranges)[1].replicas.empty());
+}
+
+TEST(Redis_Cluster_Topology, Cluster_Slots_Malformed) {
+    EXPECT_FALSE(parse_cluster_slots(make_reply("-ERR cluster support "
+                                                "disabled\r\n"))
+                     .has_value());
+    EXPECT_FALSE(parse_cluster_slots(make_reply("*1\r\n*2\r\n:0\r\n:10\r\n"))
+                     .has_value());
+    EXPECT_FALSE(parse_cluster_slots(
+                     make_reply("*1\r\n*3\r\n:0\r\n:16384\r\n"
+                                "*2\r\n$1\r\na\r\n:1\r\n"))
+                     .has_value());
+}
+
+} // namespace
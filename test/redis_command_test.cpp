@@ -163,4 +163,39 @@ TEST(Redis_Command, DEL_Key) {
               "*2\r\n$3\r\nDEL\r\n$4\r\ntemp\r\n");
 }
 
+TEST(Redis_Command, Name) {
+    EXPECT_EQ(redis::command("").name(), "");
+    EXPECT_EQ(redis::command("get temp").name(), "GET");
+    EXPECT_EQ(redis::command("json.get temp .").name(), "JSON.GET");
+    EXPECT_EQ(redis::command(std::vector<std::string>{"mGet", "a"}).name(),
+              "MGET");
+
+    // the name is computed once, not on every call
+    redis::command command("hget temp field");
+    EXPECT_EQ(&command.name(), &command.name());
+}
+
+TEST(Redis_Command, Read_Only) {
+    EXPECT_TRUE(redis::command("PING").read_only());
+    EXPECT_TRUE(redis::command("get temp").read_only());
+    EXPECT_TRUE(redis::command("HGETALL temp").read_only());
+    EXPECT_FALSE(redis::command("SET temp value").read_only());
+    EXPECT_FALSE(redis::command("INCR temp").read_only());
+    EXPECT_FALSE(redis::command("").read_only());
+}
+
+TEST(Redis_Command, Keys) {
+    using keys = std::vector<string>;
+    EXPECT_EQ(redis::command("").keys(), keys());
+    EXPECT_EQ(redis::command("PING").keys(), keys());
+    EXPECT_EQ(redis::command("PUBLISH channel message").keys(), keys());
+    EXPECT_EQ(redis::command("GET temp").keys(), keys{"temp"});
+    EXPECT_EQ(redis::command("SET temp value").keys(), keys{"temp"});
+    EXPECT_EQ(redis::command("MGET a b c").keys(), (keys{"a", "b", "c"}));
+    EXPECT_EQ(redis::command("MSET a 1 b 2").keys(), (keys{"a", "b"}));
+    EXPECT_EQ(redis::command("RENAME a b").keys(), (keys{"a", "b"}));
+    EXPECT_EQ(redis::command("EVAL script 2 a b arg").keys(), (keys{"a", "b"}));
+    EXPECT_EQ(redis::command("EVAL script 0 arg").keys(), keys());
+}
+
 } // namespace
\ No newline at end of file
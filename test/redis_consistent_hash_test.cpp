@@ -0,0 +1,99 @@
+#include <string>
+#include <vector>
+
+#include "redis/consistent_hash.hpp"
+#include "redis/hash_slot.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis;
+
+std::vector<std::string> make_nodes(size_t count) {
+    std::vector<std::string> nodes;
+    for (size_t i = 0; i < count; i++) {
+        nodes.push_back("10.0.0." + std::to_string(i + 1) + ":6379");
+    }
+    return nodes;
+}
+
+std::vector<size_t> count_slots(const std::vector<uint16_t>& slots,
+                                size_t num_nodes) {
+    std::vector<size_t> counts(num_nodes, 0);
+    for (auto owner : slots) {
+        counts.at(owner)++;
+    }
+    return counts;
+}
+
+TEST(Redis_Consistent_Hash, Jump_Range) {
+    EXPECT_EQ(jump_consistent_hash(12345, 1), 0);
+    for (uint64_t key = 0; key < 1000; key++) {
+        auto bucket = jump_consistent_hash(key * 7919, 10);
+        EXPECT_GE(bucket, 0);
+        EXPECT_LT(bucket, 10);
+    }
+}
+
+TEST(Redis_Consistent_Hash, Jump_Moves_To_New_Bucket) {
+    for (uint64_t key = 0; key < 1000; key++) {
+        auto before = jump_consistent_hash(key * 104729, 5);
+        auto after = jump_consistent_hash(key * 104729, 6);
+        if (before != after) {
+            EXPECT_EQ(after, 5);
+        }
+    }
+}
+
+TEST(Redis_Consistent_Hash, Balanced) {
+    for (auto algorithm : {hash_algorithm::jump, hash_algorithm::ketama}) {
+        auto counts = count_slots(assign_slots(algorithm, make_nodes(4)), 4);
+        for (auto count : counts) {
+            EXPECT_GT(count, num_hash_slots / 4 * 6 / 10);
+            EXPECT_LT(count, num_hash_slots / 4 * 14 / 10);
+        }
+    }
+}
+
+TEST(Redis_Consistent_Hash, Adding_Node_Moves_Few_Slots) {
+    for (auto algorithm : {hash_algorithm::jump, hash_algorithm::ketama}) {
+        auto before = assign_slots(algorithm, make_nodes(4));
+        auto after = assign_slots(algorithm, make_nodes(5));
+
+        size_t moved = 0;
+        for (size_t slot = 0; slot < num_hash_slots; slot++) {
+            if (before[slot] != after[slot]) {
+                // slots only ever move to the new node
+                EXPECT_EQ(after[slot], 4);
+                moved++;
+            }
+        }
+
+        EXPECT_GT(moved, num_hash_slots / 5 / 2);
+        EXPECT_LT(moved, num_hash_slots / 5 * 2);
+    }
+}
+
+TEST(Redis_Consistent_Hash, Ketama_Ignores_Node_Order) {
+    auto nodes = make_nodes(3);
+    ketama_ring ring(nodes);
+    std::vector<std::string> reversed(nodes.rbegin(), nodes.rend());
+    ketama_ring reversed_ring(reversed);
+
+    for (uint32_t hash = 0; hash < 1000000; hash += 997) {
+        EXPECT_EQ(nodes[ring.node_for(hash)],
+                  reversed[reversed_ring.node_for(hash)]);
+    }
+
+    EXPECT_TRUE(ketama_ring({}).empty());
+}
+
+TEST(Redis_Consistent_Hash, Hash_Tags_Share_Node) {
+    auto slots = assign_slots(hash_algorithm::ketama, make_nodes(8));
+    EXPECT_EQ(slots[hash_slot("{user1000}.following")],
+              slots[hash_slot("{user1000}.followers")]);
+}
+
+} // namespace
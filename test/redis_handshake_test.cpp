@@ -0,0 +1,58 @@
+#include "redis/handshake.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using string = std::string;
+
+TEST(Redis_Handshake, Empty) {
+    auto handshake = redis::handshake_commands(redis::client_config{});
+    EXPECT_TRUE(handshake.empty());
+}
+
+TEST(Redis_Handshake, Auth) {
+    auto config = redis::client_config{}.set_password("s3cret");
+    auto handshake = redis::handshake_commands(config);
+    ASSERT_EQ(handshake.size(), 1);
+    EXPECT_EQ(handshake[0],
+              redis::command(std::vector<string>{"AUTH", "default", "s3cret"}));
+
+    config = config.set_username("user");
+    handshake = redis::handshake_commands(config);
+    ASSERT_EQ(handshake.size(), 1);
+    EXPECT_EQ(handshake[0],
+              redis::command(std::vector<string>{"AUTH", "user", "s3cret"}));
+}
+
+TEST(Redis_Handshake, Pipeline) {
+    auto config = redis::client_config{}
+                      .set_password("s3cret")
+                      .set_client_name("app")
+                      .set_database(2)
+                      .add_init_command(redis::command("CLIENT NO-EVICT ON"));
+    auto handshake = redis::handshake_commands(config);
+    redis::commands expected{
+        redis::command(std::vector<string>{"AUTH", "default", "s3cret"}),
+        redis::command(std::vector<string>{"CLIENT", "SETNAME", "app"}),
+        redis::command(std::vector<string>{"SELECT", "2"}),
+        redis::command("CLIENT NO-EVICT ON")};
+    EXPECT_EQ(handshake, expected);
+}
+
+TEST(Redis_Handshake, Hello) {
+    auto config = redis::client_config{}
+                      .set_password("s3cret")
+                      .set_client_name("app")
+                      .set_database(2)
+                      .set_use_hello(true);
+    auto handshake = redis::handshake_commands(config);
+    redis::commands expected{
+        redis::command(std::vector<string>{"HELLO", "2", "AUTH", "default",
+                                           "s3cret", "SETNAME", "app"}),
+        redis::command(std::vector<string>{"SELECT", "2"})};
+    EXPECT_EQ(handshake, expected);
+}
+
+} // namespace
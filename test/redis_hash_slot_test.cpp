@@ -0,0 +1,39 @@
+#include <string>
+
+#include "redis/hash_slot.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis;
+
+TEST(Redis_Hash_Slot, CRC16) {
+    // the reference value from the Redis Cluster specification
+    EXPECT_EQ(crc16("123456789"), 0x31C3);
+    EXPECT_EQ(crc16(""), 0);
+}
+
+TEST(Redis_Hash_Slot, Slot) {
+    EXPECT_EQ(hash_slot("foo"), 12182);
+    EXPECT_EQ(hash_slot("bar"), 5061);
+    EXPECT_LT(hash_slot("a long key with spaces"), num_hash_slots);
+}
+
+TEST(Redis_Hash_Slot, Hash_Tag) {
+    EXPECT_EQ(hash_slot("{user1000}.following"), hash_slot("user1000"));
+    EXPECT_EQ(hash_slot("{user1000}.following"),
+              hash_slot("{user1000}.followers"));
+    EXPECT_EQ(hash_slot("foo{bar}zap"), hash_slot("bar"));
+
+    // only the first tag counts
+    EXPECT_EQ(hash_slot("foo{bar}{zap}"), hash_slot("bar"));
+    EXPECT_EQ(hash_slot("foo{{bar}}zap"), hash_slot("{bar"));
+
+    // an empty tag hashes the whole key
+    EXPECT_EQ(hash_slot("foo{}{bar}"), crc16("foo{}{bar}") & 16383);
+    EXPECT_EQ(hash_slot("foo{bar"), crc16("foo{bar") & 16383);
+}
+
+} // namespace
@@ -0,0 +1,173 @@
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "redis/local_cache.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis;
+using namespace std::chrono_literals;
+
+reply make_reply(std::string contents) { return reply(value(contents)); }
+
+void fill(local_cache& cache, const std::string& key,
+          std::chrono::milliseconds ttl = 1min) {
+    cache.put(key, "GET " + key, make_reply(key), ttl);
+}
+
+bool cached(local_cache& cache, const std::string& key) {
+    return cache.get(key, "GET " + key).has_value();
+}
+
+TEST(Redis_Local_Cache, Hit_And_Miss) {
+    local_cache cache;
+    EXPECT_FALSE(cached(cache, "foo"));
+
+    fill(cache, "foo");
+    auto hit = cache.get("foo", "GET foo");
+    ASSERT_TRUE(hit.has_value());
+    EXPECT_EQ(hit->value().as<std::string>().value_or(""), "foo");
+
+    auto metrics = cache.metrics();
+    EXPECT_EQ(metrics.hits, 1);
+    EXPECT_EQ(metrics.misses, 1);
+    EXPECT_EQ(metrics.entries, 1);
+
+    // errors and zero TTLs are not cached
+    cache.put("bar", "GET bar", reply(client_error_code::read_error), 1min);
+    fill(cache, "baz", 0ms);
+    EXPECT_FALSE(cached(cache, "bar"));
+    EXPECT_FALSE(cached(cache, "baz"));
+}
+
+TEST(Redis_Local_Cache, Expires_Entries) {
+    local_cache cache;
+    fill(cache, "foo", 1ms);
+    fill(cache, "bar");
+    std::this_thread::sleep_for(5ms);
+
+    EXPECT_FALSE(cached(cache, "foo"));
+    EXPECT_TRUE(cached(cache, "bar"));
+    EXPECT_EQ(cache.metrics().expirations, 1);
+    EXPECT_EQ(cache.metrics().entries, 1);
+}
+
+TEST(Redis_Local_Cache, Erase_Drops_Every_Command_Of_Key) {
+    local_cache cache;
+    fill(cache, "foo");
+    cache.put("foo", "STRLEN foo", make_reply("3"), 1min);
+    fill(cache, "bar");
+
+    cache.erase("foo");
+    EXPECT_FALSE(cached(cache, "foo"));
+    EXPECT_FALSE(cache.get("foo", "STRLEN foo").has_value());
+    EXPECT_TRUE(cached(cache, "bar"));
+
+    cache.clear();
+    EXPECT_FALSE(cached(cache, "bar"));
+    EXPECT_EQ(cache.metrics().entries, 0);
+}
+
+TEST(Redis_Local_Cache, Erase_Drops_Fill_In_Flight) {
+    local_cache cache;
+    auto stale = cache.begin_fill("foo");
+    cache.erase("foo");
+    auto fresh = cache.begin_fill("foo");
+
+    // the read started before the write may hold the old value
+    cache.end_fill("foo", "GET foo", stale, make_reply("old"), 1min);
+    EXPECT_FALSE(cached(cache, "foo"));
+
+    cache.end_fill("foo", "GET foo", fresh, make_reply("new"), 1min);
+    auto hit = cache.get("foo", "GET foo");
+    ASSERT_TRUE(hit.has_value());
+    EXPECT_EQ(hit->value().as<std::string>().value_or(""), "new");
+
+    // clear() drops the fills in flight as well
+    auto token = cache.begin_fill("bar");
+    cache.clear();
+    cache.end_fill("bar", "GET bar", token, make_reply("bar"), 1min);
+    EXPECT_FALSE(cached(cache, "bar"));
+}
+
+TEST(Redis_Local_Cache, Ttl_For_Longest_Prefix) {
+    local_cache cache(local_cache_config()
+                          .set_default_ttl(5s)
+                          .add_ttl("user:", 1s)
+                          .add_ttl("user:session:", 100ms));
+    EXPECT_EQ(cache.ttl_for("order:1"), 5s);
+    EXPECT_EQ(cache.ttl_for("user:1"), 1s);
+    EXPECT_EQ(cache.ttl_for("user:session:1"), 100ms);
+}
+
+TEST(Redis_Local_Cache, Segmented_Lru_Protects_Reread_Entries) {
+    local_cache cache(local_cache_config()
+                          .set_max_entries(10)
+                          .set_shards(1)
+                          .set_policy(eviction_policy::segmented_lru));
+    fill(cache, "hot");
+    EXPECT_TRUE(cached(cache, "hot"));
+
+    // a scan of keys read once only churns the probationary segment
+    for (int i = 0; i < 100; i++) {
+        fill(cache, "scan" + std::to_string(i));
+    }
+
+    auto metrics = cache.metrics();
+    EXPECT_EQ(metrics.entries, 10);
+    EXPECT_EQ(metrics.evictions, 91);
+    EXPECT_TRUE(cached(cache, "hot"));
+    EXPECT_TRUE(cached(cache, "scan99"));
+    EXPECT_FALSE(cached(cache, "scan0"));
+}
+
+TEST(Redis_Local_Cache, Tiny_Lfu_Admits_Frequent_Entries) {
+    local_cache cache(local_cache_config()
+                          .set_max_entries(100)
+                          .set_shards(1)
+                          .set_policy(eviction_policy::tiny_lfu));
+    for (int i = 0; i < 20; i++) {
+        fill(cache, "hot" + std::to_string(i));
+        for (int j = 0; j < 5; j++) {
+            cached(cache, "hot" + std::to_string(i));
+        }
+    }
+
+    // keys seen once do not displace the popular ones
+    for (int i = 0; i < 1000; i++) {
+        fill(cache, "scan" + std::to_string(i));
+    }
+
+    EXPECT_LE(cache.metrics().entries, 100);
+    for (int i = 0; i < 20; i++) {
+        EXPECT_TRUE(cached(cache, "hot" + std::to_string(i))) << i;
+    }
+}
+
+TEST(Redis_Local_Cache, Frequency_Sketch) {
+    frequency_sketch sketch(100);
+    EXPECT_EQ(sketch.frequency(42), 0);
+
+    for (int i = 0; i < 5; i++) {
+        sketch.increment(42);
+    }
+    EXPECT_EQ(sketch.frequency(42), 5);
+
+    // counters saturate at 15
+    for (int i = 0; i < 20; i++) {
+        sketch.increment(7);
+    }
+    EXPECT_EQ(sketch.frequency(7), 15);
+
+    // and are halved once the sample is full
+    for (uint64_t i = 1000; i < 1975; i++) {
+        sketch.increment(i);
+    }
+    EXPECT_LT(sketch.frequency(7), 15);
+}
+
+} // namespace
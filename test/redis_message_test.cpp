@@ -8,6 +8,10 @@ namespace {
 
 using string = std::string;
 
+std::vector<uint8_t> to_buffer(std::string_view frame) {
+    return std::vector<uint8_t>(frame.begin(), frame.end());
+}
+
 TEST(redis_message, Null) {
     redis::redis_message message;
     EXPECT_TRUE(message.empty());
@@ -78,4 +82,57 @@ TEST(redis_message, BadMessageFromRedisArray) {
     EXPECT_EQ(message.contents, "");
 }
 
+TEST(redis_message, ScanMessage) {
+    auto buffer = to_buffer("*3\r\n$7\r\nmessage\r\n$3\r\nfoo\r\n$2\r\n42\r\n"
+                            "+OK\r\n");
+    auto it = buffer.cbegin();
+    auto message = redis::scan_message(it, buffer.cend());
+    ASSERT_TRUE(message.has_value());
+    EXPECT_EQ(message->channel, "foo");
+    EXPECT_EQ(message->pattern, "");
+    EXPECT_EQ(message->contents, "42");
+    EXPECT_EQ(*it, '+');
+
+    // the views point into the buffer
+    EXPECT_EQ(message->channel.data(),
+              reinterpret_cast<const char*>(buffer.data()) + 21);
+    EXPECT_EQ(message->to_message().channel, "foo");
+}
+
+TEST(redis_message, ScanPmessage) {
+    auto buffer = to_buffer("*4\r\n$8\r\npmessage\r\n$2\r\nf*\r\n"
+                            "$3\r\nfoo\r\n$0\r\n\r\n");
+    auto it = buffer.cbegin();
+    auto message = redis::scan_message(it, buffer.cend());
+    ASSERT_TRUE(message.has_value());
+    EXPECT_EQ(message->pattern, "f*");
+    EXPECT_EQ(message->channel, "foo");
+    EXPECT_EQ(message->contents, "");
+    EXPECT_EQ(it, buffer.cend());
+}
+
+TEST(redis_message, ScanLeavesOtherFrames) {
+    auto frames = std::vector<string>{
+        // partial messages
+        "*3\r\n$7\r\nmessage\r\n$3\r\nfoo\r\n$2\r\n4",
+        "*3\r\n$7\r\nmessage\r",
+        "*3",
+        "",
+        // confirmations and replies
+        "*3\r\n$9\r\nsubscribe\r\n$3\r\nfoo\r\n:1\r\n",
+        "*3\r\n$7\r\nmessage\r\n$3\r\nfoo\r\n:1\r\n",
+        "*2\r\n$7\r\nmessage\r\n$3\r\nfoo\r\n",
+        "+PONG\r\n",
+        "*3\r\n$-1\r\n$3\r\nfoo\r\n$2\r\n42\r\n",
+    };
+
+    for (const auto& frame : frames) {
+        auto buffer = to_buffer(frame);
+        auto it = buffer.cbegin();
+        EXPECT_FALSE(redis::scan_message(it, buffer.cend()).has_value())
+            << frame;
+        EXPECT_EQ(it, buffer.cbegin());
+    }
+}
+
 } // namespace
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "redis/commands.hpp"
+#include "redis/near_cache.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis;
+using namespace std::chrono_literals;
+
+reply make_reply(std::string contents) { return reply(value(contents)); }
+
+void fill(near_cache& cache, const command& command, std::string contents) {
+    auto token = cache.begin_fill(command);
+    cache.end_fill(command, token, make_reply(contents));
+}
+
+TEST(Redis_Near_Cache, Cacheable) {
+    EXPECT_TRUE(near_cache::cacheable(redis::get("foo")));
+    EXPECT_TRUE(near_cache::cacheable(command("HGETALL user:1")));
+    EXPECT_FALSE(near_cache::cacheable(redis::set("foo", "1")));
+    EXPECT_FALSE(near_cache::cacheable(command("TTL foo")));
+    EXPECT_FALSE(near_cache::cacheable(command("MGET foo bar")));
+    EXPECT_FALSE(near_cache::cacheable(command("PING")));
+}
+
+TEST(Redis_Near_Cache, Hit_And_Miss) {
+    near_cache cache(1 << 20);
+    EXPECT_FALSE(cache.lookup(redis::get("foo")).has_value());
+
+    fill(cache, redis::get("foo"), "bar");
+    auto cached = cache.lookup(redis::get("foo"));
+    ASSERT_TRUE(cached.has_value());
+    EXPECT_EQ(cached->value().as<std::string>().value_or(""), "bar");
+
+    auto metrics = cache.metrics();
+    EXPECT_EQ(metrics.hits, 1);
+    EXPECT_EQ(metrics.misses, 1);
+    EXPECT_EQ(metrics.entries, 1);
+    EXPECT_GT(metrics.bytes, 0);
+}
+
+TEST(Redis_Near_Cache, Invalidate) {
+    near_cache cache(1 << 20);
+    fill(cache, redis::get("foo"), "1");
+    fill(cache, command("STRLEN foo"), "1");
+    fill(cache, redis::get("bar"), "2");
+
+    // every command on the key is dropped
+    cache.invalidate("foo");
+    EXPECT_FALSE(cache.lookup(redis::get("foo")).has_value());
+    EXPECT_FALSE(cache.lookup(command("STRLEN foo")).has_value());
+    EXPECT_TRUE(cache.lookup(redis::get("bar")).has_value());
+    EXPECT_EQ(cache.metrics().invalidations, 2);
+
+    cache.flush();
+    EXPECT_FALSE(cache.lookup(redis::get("bar")).has_value());
+    EXPECT_EQ(cache.metrics().entries, 0);
+    EXPECT_EQ(cache.metrics().bytes, 0);
+}
+
+TEST(Redis_Near_Cache, Invalidated_Fill_Is_Dropped) {
+    near_cache cache(1 << 20);
+    auto token = cache.begin_fill(redis::get("foo"));
+
+    // a write raced the read
+    cache.invalidate("foo");
+    cache.end_fill(redis::get("foo"), token, make_reply("stale"));
+    EXPECT_FALSE(cache.lookup(redis::get("foo")).has_value());
+
+    token = cache.begin_fill(redis::get("foo"));
+    cache.flush();
+    cache.end_fill(redis::get("foo"), token, make_reply("stale"));
+    EXPECT_FALSE(cache.lookup(redis::get("foo")).has_value());
+
+    // errors are not cached
+    token = cache.begin_fill(redis::get("foo"));
+    cache.end_fill(redis::get("foo"), token,
+                   reply(client_error_code::read_error));
+    EXPECT_FALSE(cache.lookup(redis::get("foo")).has_value());
+}
+
+TEST(Redis_Near_Cache, Evicts_Least_Recently_Used) {
+    near_cache cache(1000);
+    for (int i = 0; i < 20; i++) {
+        fill(cache, redis::get("key" + std::to_string(i)), "value");
+        // keep the first key hot
+        cache.lookup(redis::get("key0"));
+    }
+
+    auto metrics = cache.metrics();
+    EXPECT_LE(metrics.bytes, 1000);
+    EXPECT_GT(metrics.evictions, 0);
+    EXPECT_TRUE(cache.lookup(redis::get("key0")).has_value());
+    EXPECT_FALSE(cache.lookup(redis::get("key1")).has_value());
+    EXPECT_TRUE(cache.lookup(redis::get("key19")).has_value());
+}
+
+TEST(Redis_Near_Cache, Regions_Cover_Prefixes) {
+    near_cache cache({{"user:", 1 << 20, 0ms}, {"user:session:", 1000, 0ms}});
+    EXPECT_TRUE(cache.broadcast());
+    EXPECT_THAT(cache.prefixes(),
+                ::testing::ElementsAre("user:", "user:session:"));
+    EXPECT_THAT(cache.tracking_prefixes(), ::testing::ElementsAre("user:"));
+    EXPECT_TRUE(cache.covers("user:1"));
+    EXPECT_TRUE(cache.covers("user:session:1"));
+    EXPECT_FALSE(cache.covers("order:1"));
+
+    near_cache tracking(1 << 20);
+    EXPECT_FALSE(tracking.broadcast());
+    EXPECT_TRUE(tracking.prefixes().empty());
+    EXPECT_TRUE(tracking.covers("order:1"));
+}
+
+TEST(Redis_Near_Cache, Tracking_Prefixes_Do_Not_Overlap) {
+    near_cache cache({{"user:session:", 1000, 0ms},
+                      {"order:", 1000, 0ms},
+                      {"user:", 1000, 0ms},
+                      {"order:", 1000, 0ms}});
+    EXPECT_THAT(cache.tracking_prefixes(),
+                ::testing::ElementsAre("order:", "user:"));
+}
+
+TEST(Redis_Near_Cache, Regions_Evict_Independently) {
+    // the longest prefix wins, so sessions are capped on their own
+    near_cache cache({{"user:", 1 << 20, 0ms}, {"user:session:", 1000, 0ms}});
+    fill(cache, redis::get("user:1"), "alice");
+    for (int i = 0; i < 20; i++) {
+        fill(cache, redis::get("user:session:" + std::to_string(i)), "token");
+    }
+
+    EXPECT_GT(cache.metrics().evictions, 0);
+    EXPECT_TRUE(cache.lookup(redis::get("user:1")).has_value());
+    EXPECT_FALSE(cache.lookup(redis::get("user:session:0")).has_value());
+    EXPECT_TRUE(cache.lookup(redis::get("user:session:19")).has_value());
+
+    // keys outside every region are never cached
+    fill(cache, redis::get("order:1"), "book");
+    EXPECT_FALSE(cache.lookup(redis::get("order:1")).has_value());
+}
+
+TEST(Redis_Near_Cache, Regions_Expire_Entries) {
+    near_cache cache({{"quote:", 1 << 20, 1ms}, {"user:", 1 << 20, 0ms}});
+    fill(cache, redis::get("quote:1"), "42");
+    fill(cache, redis::get("user:1"), "alice");
+    std::this_thread::sleep_for(5ms);
+
+    EXPECT_FALSE(cache.lookup(redis::get("quote:1")).has_value());
+    EXPECT_TRUE(cache.lookup(redis::get("user:1")).has_value());
+    EXPECT_EQ(cache.metrics().expirations, 1);
+    EXPECT_EQ(cache.metrics().entries, 1);
+}
+
+TEST(Redis_Near_Cache, Parse_Invalidation) {
+    auto keys = reply(value(redis_array{
+        value("message"), value("__redis__:invalidate"),
+        value(redis_array{value("foo"), value("bar")})}));
+    auto message = parse_invalidation(keys);
+    ASSERT_TRUE(message.has_value());
+    EXPECT_FALSE(message->flush);
+    EXPECT_THAT(message->keys, ::testing::ElementsAre("foo", "bar"));
+
+    auto flush = reply(value(redis_array{
+        value("message"), value("__redis__:invalidate"), value()}));
+    message = parse_invalidation(flush);
+    ASSERT_TRUE(message.has_value());
+    EXPECT_TRUE(message->flush);
+
+    auto other = reply(value(
+        redis_array{value("message"), value("news"), value("hello")}));
+    EXPECT_FALSE(parse_invalidation(other).has_value());
+}
+
+} // namespace
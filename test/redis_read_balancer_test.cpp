@@ -0,0 +1,200 @@
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "redis/read_balancer.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using namespace redis;
+using namespace std::chrono_literals;
+
+std::vector<const server_stats*> pointers(const std::vector<server_stats>& s) {
+    std::vector<const server_stats*> result;
+    for (const auto& stats : s) {
+        result.push_back(&stats);
+    }
+    return result;
+}
+
+TEST(Redis_Read_Balancer, Master) {
+    std::vector<server_stats> servers(3);
+    read_balancer balancer(read_policy::master);
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(balancer.select(pointers(servers)), 0);
+    }
+}
+
+TEST(Redis_Read_Balancer, Round_Robin) {
+    std::vector<server_stats> servers(3);
+    read_balancer balancer(read_policy::round_robin);
+
+    std::vector<size_t> picked;
+    for (int i = 0; i < 6; i++) {
+        picked.push_back(balancer.select(pointers(servers)));
+    }
+    EXPECT_THAT(picked, ::testing::ElementsAre(0, 1, 2, 0, 1, 2));
+}
+
+TEST(Redis_Read_Balancer, Least_Outstanding) {
+    std::vector<server_stats> servers(3);
+    servers[0].begin();
+    servers[0].begin();
+    servers[1].begin();
+    servers[2].begin();
+    servers[2].begin();
+
+    read_balancer balancer(read_policy::least_outstanding);
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(balancer.select(pointers(servers)), 1);
+    }
+
+    // ties are spread over the servers
+    servers[0].end(1ms);
+    servers[2].end(1ms);
+    std::set<size_t> picked;
+    for (int i = 0; i < 6; i++) {
+        picked.insert(balancer.select(pointers(servers)));
+    }
+    EXPECT_EQ(picked.size(), 3);
+}
+
+TEST(Redis_Read_Balancer, Nearest) {
+    std::vector<server_stats> servers(3);
+    for (auto& server : servers) {
+        server.begin();
+    }
+    servers[0].end(5ms);
+    servers[1].end(1ms);
+    servers[2].end(9ms);
+
+    read_balancer balancer(read_policy::nearest);
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(balancer.select(pointers(servers)), 1);
+    }
+
+    // the average moves towards new samples
+    for (int i = 0; i < 50; i++) {
+        servers[1].begin();
+        servers[1].end(20ms);
+    }
+    EXPECT_GT(servers[1].latency(), 15ms);
+    EXPECT_EQ(balancer.select(pointers(servers)), 0);
+}
+
+TEST(Redis_Read_Balancer, Nearest_Tries_Unmeasured) {
+    std::vector<server_stats> servers(2);
+    servers[0].begin();
+    servers[0].end(1ms);
+
+    read_balancer balancer(read_policy::nearest);
+    EXPECT_EQ(balancer.select(pointers(servers)), 1);
+}
+
+TEST(Redis_Read_Balancer, Fastest) {
+    std::vector<server_stats> servers(2);
+    servers[0].begin();
+    servers[0].end(2ms);
+    servers[1].begin();
+    servers[1].end(3ms);
+
+    read_balancer balancer(read_policy::fastest);
+    EXPECT_EQ(balancer.select(pointers(servers)), 0);
+
+    // a fast server with a queue loses to a slower idle one
+    servers[0].begin();
+    servers[0].begin();
+    EXPECT_EQ(balancer.select(pointers(servers)), 1);
+}
+
+TEST(Redis_Read_Balancer, Percentile) {
+    server_stats stats;
+    EXPECT_FALSE(stats.percentile(0.95).has_value());
+
+    for (int i = 0; i < 95; i++) {
+        stats.begin();
+        stats.end(1ms);
+    }
+    for (int i = 0; i < 5; i++) {
+        stats.begin();
+        stats.end(50ms);
+    }
+
+    auto p50 = stats.percentile(0.5);
+    ASSERT_TRUE(p50.has_value());
+    EXPECT_GE(*p50, 1ms);
+    EXPECT_LT(*p50, 1500us);
+
+    auto p95 = stats.percentile(0.95);
+    ASSERT_TRUE(p95.has_value());
+    EXPECT_LT(*p95, 1500us);
+
+    auto p99 = stats.percentile(0.99);
+    ASSERT_TRUE(p99.has_value());
+    EXPECT_GE(*p99, 50ms);
+    EXPECT_LT(*p99, 60ms);
+}
+
+TEST(Redis_Read_Balancer, Percentile_Forgets_Old_Samples) {
+    server_stats stats;
+    for (int i = 0; i < 200; i++) {
+        stats.begin();
+        stats.end(40ms);
+    }
+    for (int i = 0; i < 5000; i++) {
+        stats.begin();
+        stats.end(1ms);
+    }
+
+    auto p99 = stats.percentile(0.99);
+    ASSERT_TRUE(p99.has_value());
+    EXPECT_LT(*p99, 1500us);
+}
+
+TEST(Redis_Read_Balancer, Replica_Unavailable) {
+    EXPECT_TRUE(replica_unavailable(reply(client_error_code::read_error)));
+    EXPECT_TRUE(replica_unavailable(reply(client_error_code::client_stopped)));
+    EXPECT_FALSE(replica_unavailable(reply(value("OK"))));
+
+    auto loading = reply(value(error("LOADING Redis is loading the dataset")),
+                         client_error_code::error);
+    EXPECT_TRUE(replica_unavailable(loading));
+
+    auto wrong_type = reply(value(error("WRONGTYPE Operation against a key")),
+                            client_error_code::error);
+    EXPECT_FALSE(replica_unavailable(wrong_type));
+}
+
+TEST(Redis_Read_Balancer, Failures_Mark_Down) {
+    server_stats stats;
+    EXPECT_TRUE(stats.available());
+
+    stats.begin();
+    stats.fail();
+    EXPECT_FALSE(stats.available());
+    EXPECT_EQ(stats.outstanding(), 0);
+
+    // a failure records no latency, so it does not look fast
+    EXPECT_EQ(stats.latency(), 0us);
+
+    std::this_thread::sleep_for(150ms);
+    EXPECT_TRUE(stats.available());
+
+    // a second failure in a row pauses it for longer
+    stats.begin();
+    stats.fail();
+    std::this_thread::sleep_for(150ms);
+    EXPECT_FALSE(stats.available());
+
+    std::this_thread::sleep_for(100ms);
+    stats.begin();
+    stats.end(1ms);
+    stats.mark_down();
+    std::this_thread::sleep_for(150ms);
+    EXPECT_TRUE(stats.available());
+}
+
+} // namespace
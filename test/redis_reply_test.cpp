@@ -216,4 +216,53 @@ TEST(RedisReply, Pipeline) {
     EXPECT_EQ(reply2.value().type(), redis::redis_type::nil);
 }
 
+TEST(RedisReply, Truncated) {
+    // a published message, as the subscriber may receive it in pieces
+    string message = "*3\r\n$7\r\nmessage\r\n$4\r\nnews\r\n$5\r\nhello\r\n"
+                     "+OK\r\n-ERR no\r\n:42\r\n";
+    std::vector<uint8_t> full(message.begin(), message.end());
+    const size_t first_size = 38;
+
+    for (size_t size = 0; size < first_size; size++) {
+        std::vector<uint8_t> partial(full.begin(), full.begin() + size);
+        redis::reply reply;
+        reply.load_data(partial.cbegin(), partial.cend());
+        EXPECT_EQ(reply.error(), redis::parse_error_code::eof) << size;
+    }
+
+    redis::reply reply;
+    auto it = reply.load_data(full.cbegin(), full.cend());
+    EXPECT_FALSE(reply.error());
+    EXPECT_EQ(it, full.cbegin() + first_size);
+
+    // every reply that is cut short is reported as incomplete
+    for (auto end = it + 1; end < full.cend(); end++) {
+        std::vector<uint8_t> rest(it, end);
+        auto next = rest.cbegin();
+        while (next != rest.cend()) {
+            redis::reply part;
+            next = part.load_data(next, rest.cend());
+            if (part.error() == redis::parse_error_code::eof) {
+                break;
+            }
+            EXPECT_NE(part.error(), redis::parse_error_code::malformed_message);
+        }
+    }
+}
+
+TEST(RedisReply, Malformed) {
+    auto input = std::vector<uint8_t>{'?', 'x', '\r', '\n'};
+    redis::reply reply;
+    reply.load_data(input.cbegin(), input.cend());
+    EXPECT_EQ(reply.error(), redis::parse_error_code::malformed_message);
+
+    input = std::vector<uint8_t>{'*', 'x', '\r', '\n'};
+    reply.load_data(input.cbegin(), input.cend());
+    EXPECT_EQ(reply.error(), redis::parse_error_code::malformed_message);
+
+    input = std::vector<uint8_t>{'$', '-', '5', '\r', '\n'};
+    reply.load_data(input.cbegin(), input.cend());
+    EXPECT_EQ(reply.error(), redis::parse_error_code::malformed_message);
+}
+
 } // namespace
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include <string>
+#include <vector>
+
+#include "redis/reply.hpp"
+#include "redis/sentinel.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using string = std::string;
+using namespace redis;
+
+redis::reply make_reply(string data) {
+    return redis::reply(std::vector<uint8_t>(data.begin(), data.end()));
+}
+
+TEST(Redis_Sentinel, Master_Address) {
+    auto address = parse_master_address(
+        make_reply("*2\r\n$8\r\n10.0.0.1\r\n$4\r\n6379\r\n"));
+    ASSERT_TRUE(address.has_value());
+    EXPECT_EQ(*address, (master_address{"10.0.0.1", 6379}));
+
+    // unknown master
+    EXPECT_FALSE(parse_master_address(make_reply("*-1\r\n")).has_value());
+    EXPECT_FALSE(parse_master_address(make_reply("-ERR no such master\r\n"))
+                     .has_value());
+    EXPECT_FALSE(parse_master_address(
+                     make_reply("*2\r\n$8\r\n10.0.0.1\r\n$5\r\n99999\r\n"))
+                     .has_value());
+}
+
+TEST(Redis_Sentinel, Switch_Master) {
+    auto address = parse_switch_master(
+        "mymaster 10.0.0.1 6379 10.0.0.2 6380", "mymaster");
+    ASSERT_TRUE(address.has_value());
+    EXPECT_EQ(*address, (master_address{"10.0.0.2", 6380}));
+
+    // events of other masters are ignored
+    EXPECT_FALSE(
+        parse_switch_master("other 10.0.0.1 6379 10.0.0.2 6380", "mymaster")
+            .has_value());
+    EXPECT_FALSE(
+        parse_switch_master("mymaster 10.0.0.1 6379", "mymaster").has_value());
+    EXPECT_FALSE(parse_switch_master("mymaster 10.0.0.1 6379 10.0.0.2 x",
+                                     "mymaster")
+                     .has_value());
+}
+
+TEST(Redis_Sentinel, Majority_Master) {
+    master_address old_master{"10.0.0.1", 6379};
+    master_address new_master{"10.0.0.2", 6379};
+
+    auto master = majority_master({new_master, old_master, new_master});
+    ASSERT_TRUE(master.has_value());
+    EXPECT_EQ(*master, new_master);
+
+    // sentinels that did not answer still count towards the total
+    EXPECT_FALSE(
+        majority_master({old_master, std::nullopt, std::nullopt}).has_value());
+    EXPECT_FALSE(majority_master({old_master, new_master}).has_value());
+    EXPECT_FALSE(majority_master({}).has_value());
+}
+
+} // namespace
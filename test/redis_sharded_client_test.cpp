@@ -0,0 +1,109 @@
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "redis/commands.hpp"
+#include "redis/sharded_client.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "test_functions.hpp"
+
+namespace {
+
+using string = std::string;
+using namespace redis;
+
+const std::string DEFAULT_REDIS_HOST = "host.docker.internal";
+
+std::optional<std::string> get_env_var(std::string const& key) {
+    char* val = getenv(key.c_str());
+    return (val == NULL) ? std::nullopt : std::optional(std::string(val));
+}
+
+awaitable<void> test_shard(sharded_client& client, int c,
+                           std::promise<void>& done) {
+    // work spawned onto a shard uses that shard's client
+    EXPECT_NE(client.local(), nullptr);
+
+    string key = std::string("sharded") + std::to_string(c);
+    auto reply = co_await client.send(redis::set(key, "42"));
+    testForSuccess("SET", reply);
+
+    reply = co_await client.send(redis::get(key));
+    testForValue("GET", reply, 42);
+
+    reply = co_await client.send(redis::del(key));
+    testForValue("DEL", reply, 1);
+
+    done.set_value();
+}
+
+TEST(ShardedClient, Send) {
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    sharded_client client(client_config{}.set_host(host).set_port(6379), 4);
+    EXPECT_EQ(client.size(), 4);
+    EXPECT_EQ(client.local(), nullptr);
+
+    client.start();
+
+    std::vector<std::promise<void>> done(client.size() * 2);
+    for (size_t i = 0; i < done.size(); i++) {
+        cpool::co_spawn(client.get_executor(),
+                        test_shard(client, i, std::ref(done[i])),
+                        cpool::detached);
+    }
+
+    for (auto& promise : done) {
+        promise.get_future().wait();
+    }
+
+    client.stop();
+}
+
+awaitable<void> test_not_started(sharded_client& client) {
+    // nothing runs the shards, so the requests fail instead of waiting
+    auto reply = co_await client.send(redis::get("sharded"));
+    EXPECT_EQ(reply.error(), client_error_code::client_stopped);
+
+    commands batch{redis::get("sharded"), redis::get("sharded")};
+    auto replies = co_await client.send(batch);
+    EXPECT_EQ(replies.size(), 2);
+    for (const auto& reply : replies) {
+        EXPECT_EQ(reply.error(), client_error_code::client_stopped);
+    }
+
+    auto error = co_await client.warm_up();
+    EXPECT_TRUE(error);
+}
+
+TEST(ShardedClient, NotStarted) {
+    sharded_client client(client_config{}, 2);
+
+    asio::io_context ctx(1);
+    cpool::co_spawn(ctx, test_not_started(client), cpool::detached);
+    ctx.run();
+}
+
+TEST(ShardedClient, StopFromShard) {
+    sharded_client client(client_config{}, 1);
+    client.start();
+
+    std::promise<bool> thrown;
+    asio::post(client.get_executor(0), [&client, &thrown]() {
+        try {
+            client.stop();
+            thrown.set_value(false);
+        } catch (const std::logic_error&) {
+            thrown.set_value(true);
+        }
+    });
+    EXPECT_TRUE(thrown.get_future().get());
+
+    client.stop();
+}
+
+} // namespace
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "redis/commands.hpp"
+#include "redis/sharded_pool_client.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "test_functions.hpp"
+
+namespace {
+
+using string = std::string;
+using namespace redis;
+
+const std::string DEFAULT_REDIS_HOST = "host.docker.internal";
+
+std::optional<std::string> get_env_var(std::string const& key) {
+    char* val = getenv(key.c_str());
+    return (val == NULL) ? std::nullopt : std::optional(std::string(val));
+}
+
+// the redis and redis-pass services of docker-compose.yml
+std::vector<client_config> node_configs() {
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    return {client_config{}.set_host(host).set_port(6379),
+            client_config{}.set_host(host).set_port(6380).set_password(
+                "s3cret")};
+}
+
+awaitable<void> run_sharded_pool_tests(asio::io_context& ctx,
+                                       hash_algorithm algorithm) {
+    auto exec = co_await asio::this_coro::executor;
+    sharded_pool_client client(exec, node_configs(), algorithm);
+    EXPECT_EQ(client.size(), 2);
+
+    auto error = co_await client.warm_up();
+    EXPECT_FALSE(error) << error.message();
+
+    // keys land on both nodes
+    std::vector<size_t> counts(client.size(), 0);
+    for (int i = 0; i < 32; i++) {
+        auto key = "pool" + std::to_string(i);
+        counts[client.node_for_key(key)]++;
+
+        auto reply = co_await client.send(redis::set(key, "42"));
+        testForSuccess("SET", reply);
+
+        // the key is only stored on its own node
+        reply = co_await client.node(client.node_for_key(key))
+                    .send(redis::get(key));
+        testForValue("GET", reply, 42);
+
+        reply = co_await client.send(redis::del(key));
+        testForValue("DEL", reply, 1);
+    }
+    EXPECT_GT(counts[0], 0);
+    EXPECT_GT(counts[1], 0);
+
+    // multi-key commands are split by node and merged in the key order
+    commands batch{redis::set("foo", "1"), redis::set("bar", "2"),
+                   redis::set("baz", "3"),
+                   redis::command("MGET foo missing bar baz"),
+                   redis::command("EXISTS foo bar baz missing"),
+                   redis::command("DEL foo bar baz")};
+    auto replies = co_await client.send(batch);
+    EXPECT_EQ(replies.size(), 6);
+    if (replies.size() == 6) {
+        auto values = replies[3].value().as<redis_array>();
+        EXPECT_TRUE(values.has_value());
+        if (values.has_value() && values->size() == 4) {
+            EXPECT_EQ((*values)[0].as<int>().value_or(0), 1);
+            EXPECT_EQ((*values)[1].type(), redis_type::nil);
+            EXPECT_EQ((*values)[2].as<int>().value_or(0), 2);
+            EXPECT_EQ((*values)[3].as<int>().value_or(0), 3);
+        }
+        testForValue("EXISTS", replies[4], 3);
+        testForValue("DEL", replies[5], 3);
+    }
+
+    // a node that is already known is not added twice
+    EXPECT_FALSE(client.add_node(node_configs().front()));
+
+    co_await client.stop();
+    ctx.stop();
+}
+
+awaitable<void> run_no_node_tests(asio::io_context& ctx) {
+    auto exec = co_await asio::this_coro::executor;
+    sharded_pool_client client(exec, {});
+    EXPECT_EQ(client.size(), 0);
+
+    // commands fail until a node is added
+    auto reply = co_await client.send(redis::get("foo"));
+    EXPECT_EQ(reply.error(), client_error_code::disconnected);
+    commands batch{redis::get("foo"), redis::get("bar")};
+    auto replies = co_await client.send(batch);
+    EXPECT_EQ(replies.size(), 2);
+    for (const auto& reply : replies) {
+        EXPECT_EQ(reply.error(), client_error_code::disconnected);
+    }
+
+    ctx.stop();
+}
+
+TEST(ShardedPoolClient, Ketama) {
+    asio::io_context ctx(1);
+
+    asio::co_spawn(ctx, run_sharded_pool_tests(ctx, hash_algorithm::ketama),
+                   asio::detached);
+    ctx.run();
+}
+
+TEST(ShardedPoolClient, Jump) {
+    asio::io_context ctx(1);
+
+    asio::co_spawn(ctx, run_sharded_pool_tests(ctx, hash_algorithm::jump),
+                   asio::detached);
+    ctx.run();
+}
+
+TEST(ShardedPoolClient, NoNodes) {
+    asio::io_context ctx(1);
+
+    asio::co_spawn(ctx, run_no_node_tests(ctx), asio::detached);
+    ctx.run();
+}
+
+} // namespace
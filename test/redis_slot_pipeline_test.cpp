@@ -0,0 +1,84 @@
+#include <string>
+#include <vector>
+
+#include "redis/command.hpp"
+#include "redis/reply.hpp"
+#include "redis/slot_pipeline.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using string = std::string;
+using namespace redis;
+
+redis::reply make_reply(string data) {
+    return redis::reply(std::vector<uint8_t>(data.begin(), data.end()));
+}
+
+TEST(Redis_Slot_Pipeline, Single_Slot) {
+    // hash tags keep all keys in one slot, nothing is split
+    commands pipeline{command("SET foo 1"), command("MGET {foo}a {foo}b"),
+                      command("PING")};
+    slot_pipeline split(pipeline);
+    EXPECT_EQ(split.split_commands(), pipeline);
+
+    auto merged = split.merge(replies{make_reply("+OK\r\n"),
+                                      make_reply("*2\r\n:1\r\n:2\r\n"),
+                                      make_reply("+PONG\r\n")});
+    ASSERT_EQ(merged.size(), 3);
+    EXPECT_EQ(merged[2].value().as<string>().value_or(""), "PONG");
+}
+
+TEST(Redis_Slot_Pipeline, Split_MGET) {
+    // foo and {foo}x share a slot, bar does not
+    slot_pipeline split(commands{command("MGET foo bar {foo}x")});
+    EXPECT_EQ(split.split_commands(),
+              (commands{command("MGET foo {foo}x"), command("MGET bar")}));
+
+    auto merged = split.merge(replies{make_reply("*2\r\n:1\r\n:3\r\n"),
+                                      make_reply("*1\r\n:2\r\n")});
+    ASSERT_EQ(merged.size(), 1);
+    EXPECT_FALSE(merged[0].error());
+    auto values = merged[0].value().as<redis_array>();
+    ASSERT_TRUE(values.has_value());
+    EXPECT_EQ(*values,
+              (redis_array{value(int64_t(1)), value(int64_t(2)),
+                           value(int64_t(3))}));
+}
+
+TEST(Redis_Slot_Pipeline, Split_DEL) {
+    slot_pipeline split(
+        commands{command("SET a 1"), command("DEL foo bar {bar}y"),
+                 command("EXISTS foo bar")});
+    EXPECT_EQ(split.split_commands(),
+              (commands{command("SET a 1"), command("DEL foo"),
+                        command("DEL bar {bar}y"), command("EXISTS foo"),
+                        command("EXISTS bar")}));
+
+    auto merged = split.merge(
+        replies{make_reply("+OK\r\n"), make_reply(":1\r\n"),
+                make_reply(":2\r\n"), make_reply(":0\r\n"),
+                make_reply(":1\r\n")});
+    ASSERT_EQ(merged.size(), 3);
+    EXPECT_EQ(merged[1].value().as<int64_t>().value_or(-1), 3);
+    EXPECT_EQ(merged[2].value().as<int64_t>().value_or(-1), 1);
+}
+
+TEST(Redis_Slot_Pipeline, Split_Error) {
+    slot_pipeline split(commands{command("DEL foo bar")});
+
+    auto merged = split.merge(
+        replies{make_reply(":1\r\n"), make_reply("-CLUSTERDOWN down\r\n")});
+    ASSERT_EQ(merged.size(), 1);
+    EXPECT_EQ(merged[0].error(), client_error_code::error);
+
+    // missing replies
+    merged = split.merge(replies{make_reply(":1\r\n")});
+    ASSERT_EQ(merged.size(), 1);
+    EXPECT_EQ(merged[0].error(),
+              client_error_code::response_command_mismatch);
+}
+
+} // namespace
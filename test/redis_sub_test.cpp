@@ -1,7 +1,12 @@
+#include <atomic>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <boost/asio/thread_pool.hpp>
+
 #include "redis/client.hpp"
 #include "redis/commands.hpp"
 #include "redis/error.hpp"
@@ -154,6 +159,475 @@ awaitable<void> run_tests(asio::io_context& ctx, std::unique_ptr<client> client,
     co_return;
 }
 
+awaitable<void> run_large_message_tests(asio::io_context& ctx,
+                                        std::unique_ptr<client> client,
+                                        std::unique_ptr<redis_subscriber> sub) {
+    const int num_messages = 20;
+    sub->start();
+    auto error = co_await sub->subscribe("large");
+    EXPECT_FALSE(error) << error.message();
+    auto reply = co_await sub->read();
+    testForError("SUBSCRIBE", reply);
+
+    // messages far larger than one read straddle several reads, and are
+    // published back to back so the next one starts mid-read
+    auto payload = [](int i) {
+        return std::string(50 * 1024 + i, static_cast<char>('a' + i));
+    };
+    for (int i = 0; i < num_messages; i++) {
+        reply = co_await client->send(publish("large", payload(i)));
+        testForError("PUBLISH", reply);
+    }
+
+    for (int i = 0; i < num_messages; i++) {
+        reply = co_await sub->read();
+        testForError("message_read", reply);
+
+        auto message = reply.value().as<redis_message>();
+        EXPECT_TRUE(message.has_value());
+        if (message) {
+            EXPECT_EQ(message->contents, payload(i)) << i;
+        }
+    }
+
+    co_await sub->stop();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_overflow_tests(asio::io_context& ctx,
+                                   overflow_policy policy) {
+    const int capacity = 4;
+    const int num_messages = 20;
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    client client(exec, client_config{}.set_host(host));
+    auto config =
+        client_config{}.set_host(host).set_subscriber_queue(capacity, policy);
+    redis_subscriber sub(exec, config);
+
+    sub.start();
+    auto error = co_await sub.subscribe("overflow");
+    EXPECT_FALSE(error) << error.message();
+    auto reply = co_await sub.read();
+    testForError("SUBSCRIBE", reply);
+
+    // nobody reads while the messages arrive
+    for (int i = 0; i < num_messages; i++) {
+        reply = co_await client.send(publish("overflow", std::to_string(i)));
+        testForError("PUBLISH", reply);
+    }
+
+    asio::steady_timer timer(exec);
+    auto dropped = [&sub]() {
+        auto metrics = sub.queue_metrics();
+        return metrics.dropped_oldest + metrics.dropped_newest;
+    };
+    for (int i = 0; i < 100 && dropped() < num_messages - capacity; i++) {
+        timer.expires_after(10ms);
+        co_await timer.async_wait(asio::use_awaitable);
+    }
+    EXPECT_EQ(dropped(), num_messages - capacity);
+
+    // drop_newest keeps the first messages and drop_oldest the last ones
+    int first = (policy == overflow_policy::drop_newest)
+                    ? 0
+                    : num_messages - capacity;
+    for (int i = first; i < first + capacity; i++) {
+        reply = co_await sub.read();
+        auto message = reply.value().as<redis_message>();
+        EXPECT_TRUE(message.has_value());
+        if (message) {
+            EXPECT_EQ(message->contents, std::to_string(i));
+        }
+    }
+
+    co_await sub.stop();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_drop_oldest_reply_tests(asio::io_context& ctx) {
+    const int capacity = 4;
+    const int num_messages = 20;
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    client client(exec, client_config{}.set_host(host));
+    auto config = client_config{}.set_host(host).set_subscriber_queue(
+        capacity, overflow_policy::drop_oldest);
+    redis_subscriber sub(exec, config);
+
+    // the confirmation stays queued in front of the messages
+    sub.start();
+    auto error = co_await sub.subscribe("overflow_reply");
+    EXPECT_FALSE(error) << error.message();
+    for (int i = 0; i < num_messages; i++) {
+        auto reply = co_await client.send(
+            publish("overflow_reply", std::to_string(i)));
+        testForError("PUBLISH", reply);
+    }
+
+    asio::steady_timer timer(exec);
+    auto dropped = [&sub]() { return sub.queue_metrics().dropped_oldest; };
+    for (int i = 0; i < 100 && dropped() < num_messages - capacity + 1; i++) {
+        timer.expires_after(10ms);
+        co_await timer.async_wait(asio::use_awaitable);
+    }
+    EXPECT_EQ(dropped(), num_messages - capacity + 1);
+
+    auto reply = co_await sub.read();
+    testForError("SUBSCRIBE", reply);
+    EXPECT_FALSE(reply.value().as<redis_message>().has_value());
+    for (int i = num_messages - capacity + 1; i < num_messages; i++) {
+        reply = co_await sub.read();
+        auto message = reply.value().as<redis_message>();
+        EXPECT_TRUE(message.has_value());
+        if (message) {
+            EXPECT_EQ(message->contents, std::to_string(i));
+        }
+    }
+
+    co_await sub.stop();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_batch_tests(asio::io_context& ctx) {
+    const size_t num_messages = 100;
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    client client(exec, client_config{}.set_host(host));
+    redis_subscriber sub(
+        exec, client_config{}.set_host(host).set_subscriber_queue(256));
+
+    sub.start();
+    auto error = co_await sub.subscribe("batch");
+    EXPECT_FALSE(error) << error.message();
+
+    // the confirmation is not a message, so it ends its batch
+    auto batch = co_await sub.read_batch(10, 1s);
+    EXPECT_TRUE(batch.messages.empty());
+    EXPECT_TRUE(batch.control.has_value());
+
+    // nothing is published yet
+    batch = co_await sub.read_batch(10, 50ms);
+    EXPECT_TRUE(batch.messages.empty());
+    EXPECT_FALSE(batch.control.has_value());
+
+    redis::commands publishes;
+    for (size_t i = 0; i < num_messages; i++) {
+        publishes.push_back(publish("batch", std::to_string(i)));
+    }
+    auto replies = co_await client.send(publishes);
+    EXPECT_EQ(replies.size(), num_messages);
+
+    std::vector<redis_message> received;
+    while (received.size() < num_messages) {
+        batch = co_await sub.read_batch(32, 1s);
+        EXPECT_LE(batch.messages.size(), 32);
+        EXPECT_FALSE(batch.control.has_value());
+        if (batch.messages.empty()) {
+            break;
+        }
+        received.insert(received.end(), batch.messages.begin(),
+                        batch.messages.end());
+    }
+
+    EXPECT_EQ(received.size(), num_messages);
+    for (size_t i = 0; i < received.size(); i++) {
+        EXPECT_EQ(received[i].channel, "batch");
+        EXPECT_EQ(received[i].contents, std::to_string(i));
+    }
+
+    co_await sub.stop();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_handler_tests(asio::io_context& ctx) {
+    const int num_messages = 5;
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    client client(exec, client_config{}.set_host(host));
+    redis_subscriber sub(exec, client_config{}.set_host(host));
+
+    std::vector<redis_message> alpha;
+    std::vector<redis_message> gamma;
+    sub.set_channel_handler("alpha", [&alpha](const message_view& message) {
+        alpha.push_back(message.to_message());
+    });
+    sub.set_pattern_handler("gamma.*", [&gamma](const message_view& message) {
+        gamma.push_back(message.to_message());
+    });
+
+    sub.start();
+    auto error = co_await sub.subscribe("alpha");
+    EXPECT_FALSE(error) << error.message();
+    error = co_await sub.subscribe("beta");
+    EXPECT_FALSE(error) << error.message();
+    error = co_await sub.psubscribe("gamma.*");
+    EXPECT_FALSE(error) << error.message();
+
+    // confirmations are still read
+    for (int i = 0; i < 3; i++) {
+        auto reply = co_await sub.read();
+        EXPECT_FALSE(reply.error()) << reply.error().message();
+    }
+
+    redis::commands publishes;
+    for (int i = 0; i < num_messages; i++) {
+        publishes.push_back(publish("alpha", std::to_string(i)));
+        publishes.push_back(publish("gamma.1", std::to_string(i)));
+        publishes.push_back(publish("beta", std::to_string(i)));
+    }
+    co_await client.send(publishes);
+
+    // only the channel without a handler is queued
+    for (int i = 0; i < num_messages; i++) {
+        auto reply = co_await sub.read();
+        auto message = reply.value().as<redis_message>();
+        EXPECT_TRUE(message.has_value());
+        if (message) {
+            EXPECT_EQ(message->channel, "beta");
+            EXPECT_EQ(message->contents, std::to_string(i));
+        }
+    }
+
+    EXPECT_EQ(alpha.size(), num_messages);
+    EXPECT_EQ(gamma.size(), num_messages);
+    for (size_t i = 0; i < alpha.size(); i++) {
+        EXPECT_EQ(alpha[i].channel, "alpha");
+        EXPECT_EQ(alpha[i].contents, std::to_string(i));
+    }
+    for (size_t i = 0; i < gamma.size(); i++) {
+        EXPECT_EQ(gamma[i].pattern, "gamma.*");
+        EXPECT_EQ(gamma[i].channel, "gamma.1");
+        EXPECT_EQ(gamma[i].contents, std::to_string(i));
+    }
+
+    co_await sub.stop();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_parallel_handler_tests(asio::io_context& ctx) {
+    const int num_channels = 4;
+    const int num_messages = 20;
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    client client(exec, client_config{}.set_host(host));
+    redis_subscriber sub(exec, client_config{}.set_host(host));
+    asio::thread_pool pool(num_channels);
+    sub.set_handler_executor(pool.get_executor(), 8);
+
+    std::mutex mutex;
+    std::vector<std::vector<string>> received(num_channels);
+    std::atomic<int> running = 0;
+    std::atomic<int> most_running = 0;
+    std::atomic<int> handled = 0;
+    for (int c = 0; c < num_channels; c++) {
+        auto channel = "parallel" + std::to_string(c);
+        sub.set_channel_handler(channel, [&, c](const message_view& message) {
+            auto now = ++running;
+            auto most = most_running.load();
+            while (now > most &&
+                   !most_running.compare_exchange_weak(most, now)) {
+            }
+
+            std::this_thread::sleep_for(5ms);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                received[c].emplace_back(message.contents);
+            }
+            running--;
+            handled++;
+        });
+    }
+
+    sub.start();
+    for (int c = 0; c < num_channels; c++) {
+        auto error = co_await sub.subscribe("parallel" + std::to_string(c));
+        EXPECT_FALSE(error) << error.message();
+        auto reply = co_await sub.read();
+        EXPECT_FALSE(reply.error()) << reply.error().message();
+    }
+
+    redis::commands publishes;
+    for (int i = 0; i < num_messages; i++) {
+        for (int c = 0; c < num_channels; c++) {
+            publishes.push_back(
+                publish("parallel" + std::to_string(c), std::to_string(i)));
+        }
+    }
+    co_await client.send(publishes);
+
+    asio::steady_timer timer(exec);
+    for (int i = 0; i < 200 && handled < num_channels * num_messages; i++) {
+        timer.expires_after(10ms);
+        co_await timer.async_wait(asio::use_awaitable);
+    }
+
+    co_await sub.stop();
+    EXPECT_EQ(handled, num_channels * num_messages);
+    EXPECT_GT(most_running, 1);
+
+    // each channel is handled in order
+    for (int c = 0; c < num_channels; c++) {
+        EXPECT_EQ(received[c].size(), num_messages);
+        for (size_t i = 0; i < received[c].size(); i++) {
+            EXPECT_EQ(received[c][i], std::to_string(i));
+        }
+    }
+
+    pool.join();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_resubscribe_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    client client(exec, client_config{}.set_host(host));
+    redis_subscriber sub(exec, client_config{}.set_host(host));
+    int reconnects = 0;
+    sub.set_reconnect_handler([&reconnects]() { reconnects++; });
+
+    sub.start();
+    auto error = co_await sub.subscribe("resub1");
+    EXPECT_FALSE(error) << error.message();
+    error = co_await sub.subscribe("resub2");
+    EXPECT_FALSE(error) << error.message();
+    error = co_await sub.psubscribe("resub.*");
+    EXPECT_FALSE(error) << error.message();
+    for (int i = 0; i < 3; i++) {
+        auto reply = co_await sub.read();
+        EXPECT_FALSE(reply.error()) << reply.error().message();
+    }
+
+    auto kill =
+        command(std::vector<string>{"CLIENT", "KILL", "TYPE", "pubsub"});
+    auto reply = co_await client.send(kill);
+    EXPECT_FALSE(reply.error()) << reply.error().message();
+    reply = co_await sub.read();
+    EXPECT_EQ(reply.error(), client_error_code::disconnected);
+
+    asio::steady_timer timer(exec);
+    for (int i = 0; i < 100 && reconnects == 0; i++) {
+        timer.expires_after(10ms);
+        co_await timer.async_wait(asio::use_awaitable);
+    }
+    EXPECT_EQ(reconnects, 1);
+
+    // the confirmations of the restored subscriptions are not queued
+    co_await client.send(publish("resub2", "after"));
+    co_await client.send(publish("resub.x", "pattern"));
+    reply = co_await sub.read();
+    auto message = reply.value().as<redis_message>();
+    EXPECT_TRUE(message.has_value());
+    if (message) {
+        EXPECT_EQ(message->channel, "resub2");
+        EXPECT_EQ(message->contents, "after");
+    }
+
+    reply = co_await sub.read();
+    message = reply.value().as<redis_message>();
+    EXPECT_TRUE(message.has_value());
+    if (message) {
+        EXPECT_EQ(message->pattern, "resub.*");
+        EXPECT_EQ(message->channel, "resub.x");
+    }
+
+    co_await sub.stop();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_bulk_subscribe_tests(asio::io_context& ctx) {
+    const int num_channels = 2500;
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    client client(exec, client_config{}.set_host(host));
+    redis_subscriber sub(exec, client_config{}.set_host(host));
+
+    std::vector<string> channels;
+    for (int i = 0; i < num_channels; i++) {
+        channels.push_back("bulk" + std::to_string(i));
+    }
+
+    // the subscriber must be reading to see the confirmations
+    auto error = co_await sub.subscribe(channels);
+    EXPECT_TRUE(error);
+
+    sub.start();
+    error = co_await sub.subscribe(channels);
+    EXPECT_FALSE(error) << error.message();
+    // repeated names are confirmed once
+    error = co_await sub.psubscribe("bulk.a.*", "bulk.b.*", "bulk.a.*");
+    EXPECT_FALSE(error) << error.message();
+
+    // long names are split by size as well as by count
+    std::vector<string> long_channels;
+    for (int i = 0; i < 100; i++) {
+        long_channels.push_back(std::to_string(i) + string(1000, 'l'));
+    }
+    error = co_await sub.subscribe(long_channels);
+    EXPECT_FALSE(error) << error.message();
+    error = co_await sub.unsubscribe(long_channels);
+    EXPECT_FALSE(error) << error.message();
+
+    // the confirmations are not queued
+    co_await client.send(publish("bulk2499", "last"));
+    co_await client.send(publish("bulk.b.1", "pattern"));
+    auto reply = co_await sub.read();
+    auto message = reply.value().as<redis_message>();
+    EXPECT_TRUE(message.has_value());
+    if (message) {
+        EXPECT_EQ(message->channel, "bulk2499");
+        EXPECT_EQ(message->contents, "last");
+    }
+    reply = co_await sub.read();
+    message = reply.value().as<redis_message>();
+    EXPECT_TRUE(message.has_value());
+    if (message) {
+        EXPECT_EQ(message->pattern, "bulk.b.*");
+    }
+
+    error = co_await sub.unsubscribe(channels);
+    EXPECT_FALSE(error) << error.message();
+    error = co_await sub.punsubscribe("bulk.a.*", "bulk.b.*");
+    EXPECT_FALSE(error) << error.message();
+
+    co_await client.send(publish("bulk0", "ignored"));
+    co_await client.send(publish("bulk.a.1", "ignored"));
+    auto batch = co_await sub.read_batch(10, 100ms);
+    EXPECT_TRUE(batch.messages.empty());
+    EXPECT_FALSE(batch.control.has_value());
+
+    co_await sub.stop();
+    ctx.stop();
+    co_return;
+}
+
+awaitable<void> run_large_handshake_tests(asio::io_context& ctx) {
+    auto exec = co_await cpool::net::this_coro::executor;
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+
+    // the init replies take several reads
+    auto config = client_config{}.set_host(host).add_init_command(
+        redis::command(std::vector<string>{"ECHO", string(20000, 'x')}));
+    redis_subscriber sub(exec, config);
+
+    sub.start();
+    auto error = co_await sub.subscribe("handshake");
+    EXPECT_FALSE(error) << error.message();
+    auto reply = co_await sub.read();
+    testForError("SUBSCRIBE", reply);
+
+    co_await sub.stop();
+    ctx.stop();
+    co_return;
+}
+
 TEST(Subscribe, SubscribeTest) {
     asio::io_context ctx(1);
     auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
@@ -204,4 +678,103 @@ TEST(Subscribe, SubscribePasswordTest) {
     ctx.run();
 }
 
+TEST(Subscribe, DropNewestTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx,
+                    run_overflow_tests(std::ref(ctx),
+                                       overflow_policy::drop_newest),
+                    cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Subscribe, DropOldestTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx,
+                    run_overflow_tests(std::ref(ctx),
+                                       overflow_policy::drop_oldest),
+                    cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Subscribe, DropOldestKeepsRepliesTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_drop_oldest_reply_tests(std::ref(ctx)),
+                    cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Subscribe, BatchTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_batch_tests(std::ref(ctx)), cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Subscribe, HandlerTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_handler_tests(std::ref(ctx)), cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Subscribe, ParallelHandlerTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_parallel_handler_tests(std::ref(ctx)),
+                    cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Subscribe, ResubscribeTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_resubscribe_tests(std::ref(ctx)),
+                    cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Subscribe, BulkSubscribeTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_bulk_subscribe_tests(std::ref(ctx)),
+                    cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Subscribe, LargeHandshakeTest) {
+    asio::io_context ctx(1);
+
+    cpool::co_spawn(ctx, run_large_handshake_tests(std::ref(ctx)),
+                    cpool::detached);
+
+    ctx.run();
+}
+
+TEST(Subscribe, LargeMessageTest) {
+    asio::io_context ctx(1);
+    auto host = get_env_var("REDIS_HOST").value_or(DEFAULT_REDIS_HOST);
+    auto client =
+        std::make_unique<redis::client>(ctx.get_executor(), host, 6379);
+    auto subscriber =
+        make_unique<redis_subscriber>(ctx.get_executor(), host, 6379);
+
+    cpool::co_spawn(ctx,
+                    run_large_message_tests(std::ref(ctx), std::move(client),
+                                            std::move(subscriber)),
+                    cpool::detached);
+
+    ctx.run();
+}
+
 } // namespace
\ No newline at end of file
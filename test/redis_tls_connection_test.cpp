@@ -0,0 +1,203 @@
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include "redis/client_config.hpp"
+#include "redis/command.hpp"
+#include "redis/reply.hpp"
+#include "redis/tls_connection.hpp"
+#include "redis/types.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using string = std::string;
+using namespace redis;
+using tcp = net::ip::tcp;
+
+/// A self-signed certificate for localhost, written to a PEM file so the
+/// client can trust it
+struct test_certificate {
+    std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key{nullptr,
+                                                           &EVP_PKEY_free};
+    std::unique_ptr<X509, decltype(&X509_free)> cert{nullptr, &X509_free};
+    string path;
+
+    test_certificate() {
+        auto* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+        EVP_PKEY* pkey = nullptr;
+        EVP_PKEY_keygen_init(ctx);
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1);
+        EVP_PKEY_keygen(ctx, &pkey);
+        EVP_PKEY_CTX_free(ctx);
+        key.reset(pkey);
+
+        cert.reset(X509_new());
+        ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert.get()), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert.get()), 3600);
+        X509_set_pubkey(cert.get(), key.get());
+        auto* name = X509_get_subject_name(cert.get());
+        X509_NAME_add_entry_by_txt(
+            name, "CN", MBSTRING_ASC,
+            reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+        X509_set_issuer_name(cert.get(), name);
+        X509_sign(cert.get(), key.get(), EVP_sha256());
+
+        path = "/tmp/redis-client-test-" + std::to_string(getpid()) + ".pem";
+        auto* file = std::fopen(path.c_str(), "w");
+        PEM_write_X509(file, cert.get());
+        std::fclose(file);
+    }
+
+    ~test_certificate() { ::unlink(path.c_str()); }
+};
+
+/// Answers one command with +PONG on each of num_connections TLS
+/// connections, standing in for redis-server
+awaitable<void> serve_pong(tcp::acceptor& acceptor,
+                           net::ssl::context& context, int num_connections) {
+    for (int i = 0; i < num_connections; ++i) {
+        auto socket = co_await acceptor.async_accept(net::use_awaitable);
+        net::ssl::stream<tcp::socket> stream(std::move(socket), context);
+        co_await stream.async_handshake(net::ssl::stream_base::server,
+                                        net::use_awaitable);
+
+        std::array<char, 64> request;
+        co_await stream.async_read_some(net::buffer(request),
+                                        net::use_awaitable);
+        co_await net::async_write(stream, net::buffer(string("+PONG\r\n")),
+                                  net::use_awaitable);
+
+        // wait for the client to close
+        cpool::error_code ec;
+        co_await stream.async_read_some(
+            net::buffer(request), net::redirect_error(net::use_awaitable, ec));
+    }
+}
+
+awaitable<void> ping_server(std::shared_ptr<tls_context> context,
+                            uint16_t port) {
+    auto exec = co_await net::this_coro::executor;
+
+    tls_connection conn(exec, "localhost", port, context);
+    EXPECT_EQ(conn.endpoint(), "localhost:" + std::to_string(port));
+
+    auto error = co_await conn.async_connect();
+    EXPECT_FALSE(error) << error.message();
+    EXPECT_TRUE(conn.connected());
+
+    auto request = command("PING").serialized_command();
+    auto [write_error, bytes_written] =
+        co_await conn.async_write(net::buffer(request));
+    EXPECT_FALSE(write_error);
+
+    buffer_t read_buffer(64);
+    auto [read_error, bytes_read] =
+        co_await conn.async_read_some(net::buffer(read_buffer));
+    EXPECT_FALSE(read_error);
+
+    redis::reply reply;
+    reply.load_data(read_buffer.cbegin(), read_buffer.cbegin() + bytes_read);
+    EXPECT_EQ(reply.value().as<string>().value_or(""), "PONG");
+
+    co_await conn.async_disconnect();
+    EXPECT_FALSE(conn.connected());
+}
+
+awaitable<void> ping_twice(std::shared_ptr<tls_context> context,
+                           uint16_t port) {
+    co_await ping_server(context, port);
+    co_await ping_server(context, port);
+}
+
+TEST(TlsConnection, ResumesSession) {
+    test_certificate certificate;
+
+    net::ssl::context server_context(net::ssl::context::tls_server);
+    SSL_CTX_use_certificate(server_context.native_handle(),
+                            certificate.cert.get());
+    SSL_CTX_use_PrivateKey(server_context.native_handle(),
+                           certificate.key.get());
+
+    net::io_context ctx(1);
+    tcp::acceptor acceptor(ctx,
+                           tcp::endpoint(net::ip::address_v4::loopback(), 0));
+    auto port = acceptor.local_endpoint().port();
+
+    auto config = client_config()
+                      .set_host("localhost")
+                      .set_port(port)
+                      .set_tls(true)
+                      .set_tls_ca_file(certificate.path);
+    auto context = std::make_shared<tls_context>(config);
+
+    net::co_spawn(ctx, serve_pong(acceptor, server_context, 2),
+                  net::detached);
+    net::co_spawn(ctx, ping_twice(context, port), net::detached);
+    ctx.run();
+
+    auto metrics = context->metrics();
+    EXPECT_EQ(metrics.handshakes, 2);
+    EXPECT_EQ(metrics.resumed_handshakes, 1);
+    EXPECT_EQ(metrics.failed_handshakes, 0);
+    EXPECT_GE(metrics.handshake_time, metrics.last_handshake_time);
+}
+
+TEST(TlsConnection, RejectsUntrustedCertificate) {
+    test_certificate certificate;
+
+    net::ssl::context server_context(net::ssl::context::tls_server);
+    SSL_CTX_use_certificate(server_context.native_handle(),
+                            certificate.cert.get());
+    SSL_CTX_use_PrivateKey(server_context.native_handle(),
+                           certificate.key.get());
+
+    net::io_context ctx(1);
+    tcp::acceptor acceptor(ctx,
+                           tcp::endpoint(net::ip::address_v4::loopback(), 0));
+    auto port = acceptor.local_endpoint().port();
+
+    // trusts the system CAs only, not the self-signed certificate
+    auto context = std::make_shared<tls_context>(
+        client_config().set_host("localhost").set_port(port).set_tls(true));
+
+    net::co_spawn(
+        ctx,
+        [&]() -> awaitable<void> {
+            cpool::error_code ec;
+            auto socket = co_await acceptor.async_accept(
+                net::redirect_error(net::use_awaitable, ec));
+            net::ssl::stream<tcp::socket> stream(std::move(socket),
+                                                 server_context);
+            co_await stream.async_handshake(
+                net::ssl::stream_base::server,
+                net::redirect_error(net::use_awaitable, ec));
+        },
+        net::detached);
+    net::co_spawn(
+        ctx,
+        [&]() -> awaitable<void> {
+            tls_connection conn(ctx.get_executor(), "localhost", port,
+                                context);
+            auto error = co_await conn.async_connect();
+            EXPECT_TRUE(error);
+            EXPECT_FALSE(conn.connected());
+        },
+        net::detached);
+    ctx.run();
+
+    EXPECT_EQ(context->metrics().handshakes, 0);
+    EXPECT_EQ(context->metrics().failed_handshakes, 1);
+}
+
+} // namespace
@@ -0,0 +1,105 @@
+#include <array>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "redis/command.hpp"
+#include "redis/reply.hpp"
+#include "redis/types.hpp"
+#include "redis/unix_connection.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using string = std::string;
+using namespace redis;
+using cpool::client_connection_state;
+using stream_protocol = net::local::stream_protocol;
+
+/// Answers a single command with +PONG, standing in for redis-server
+awaitable<void> serve_pong(stream_protocol::acceptor& acceptor) {
+    auto socket = co_await acceptor.async_accept(net::use_awaitable);
+
+    std::array<char, 64> request;
+    co_await socket.async_read_some(net::buffer(request), net::use_awaitable);
+    co_await net::async_write(socket, net::buffer(string("+PONG\r\n")),
+                              net::use_awaitable);
+}
+
+awaitable<void> ping_server(string path) {
+    auto exec = co_await net::this_coro::executor;
+    std::vector<client_connection_state> states;
+
+    unix_connection conn(exec, path);
+    conn.set_state_change_handler(
+        [&states](connection*, const client_connection_state state)
+            -> awaitable<cpool::error> {
+            states.push_back(state);
+            co_return cpool::error();
+        });
+    EXPECT_EQ(conn.endpoint(), path);
+    EXPECT_FALSE(conn.connected());
+
+    auto error = co_await conn.async_connect();
+    EXPECT_FALSE(error) << error.message();
+    EXPECT_TRUE(conn.connected());
+
+    auto request = command("PING").serialized_command();
+    auto [write_error, bytes_written] =
+        co_await conn.async_write(net::buffer(request));
+    EXPECT_FALSE(write_error);
+    EXPECT_EQ(bytes_written, request.size());
+
+    buffer_t read_buffer(64);
+    auto [read_error, bytes_read] =
+        co_await conn.async_read_some(net::buffer(read_buffer));
+    EXPECT_FALSE(read_error);
+
+    redis::reply reply;
+    reply.load_data(read_buffer.cbegin(), read_buffer.cbegin() + bytes_read);
+    EXPECT_EQ(reply.value().as<string>().value_or(""), "PONG");
+
+    co_await conn.async_disconnect();
+    EXPECT_FALSE(conn.connected());
+
+    std::vector<client_connection_state> expected{
+        client_connection_state::connecting, client_connection_state::connected,
+        client_connection_state::disconnecting,
+        client_connection_state::disconnected};
+    EXPECT_EQ(states, expected);
+}
+
+awaitable<void> connect_missing(string path) {
+    auto exec = co_await net::this_coro::executor;
+    unix_connection conn(exec, path);
+
+    auto error = co_await conn.async_connect();
+    EXPECT_TRUE(error);
+    EXPECT_FALSE(conn.connected());
+}
+
+TEST(UnixConnection, Ping) {
+    net::io_context ctx(1);
+    auto path = "/tmp/redis-client-test-" + std::to_string(getpid()) + ".sock";
+    ::unlink(path.c_str());
+
+    stream_protocol::acceptor acceptor(ctx, stream_protocol::endpoint(path));
+    net::co_spawn(ctx, serve_pong(acceptor), net::detached);
+    net::co_spawn(ctx, ping_server(path), net::detached);
+    ctx.run();
+
+    ::unlink(path.c_str());
+}
+
+TEST(UnixConnection, MissingSocket) {
+    net::io_context ctx(1);
+
+    net::co_spawn(ctx, connect_missing("/tmp/redis-client-test-missing.sock"),
+                  net::detached);
+    ctx.run();
+}
+
+} // namespace